@@ -0,0 +1,36 @@
+/*
+
+file: convert_scan_log.cpp
+created: 2026-10-17
+
+Convert a text log of printed rplidar scans to a binary scan log.
+
+usage: convert_scan_log text_log scan_log [period_ms]
+    period_ms: time between scans, text logs have no timestamps (default 100)
+
+*/
+
+
+#include <stdlib.h>
+#include <iostream>
+#include <string>
+
+#include "../src/logging.hpp"
+#include "../src/scan_log.hpp"
+
+
+int main(int argc, char* argv[])
+{
+    if(argc < 3)
+    {
+        std::cout << "usage: " << argv[0] << " text_log scan_log [period_ms]" << std::endl;
+        return 1;
+    }
+    uint64_t period_ms = argc > 3 ? atoi(argv[3]) : 100;
+
+    int frames = convert_text_scan_log(argv[1], argv[2], period_ms * 1000);
+    if(frames < 0) return 1;
+
+    INFO("converted ", frames, " scans to ", argv[2]);
+    return 0;
+}
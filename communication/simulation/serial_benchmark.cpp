@@ -0,0 +1,116 @@
+/*
+
+file: serial_benchmark.cpp
+created: 2026-10-17
+
+Measure the serial links against emulated AVR modules.
+
+The sensor emulator sends measurements at a few rates and at line
+saturation to a Sensor read from an event loop, which reports how many
+arrive per second, how many are lost and how old they are when read. Then
+drive commands are sent to the steering emulator one at a time, timing how
+long each takes to reach it.
+
+usage: serial_benchmark [baud] [seconds]
+    baud: rate of the emulated lines (default 500000, as the AVRs)
+    seconds: how long each sensor rate is run (default 2)
+
+*/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "../src/avr_emulator.hpp"
+#include "../src/event_loop.hpp"
+#include "../src/latency.hpp"
+#include "../src/logging.hpp"
+#include "../src/sensor.hpp"
+#include "../src/steering.hpp"
+
+
+// read measurements at rate for seconds and print what came through
+static void run_sensor(int baud, double rate, double seconds)
+{
+    SensorEmulator module(baud);
+    // the measurement number goes in right and left, so a latency can be told for whichever is read
+    module.set_generator([](unsigned long long number){ return EmulatedMeasurement{0, (uint16_t)number, (uint16_t)(number >> 16)}; });
+    EventLoop loop;
+    Sensor sensor(module.port());
+    LatencyHistogram latency;
+    unsigned long long seen = 0;
+    loop.add(sensor.get_fd(), [&]()
+    {
+        sensor.update();
+        if(sensor.measurement_count() == seen) return;
+        seen = sensor.measurement_count();
+        SensorMeasurement measurement = sensor.measurement();
+        unsigned long long number = ((unsigned long long)measurement.left << 16) | measurement.right;
+        latency.record(measurement.time_ns - module.sent_ns(number));
+    });
+
+    module.set_rate(rate);
+    int64_t start = monotonic_ns();
+    int64_t end = start + (int64_t)(seconds * 1e9);
+    while(monotonic_ns() < end) loop.run_once(10);
+
+    // let what is on the way arrive before counting what was lost
+    module.set_rate(0);
+    int64_t drained = monotonic_ns() + 100000000;
+    while(monotonic_ns() < drained) loop.run_once(10);
+
+    unsigned long long sent = module.measurements_sent();
+    unsigned long long received = sensor.measurement_count();
+    char name[16];
+    if(rate == SensorEmulator::SATURATE) snprintf(name, sizeof(name), "saturated");
+    else snprintf(name, sizeof(name), "%.0f/s", rate);
+    printf("%-10s %9.0f/s received  %8llu lost  latency p50 %7.3f ms  p99 %7.3f ms  max %7.3f ms\n",
+           name, received / seconds, sent - received,
+           latency.percentile(0.5), latency.percentile(0.99), latency.max());
+    if(module.stats().dropped > 0) printf("%-10s %9llu frames overran the pseudo terminal\n", "", module.stats().dropped);
+}
+
+
+// send count drive commands one at a time and print how long each took to reach the steering module
+static void run_steering(int baud, int count)
+{
+    SteeringEmulator module(baud);
+    EventLoop loop;
+    Steering steering(module.port());
+    steering.attach(loop);
+    LatencyHistogram latency;
+
+    // forward and backward take turns so every command changes the drive frame
+    for(int i = 0; i < count; i++)
+    {
+        unsigned long long updates = module.state().updates;
+        int64_t start = monotonic_ns();
+        steering.command(i % 2 ? SteeringCommand::DRIVE_BACKWARD : SteeringCommand::DRIVE_FORWARD);
+        loop.run_once(0);
+        if(!module.wait_for_updates(updates + 1, 100)) continue;
+        latency.record(monotonic_ns() - start);
+    }
+
+    SerialStats stats = steering.serial_stats();
+    printf("steering   %9llu drives  %8llu replaced  latency p50 %7.3f ms  p99 %7.3f ms  max %7.3f ms\n",
+           steering.drive_count(), stats.replaced,
+           latency.percentile(0.5), latency.percentile(0.99), latency.max());
+}
+
+
+int main(int argc, char* argv[])
+{
+    int baud = argc > 1 ? atoi(argv[1]) : 500000;
+    double seconds = argc > 2 ? atof(argv[2]) : 2;
+    if(baud <= 0 || seconds <= 0)
+    {
+        ERROR("usage: serial_benchmark [baud] [seconds]");
+        return 1;
+    }
+
+    // a measurement frame is 10 bytes of 10 bits each on the line
+    printf("%d baud, at most %d measurements/s\n", baud, baud / 100);
+    for(double rate : {100.0, 1000.0, 2000.0, 5000.0, (double)SensorEmulator::SATURATE}) run_sensor(baud, rate, seconds);
+    run_steering(baud, 1000);
+    return 0;
+}
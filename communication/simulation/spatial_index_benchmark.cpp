@@ -0,0 +1,143 @@
+/*
+
+file: spatial_index_benchmark.cpp
+created: 2026-10-17
+
+Compare nearest neighbour lookups on a recorded scan log.
+
+Every scan is looked up in the previous one, like scan matching does, with
+a brute force search, the kd-tree and the grid hash.
+
+usage: spatial_index_benchmark [text_log] [radius_mm]
+    text_log: text log of printed rplidar scans (default the walled in log)
+    radius_mm: radius of radius queries and cell size of the grid (default 50)
+
+*/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/icp.hpp"
+#include "../src/logging.hpp"
+#include "../src/replay_rplidar.hpp"
+#include "../src/scan_log.hpp"
+#include "../src/spatial_index.hpp"
+
+
+using Clock = std::chrono::steady_clock;
+
+
+struct Timing
+{
+    double build_ms = 0;
+    double nearest_ms = 0;
+    double radius_ms = 0;
+    size_t found = 0;
+};
+
+
+static double ms_since(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+
+static void print(const char* name, const Timing& t, int scans)
+{
+    printf("%-12s build %8.4f ms  nearest %8.4f ms  radius %8.4f ms  (%zu in radius)\n",
+           name, t.build_ms / scans, t.nearest_ms / scans, t.radius_ms / scans, t.found);
+}
+
+
+int main(int argc, char* argv[])
+{
+    std::string text_log = argc > 1 ? argv[1] : "../pc/resources/rplidar_walled_in_log.txt";
+    float radius = argc > 2 ? atof(argv[2]) : 50.0f;
+
+    std::string log_file = "/tmp/spatial_index_benchmark" + SCAN_LOG_EXTENSION;
+    if(convert_text_scan_log(text_log, log_file, 100000) < 0) return 1;
+
+    std::vector<std::vector<Vec2>> scans;
+    ReplayRPLidar replay(log_file, ReplayPace::FAST);
+    while(!replay.finished())
+    {
+        ScanFramePtr frame = replay.get_scan();
+        scans.push_back(ICP::to_points(frame->nodes()));
+    }
+    remove(log_file.c_str());
+    if(scans.size() < 2) return 1;
+
+    Timing brute, kd, grid;
+    KdTree tree;
+    GridHash hash(radius);
+    std::vector<int> nearest, offsets, found;
+
+    for(size_t s = 1; s < scans.size(); s++)
+    {
+        const std::vector<Vec2>& reference = scans[s - 1];
+        const std::vector<Vec2>& queries = scans[s];
+
+        auto start = Clock::now();
+        nearest.resize(queries.size());
+        for(size_t i = 0; i < queries.size(); i++)
+        {
+            float best = 1e30f;
+            for(size_t j = 0; j < reference.size(); j++)
+            {
+                Vec2 d = reference[j] - queries[i];
+                if(d.dot(d) < best)
+                {
+                    best = d.dot(d);
+                    nearest[i] = j;
+                }
+            }
+        }
+        brute.nearest_ms += ms_since(start);
+        start = Clock::now();
+        found.clear();
+        for(const Vec2& q : queries)
+        {
+            for(size_t j = 0; j < reference.size(); j++)
+            {
+                Vec2 d = reference[j] - q;
+                if(d.dot(d) <= radius * radius) found.push_back(j);
+            }
+        }
+        brute.radius_ms += ms_since(start);
+        brute.found += found.size();
+
+        start = Clock::now();
+        tree.build(reference);
+        kd.build_ms += ms_since(start);
+        start = Clock::now();
+        tree.nearest(queries, nearest);
+        kd.nearest_ms += ms_since(start);
+        start = Clock::now();
+        tree.radius(queries, radius, offsets, found);
+        kd.radius_ms += ms_since(start);
+        kd.found += found.size();
+
+        start = Clock::now();
+        hash.build(reference);
+        grid.build_ms += ms_since(start);
+        start = Clock::now();
+        hash.nearest(queries, nearest, 10 * radius);
+        grid.nearest_ms += ms_since(start);
+        start = Clock::now();
+        hash.radius(queries, radius, offsets, found);
+        grid.radius_ms += ms_since(start);
+        grid.found += found.size();
+    }
+
+    int matched = scans.size() - 1;
+    INFO(matched, " scan pairs, ", scans[0].size(), " points in the first scan, per pair:");
+    print("brute force", brute, matched);
+    print("kd-tree", kd, matched);
+    print("grid hash", grid, matched);
+    return 0;
+}
@@ -0,0 +1,68 @@
+/*
+
+file: vectorization_test.cpp
+created: 2026-10-17
+
+Extract wall segments from every scan of a recorded scan log.
+
+Prints how many segments each scan turns into, how many points they cover,
+how long extraction takes and the wall rotation seen in the scan.
+
+usage: vectorization_test [text_log]
+    text_log: text log of printed rplidar scans (default the walled in log)
+
+*/
+
+
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../src/line_extractor.hpp"
+#include "../src/logging.hpp"
+#include "../src/replay_rplidar.hpp"
+#include "../src/scan_log.hpp"
+
+
+using Clock = std::chrono::steady_clock;
+
+
+int main(int argc, char* argv[])
+{
+    std::string text_log = argc > 1 ? argv[1] : "../pc/resources/rplidar_walled_in_log.txt";
+
+    std::string log_file = "/tmp/vectorization_test" + SCAN_LOG_EXTENSION;
+    if(convert_text_scan_log(text_log, log_file, 100000) < 0) return 1;
+
+    LineExtractor extractor;
+    ReplayRPLidar replay(log_file, ReplayPace::FAST);
+    int scans = 0;
+    size_t nodes = 0, segments = 0, fitted = 0;
+    double total_ms = 0;
+    while(!replay.finished())
+    {
+        ScanFramePtr frame = replay.get_scan();
+        auto start = Clock::now();
+        const std::vector<LineSegment>& lines = extractor.extract(frame->nodes());
+        total_ms += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        float rotation = 0;
+        bool walls = LineExtractor::axis_rotation(lines, 1000, rotation);
+        size_t points = 0;
+        for(const LineSegment& line : lines) points += line.points;
+        printf("scan %4d: %3zu nodes, %2zu segments covering %3zu points, walls %s %6.2f degrees\n",
+               scans, frame->nodes().size(), lines.size(), points, walls ? "at" : "not found,", rotation);
+
+        scans++;
+        nodes += frame->nodes().size();
+        segments += lines.size();
+        fitted += points;
+    }
+    remove(log_file.c_str());
+    if(scans == 0) return 1;
+
+    INFO(scans, " scans, per scan: ", nodes / scans, " nodes, ", segments / (float)scans, " segments covering ",
+         fitted / scans, " points, ", total_ms / scans, " ms");
+    return 0;
+}
@@ -0,0 +1,51 @@
+/*
+
+file: ai.cpp
+created: 2026-10-17
+
+Scan matching odometry.
+
+*/
+
+
+#include "ai.hpp"
+
+
+// matches with a larger mean squared residual (mm^2) are not trusted
+#define MAX_FITNESS 400.0f
+
+// matches where fewer of the points found a correspondence are not trusted
+#define MIN_INLIER_RATIO 0.5f
+
+
+AI::AI(const IcpConfig& config) : icp(config), result()
+{
+    result.delta = Pose{0, 0, 0};
+    result.converged = false;
+}
+
+
+Vec2 AI::robot_delta(const std::vector<ScanNode>& nodes)
+{
+    return robot_delta(ICP::to_points(nodes, icp.get_config().max_points));
+}
+
+
+Vec2 AI::robot_delta(const std::vector<Vec2>& points)
+{
+    result = icp.get_delta(points);
+    if(!matched()) return Vec2(0, 0);
+    return Vec2(result.delta.x, result.delta.y);
+}
+
+
+const IcpResult& AI::last_match() const
+{
+    return result;
+}
+
+
+bool AI::matched() const
+{
+    return result.converged && result.fitness < MAX_FITNESS && result.inlier_ratio >= MIN_INLIER_RATIO;
+}
@@ -0,0 +1,49 @@
+/*
+
+file: ai.hpp
+created: 2026-10-17
+
+Scan matching odometry.
+
+Each new scan is matched against the previous one with ICP, giving the
+motion of the robot between the two scans.
+
+*/
+
+
+#ifndef AI_HPP
+#define AI_HPP
+
+#include <vector>
+
+#include "icp.hpp"
+#include "pose.hpp"
+#include "scan_frame.hpp"
+#include "vec2.hpp"
+
+
+class AI
+{
+public:
+    AI(const IcpConfig& config = IcpConfig());
+
+    // robot movement in mm since the previous scan, in the robot frame of the previous scan
+    // (x to the right, y forward), zero for the first scan and when the scans could not be matched
+    // nodes: new rplidar scan
+    Vec2 robot_delta(const std::vector<ScanNode>& nodes);
+
+    // same as above for a scan that is already converted to points in mm
+    Vec2 robot_delta(const std::vector<Vec2>& points);
+
+    // full result of the latest match, including rotation and covariance
+    const IcpResult& last_match() const;
+
+    // true if the latest match can be trusted
+    bool matched() const;
+
+private:
+    ICP icp;
+    IcpResult result;
+};
+
+#endif // AI_HPP
@@ -0,0 +1,332 @@
+/*
+
+file: avr_emulator.cpp
+created: 2026-10-17
+
+Sensor and steering modules emulated on pseudo terminals.
+
+*/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "avr_emulator.hpp"
+#include "latency.hpp"
+#include "logging.hpp"
+#include "module.hpp"
+#include "sensor.hpp"
+#include "steering.hpp"
+
+
+// sleep until the monotonic time ns
+static void sleep_until(int64_t ns)
+{
+    timespec until;
+    until.tv_sec = ns / 1000000000;
+    until.tv_nsec = ns % 1000000000;
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, nullptr) == EINTR);
+}
+
+
+AvrEmulator::AvrEmulator(uint8_t module_id, uint8_t identified_type, int baud) :
+    baud(baud),
+    module_id(module_id),
+    identified_type(identified_type),
+    name(),
+    master(-1),
+    slave(-1),
+    woken(),
+    thread(),
+    running(false),
+    is_identified(false),
+    rx(),
+    line_free_ns(0),
+    frames_sent(0),
+    bytes_sent(0),
+    dropped(0),
+    frames_received(0),
+    crc_errors(0)
+{
+    master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        WARN("avr emulator: could not open a pseudo terminal, errno ", errno);
+        return;
+    }
+    name = ptsname(master);
+
+    // raw until the host sets it up, so nothing sent is echoed back meanwhile
+    slave = open(name.c_str(), O_RDWR | O_NOCTTY);
+    if(slave >= 0)
+    {
+        termios options;
+        tcgetattr(slave, &options);
+        cfmakeraw(&options);
+        tcsetattr(slave, TCSANOW, &options);
+    }
+}
+
+
+AvrEmulator::~AvrEmulator()
+{
+    stop();
+    if(slave >= 0) close(slave);
+    if(master >= 0) close(master);
+}
+
+
+EmulatorStats AvrEmulator::stats() const
+{
+    EmulatorStats stats;
+    stats.frames_sent = frames_sent.load();
+    stats.bytes_sent = bytes_sent.load();
+    stats.dropped = dropped.load();
+    stats.frames_received = frames_received.load();
+    stats.crc_errors = crc_errors.load();
+    return stats;
+}
+
+
+void AvrEmulator::start()
+{
+    if(master < 0 || thread.joinable()) return;
+    running.store(true);
+    thread = std::thread(&AvrEmulator::run, this);
+}
+
+
+void AvrEmulator::stop()
+{
+    if(!thread.joinable()) return;
+    running.store(false);
+    woken.notify();
+    thread.join();
+}
+
+
+void AvrEmulator::wake()
+{
+    woken.notify();
+}
+
+
+bool AvrEmulator::send(uint8_t type, const uint8_t* payload, uint8_t length, std::atomic<int64_t>* sent_ns)
+{
+    uint8_t frame[FRAME_MAX];
+    size_t size = encode_frame(type, payload, length, frame);
+
+    // the line takes 10 bits per byte (start, 8 data, stop), wait until it is done with what was sent before.
+    // a line that was busy until just now is taken to have gone straight on, so oversleeping does not slow it down
+    int64_t now = monotonic_ns();
+    int64_t start = now - line_free_ns < LINE_SLACK ? line_free_ns : now;
+    if(start > now) sleep_until(start);
+    line_free_ns = start + (int64_t)size * 10 * 1000000000 / baud;
+
+    if(sent_ns) sent_ns->store(monotonic_ns(), std::memory_order_relaxed);
+    ssize_t written = write(master, frame, size);
+    if(written != (ssize_t)size)
+    {
+        dropped++;
+        return false;
+    }
+    frames_sent++;
+    bytes_sent += size;
+    return true;
+}
+
+
+void AvrEmulator::run()
+{
+    int64_t next_id = 0;
+    pollfd fds[2] = {{master, POLLIN, 0}, {woken.fd(), POLLIN, 0}};
+    while(running.load())
+    {
+        // like the AVRs, send the module id until identified
+        int64_t now = monotonic_ns();
+        int64_t next = 0;
+        if(!is_identified.load())
+        {
+            if(now >= next_id)
+            {
+                send((uint8_t)FrameType::MODULE_ID, &module_id, 1);
+                next_id = now + ID_PERIOD;
+            }
+            next = next_id;
+        }
+        int64_t due = tick(now);
+        if(due != 0 && (next == 0 || due < next)) next = due;
+
+        // to the ns, a ms poll would make measurements late
+        timespec timeout;
+        int64_t wait_ns = next != 0 ? std::max<int64_t>(0, next - monotonic_ns()) : 0;
+        timeout.tv_sec = wait_ns / 1000000000;
+        timeout.tv_nsec = wait_ns % 1000000000;
+        if(ppoll(fds, 2, next != 0 ? &timeout : nullptr, nullptr) < 0 && errno != EINTR) break;
+        if(fds[1].revents & POLLIN) woken.clear();
+        if(!(fds[0].revents & POLLIN)) continue;
+
+        rx.fill(master);
+        SerialFrame frame;
+        while(rx.next(frame))
+        {
+            frames_received++;
+            if(frame.type == identified_type) is_identified.store(true);
+            else received(frame);
+        }
+        crc_errors.store(rx.crc_errors());
+    }
+}
+
+
+SensorEmulator::SensorEmulator(int baud) :
+    AvrEmulator(SENSOR, (uint8_t)SensorTx::IDENTIFIED, baud),
+    mutex(),
+    rate(0),
+    generator([](unsigned long long){ return EmulatedMeasurement{0, 0, 0}; }),
+    next_measurement_ns(0),
+    presses(0),
+    measurements(0),
+    sent_times(SENT_TIMES)
+{
+    start();
+}
+
+
+SensorEmulator::~SensorEmulator()
+{
+    stop();
+}
+
+
+void SensorEmulator::set_rate(double rate)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->rate = rate;
+        next_measurement_ns = 0;
+    }
+    wake();
+}
+
+
+void SensorEmulator::set_generator(Generator generator)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    this->generator = generator;
+}
+
+
+void SensorEmulator::press_competition()
+{
+    presses++;
+    wake();
+}
+
+
+int64_t SensorEmulator::sent_ns(unsigned long long number) const
+{
+    return sent_times[number & (SENT_TIMES - 1)].load(std::memory_order_relaxed);
+}
+
+
+int64_t SensorEmulator::tick(int64_t now)
+{
+    while(presses.load() > 0)
+    {
+        presses--;
+        send((uint8_t)SensorRx::COMPETITION);
+    }
+    if(!identified()) return 0;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if(rate == 0) return 0;
+
+    // send what is due, at saturation one after the other as fast as the line goes
+    if(next_measurement_ns == 0) next_measurement_ns = now;
+    if(now < next_measurement_ns) return next_measurement_ns;
+
+    // late measurements are caught up on, unless the line is too slow for the rate
+    unsigned long long number = measurements.load();
+    EmulatedMeasurement measurement = generator(number);
+    int64_t period = rate > 0 ? 1e9 / rate : 0;
+    next_measurement_ns = std::max<int64_t>(next_measurement_ns + period, now - CATCH_UP);
+    lock.unlock();
+
+    // same layout as send_data in sensor/sensor.c, high byte first
+    uint8_t payload[6] = {
+        (uint8_t)(measurement.rot >> 8), (uint8_t)measurement.rot,
+        (uint8_t)(measurement.right >> 8), (uint8_t)measurement.right,
+        (uint8_t)(measurement.left >> 8), (uint8_t)measurement.left
+    };
+    send((uint8_t)SensorRx::MEASUREMENT, payload, 6, &sent_times[number & (SENT_TIMES - 1)]);
+    measurements++;
+    return period > 0 ? next_measurement_ns : monotonic_ns();
+}
+
+
+SteeringEmulator::SteeringEmulator(int baud) :
+    AvrEmulator(STEERING, (uint8_t)SteeringTx::IDENTIFIED, baud),
+    mutex(),
+    updated(),
+    motors()
+{
+    start();
+}
+
+
+SteeringEmulator::~SteeringEmulator()
+{
+    stop();
+}
+
+
+EmulatedSteering SteeringEmulator::state() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return motors;
+}
+
+
+bool SteeringEmulator::wait_for_updates(unsigned long long updates, int timeout_ms) const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return updated.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&](){ return motors.updates >= updates; });
+}
+
+
+void SteeringEmulator::received(const SerialFrame& frame)
+{
+    // same frames as rx_frame in steering/usart.c
+    std::lock_guard<std::mutex> lock(mutex);
+    switch((SteeringTx)frame.type)
+    {
+        case SteeringTx::PWM:
+            if(frame.length != 2) return;
+            motors.left_pwm = frame.payload[0];
+            motors.right_pwm = frame.payload[1];
+            break;
+        case SteeringTx::DIR:
+            if(frame.length != 2) return;
+            motors.left_forward = frame.payload[0];
+            motors.right_forward = frame.payload[1];
+            break;
+        case SteeringTx::DRIVE:
+            if(frame.length != 3) return;
+            motors.left_pwm = frame.payload[0];
+            motors.right_pwm = frame.payload[1];
+            motors.left_forward = frame.payload[2] & 1;
+            motors.right_forward = (frame.payload[2] >> 1) & 1;
+            break;
+        default:
+            return;
+    }
+    motors.updates++;
+    updated.notify_all();
+}
@@ -0,0 +1,197 @@
+/*
+
+file: avr_emulator.hpp
+created: 2026-10-17
+
+Sensor and steering modules emulated on pseudo terminals.
+
+Each emulator opens a pseudo terminal and speaks the module's protocol on
+it from a thread of its own, so Sensor, Steering and identify_modules can
+be given its port instead of a /dev/ttyUSB device. Like the AVRs (see
+sensor/sensor.c and steering/usart.c) they send their module id every
+100 ms until they receive their identified frame.
+
+A pseudo terminal has no baud rate, so the emulators pace what they send
+to the baud rate they are given: a frame is not sent before the line would
+be done with the previous one. Sending at line saturation is then as fast
+as the real link can go. A frame the host does not read in time, so the
+pseudo terminal is full, is dropped and counted, as an overrun would be.
+
+Emulators are for tests and benchmarks only.
+
+*/
+
+
+#ifndef AVR_EMULATOR_HPP
+#define AVR_EMULATOR_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "serial_frame.hpp"
+#include "event_loop.hpp"
+
+
+struct EmulatorStats
+{
+    unsigned long long frames_sent = 0;
+    unsigned long long bytes_sent = 0;
+    unsigned long long dropped = 0;         // frames the host did not read in time
+    unsigned long long frames_received = 0;
+    unsigned long long crc_errors = 0;
+};
+
+
+class AvrEmulator
+{
+public:
+    // module_id: id sent until identified, identified_type: frame type that identifies it
+    // baud: rate of the emulated line
+    AvrEmulator(uint8_t module_id, uint8_t identified_type, int baud);
+    virtual ~AvrEmulator();
+
+    AvrEmulator(const AvrEmulator&) = delete;
+    AvrEmulator& operator=(const AvrEmulator&) = delete;
+
+    // port to open as the module, empty if no pseudo terminal could be opened
+    const std::string& port() const { return name; }
+
+    // the host sent the identified frame
+    bool identified() const { return is_identified.load(); }
+
+    EmulatorStats stats() const;
+
+    const static int64_t ID_PERIOD = 100000000;    // ns between module ids
+    const static int64_t LINE_SLACK = 1000000;     // ns a frame may start late and still be sent back to back
+
+protected:
+    // send a frame paced to the baud rate, returns false if it was dropped
+    // sent_ns is set to the monotonic time it is handed to the pseudo terminal, before the host can read it
+    // called from the emulator thread only
+    bool send(uint8_t type, const uint8_t* payload = nullptr, uint8_t length = 0, std::atomic<int64_t>* sent_ns = nullptr);
+
+    // a frame from the host other than the identified frame, called on the emulator thread
+    virtual void received(const SerialFrame&) {}
+
+    // send what is due at the given time (ns, monotonic), returns when to be called next, 0 if not until
+    // something happens. called on the emulator thread, also right away after wake
+    virtual int64_t tick(int64_t) { return 0; }
+
+    // call tick now instead of when it asked to be, safe from any thread
+    void wake();
+
+    // start the thread, derived emulators call it when constructed and stop it in their destructor
+    void start();
+    void stop();
+
+    const int baud;
+
+private:
+    void run();
+
+    const uint8_t module_id;
+    const uint8_t identified_type;
+    std::string name;
+    int master;
+    int slave;      // kept open so the master never hangs up between host opens
+    Notifier woken;
+    std::thread thread;
+    std::atomic<bool> running;
+    std::atomic<bool> is_identified;
+    FrameParser rx;
+    int64_t line_free_ns;   // when the line is done sending what was sent
+
+    std::atomic<unsigned long long> frames_sent;
+    std::atomic<unsigned long long> bytes_sent;
+    std::atomic<unsigned long long> dropped;
+    std::atomic<unsigned long long> frames_received;
+    std::atomic<unsigned long long> crc_errors;
+};
+
+
+struct EmulatedMeasurement
+{
+    int16_t rot;
+    uint16_t right;
+    uint16_t left;
+};
+
+
+class SensorEmulator : public AvrEmulator
+{
+public:
+    using Generator = std::function<EmulatedMeasurement(unsigned long long number)>;
+
+    SensorEmulator(int baud = 500000);
+    ~SensorEmulator();
+
+    // measurements per second once identified, SATURATE sends them back to back, 0 stops them
+    void set_rate(double rate);
+
+    // what the measurement with number is, numbered from 0
+    void set_generator(Generator generator);
+
+    // send a competition button press
+    void press_competition();
+
+    unsigned long long measurements_sent() const { return measurements.load(); }
+
+    // monotonic time measurement number was sent, for the last SENT_TIMES measurements
+    int64_t sent_ns(unsigned long long number) const;
+
+    const static int SATURATE = -1;
+    const static size_t SENT_TIMES = 1 << 16;
+    const static int64_t CATCH_UP = 10000000;      // ns measurements may fall behind the rate and still be sent
+
+protected:
+    virtual int64_t tick(int64_t now);
+
+private:
+    mutable std::mutex mutex;
+    double rate;
+    Generator generator;
+    int64_t next_measurement_ns;
+    std::atomic<int> presses;
+    std::atomic<unsigned long long> measurements;
+    std::vector<std::atomic<int64_t>> sent_times;
+};
+
+
+struct EmulatedSteering
+{
+    uint8_t left_pwm = 0;
+    uint8_t right_pwm = 0;
+    bool left_forward = true;
+    bool right_forward = true;
+    unsigned long long updates = 0;     // pwm, dir and drive frames received
+};
+
+
+class SteeringEmulator : public AvrEmulator
+{
+public:
+    SteeringEmulator(int baud = 500000);
+    ~SteeringEmulator();
+
+    // what the motors are set to now
+    EmulatedSteering state() const;
+
+    // wait until at least updates pwm, dir or drive frames were received, returns false on timeout
+    bool wait_for_updates(unsigned long long updates, int timeout_ms) const;
+
+protected:
+    virtual void received(const SerialFrame& frame);
+
+private:
+    mutable std::mutex mutex;
+    mutable std::condition_variable updated;
+    EmulatedSteering motors;
+};
+
+#endif // AVR_EMULATOR_HPP
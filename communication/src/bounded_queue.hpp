@@ -0,0 +1,131 @@
+/*
+
+file: bounded_queue.hpp
+created: 2026-10-17
+
+Bounded queue for handing work from one thread to another.
+
+Meant for a single producer and a single consumer. When the queue is full
+the producer never blocks, instead the oldest or the newest item is dropped
+depending on the drop policy.
+
+*/
+
+
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <stddef.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+#include "queue_stats.hpp"
+
+
+enum class DropPolicy : int
+{
+    DROP_OLDEST = 0,    // make room by dropping the item that has waited the longest
+    DROP_NEWEST = 1     // keep the queued items and drop the pushed one
+};
+
+
+template<typename T>
+class BoundedQueue
+{
+public:
+    BoundedQueue(size_t capacity, DropPolicy policy) : capacity(capacity), policy(policy), closed(false) {}
+
+    // push item, returns false if an item had to be dropped
+    bool push(T item);
+
+    // wait for an item, returns false if the queue was closed and is empty
+    bool pop(T& item);
+
+    // wake up the consumer and make pop return false once the queue is empty
+    void close();
+
+    // number of queued items
+    size_t depth() const;
+
+    // number of items dropped since construction
+    unsigned long long dropped() const { return counters.stats(0).dropped; }
+
+    QueueStats stats() const { return counters.stats(depth()); }
+
+private:
+    struct Entry
+    {
+        T item;
+        int64_t pushed_ns;
+    };
+
+    const size_t capacity;
+    const DropPolicy policy;
+    bool closed;
+    std::deque<Entry> items;
+    mutable std::mutex mutex;
+    std::condition_variable not_empty;
+    QueueCounters counters;
+};
+
+
+template<typename T>
+bool BoundedQueue<T>::push(T item)
+{
+    bool dropped = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(items.size() >= capacity)
+        {
+            dropped = true;
+            counters.on_drop();
+            if(policy == DropPolicy::DROP_NEWEST)
+            {
+                counters.on_push(items.size());
+                return false;
+            }
+            items.pop_front();
+        }
+        items.push_back({std::move(item), QueueCounters::now_ns()});
+        counters.on_push(items.size());
+    }
+    not_empty.notify_one();
+    return !dropped;
+}
+
+
+template<typename T>
+bool BoundedQueue<T>::pop(T& item)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    not_empty.wait(lock, [this](){ return !items.empty() || closed; });
+    if(items.empty()) return false;
+
+    item = std::move(items.front().item);
+    counters.on_pop(items.front().pushed_ns);
+    items.pop_front();
+    return true;
+}
+
+
+template<typename T>
+void BoundedQueue<T>::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+    }
+    not_empty.notify_all();
+}
+
+
+template<typename T>
+size_t BoundedQueue<T>::depth() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return items.size();
+}
+
+#endif // BOUNDED_QUEUE_HPP
@@ -14,12 +14,12 @@ creates a representation of the map, sends data to pc program.
 #include <unistd.h>
 #include <cmath>
 #include <ctime>
+#include <chrono>
 #include <iostream>
 #include <functional>
 #include <algorithm>
 #include <vector>
 #include <memory>
-#include <thread>
 #include "communication.hpp"
 #include "serial.hpp"
 #include "sensor.hpp"
@@ -36,6 +36,38 @@ using json = nlohmann::json;
 #define ROT_RIGHT_1_DIST 150
 #define ROT_RIGHT_3_DIST 275
 
+//Size of each map cell in mm, the map has no fixed extent so finer cells only cost memory for observed area.
+//Scan matching is only as precise as the cells, at 100 mm it drifts in rotation when walled in close.
+#define MAP_CELL_SIZE 50
+
+//Max number of scans waiting for the mapping worker, and which one to drop when it falls behind
+#define MAP_QUEUE_SIZE 4
+#define MAP_DROP_POLICY DropPolicy::DROP_OLDEST
+
+//Match scans against the map before integrating them, so the map does not follow odometry drift
+#define MAP_MATCH_SCANS true
+
+//Run the robot at least this often (ms) when no new data arrives, the steering regulates every 10 ms
+#define CONTROL_PERIOD 10
+
+//Time in ms from pressing the competition button until autonomous mode starts
+#define START_DELAY 1000
+
+//Time in ms between sending the queue stats of the threads to the pc
+#define STATS_PERIOD 1000
+
+//Max time in seconds to find the robot in a loaded map before starting from the origin instead
+#define LOCALIZE_TIMEOUT 10
+
+//How sure the robot is to stand in the middle of a square when a turn starts, in mm
+#define CORRECT_POSITION_STD 50
+
+//The arena walls run along the axes, so wall segments of a scan tell the rotation modulo a quarter turn.
+//Used when the segments are this long in total (mm), within this many degrees of the estimate, and this sure (degrees).
+#define WALL_MIN_LENGTH 1000
+#define WALL_MAX_ROT_ERROR 3
+#define WALL_ROT_STD 0.5
+
 
 Direction Communication::left_turn(Direction dir){
 	switch (dir) {
@@ -58,51 +90,190 @@ Direction Communication::right_turn(Direction dir) {
 
 Communication::Communication
 (
+    EventLoop& loop,
     const std::string& sensor_file,
     const std::string& steering_file,
-    const std::string& rplidar_file
+    std::unique_ptr<ScanSource> scan_source,
+    const std::string& record_file,
+    const std::string& load_map_file,
+    const std::string& save_map_file,
+    const std::string& latency_file
 ):
-    map(),
+    loop(loop),
+    control_timer(0),
+    start_timer(0),
+    stats_timer(0),
+    map(MAP_CELL_SIZE),
+    map_loaded(false),
+    save_map_file(save_map_file),
+    latency_file(latency_file),
+    latency(),
+    traced_sensor_ns(0),
+    pool(),
     sensor(sensor_file),
     steering(steering_file),
-    rplidar(rplidar_file),
+    rplidar(std::move(scan_source)),
+    map_worker(map, pool, MAP_QUEUE_SIZE, MAP_DROP_POLICY, MAP_MATCH_SCANS),
+    frame(),
+    odometry(),
+    estimator(),
+    walls(),
+    localizer(),
+    localize_start(),
+    sensor_count(0),
+    prev_pose{0, 0, 0},
     target_rot(0),
     mode(Mode::MOVING),
     direction(Direction::UP),
-    x_pos(0),
-    y_pos(0),
 	target_dist(0),
-    prev_dist(0),
     pc(std::make_shared<PC>()),
     robot_mode(RobotMode::AUTONOMOUS)
 
 {
-    rplidar.start_scanning();
+    //Continue in a saved map if asked to, the robot finds itself in it when autonomous mode starts.
+    if(!load_map_file.empty()) map_loaded = map.load(load_map_file);
+
+    //Record scans if asked to, only a real rplidar can be recorded.
+    RPLidar* lidar = dynamic_cast<RPLidar*>(rplidar.get());
+    if(!record_file.empty() && lidar) lidar->record(record_file);
+
+    rplidar->start_scanning();
     pc->on_command([this](SteeringCommand command){if(this->robot_mode == RobotMode::MANUAL) this->steering.command(command);});
     pc->on_calibration([this](float kp, float kd){this->steering.calibrate(kp, kd);});
     sensor.set_pc(pc);
     sensor.on_competition([this](){ 
-        if(this->robot_mode == RobotMode::MANUAL)this->robot_mode = RobotMode::AUTONOMOUS;
-        else this->robot_mode = RobotMode::MANUAL; 
-        
-        // Wait 1 second to start autonomous mode
-        auto timer = std::clock();
-        while((std::clock() - timer)/CLOCKS_PER_SEC < 1);
+        //Stop right away, or start autonomous mode after a while. Pressing again before it started cancels the start.
+        if(this->robot_mode == RobotMode::AUTONOMOUS) this->robot_mode = RobotMode::MANUAL;
+        else if(this->start_timer != 0 && this->loop.timers().cancel(this->start_timer)) this->start_timer = 0;
+        else this->start_timer = this->loop.timers().after(std::chrono::milliseconds(START_DELAY), [this](){
+            this->start_timer = 0;
+            this->robot_mode = RobotMode::AUTONOMOUS;
+        });
         }
     );  
     steering.set_pc(pc);
+    steering.start_regulation(loop.timers());
+    steering.set_tracer(&latency);
+
+    //Only run the robot when something happened: the sensor module sent something, the rplidar has a new scan
+    //or the control period passed. A scan source without an fd is polled every control period.
+    //The pc clients are served by a telemetry thread of their own.
+    pc->attach(loop);
+    sensor.attach(loop);
+    steering.attach(loop);
+    if(!loop.add(sensor.get_fd(), [this](){ this->sensor.update(); this->step(); })) WARN("Sensor module not watched by event loop");
+    loop.add(rplidar->event_fd(), [this](){ this->step(); });
+    control_timer = loop.timers().every(std::chrono::milliseconds(CONTROL_PERIOD), [this](){ this->step(); });
+    stats_timer = loop.timers().every(std::chrono::milliseconds(STATS_PERIOD), [this](){
+        this->pc->send_json(this->pipeline_stats());
+        this->pc->send_json(this->latency_stats());
+    });
 }
 
 
 Communication::~Communication(){
-    rplidar.stop_motor();
+    loop.timers().cancel(control_timer);
+    loop.timers().cancel(start_timer);
+    loop.timers().cancel(stats_timer);
+    loop.remove(rplidar->event_fd());
+    loop.remove(sensor.get_fd());
+    rplidar->stop_motor();
+
+    //Let the mapping worker integrate its last scans and close the loop first.
+    map_worker.stop();
+    INFO("pipeline: ", pipeline_stats().dump());
+    INFO("latency: ", latency_stats().dump());
+    if(!latency_file.empty() && !latency.dump(latency_file)) WARN("Could not write latencies to ", latency_file);
+    if(!save_map_file.empty()) map.save(save_map_file);
+}
+
+
+json
+Communication::pipeline_stats(){
+    //How full the queues between the threads are and how long items wait in them.
+    auto queue = [](const std::string& name, const QueueStats& stats) -> json {
+        return {
+            {"name", name},
+            {"depth", stats.depth},
+            {"max_depth", stats.max_depth},
+            {"pushed", stats.pushed},
+            {"dropped", stats.dropped},
+            {"mean_latency_ms", stats.mean_latency_ms},
+            {"max_latency_ms", stats.max_latency_ms}
+        };
+    };
+    //What goes out to the AVRs.
+    auto port = [](const std::string& name, const SerialStats& stats) -> json {
+        return {
+            {"name", name},
+            {"bytes_per_second", stats.bytes_per_second},
+            {"written", stats.written},
+            {"depth", stats.depth},
+            {"max_depth", stats.max_depth},
+            {"frames", stats.frames},
+            {"dropped", stats.dropped},
+            {"replaced", stats.replaced}
+        };
+    };
+    return {
+        {"id", "pipeline"},
+        {"queues", {
+            queue("lidar", rplidar->queue_stats()),
+            queue("mapping", map_worker.queue_stats()),
+            queue("telemetry", pc->outgoing_stats()),
+            queue("commands", pc->incoming_stats())
+        }},
+        {"ports", {
+            port("sensor", sensor.serial_stats()),
+            port("steering", steering.serial_stats())
+        }}
+    };
+}
+
+
+json
+Communication::latency_stats(){
+    //How old the input of the decisions was, when decided and when the steering module was told.
+    json paths = json::array();
+    for(int i = 0; i < (int)LatencyPath::COUNT; i++){
+        const LatencyHistogram& histogram = latency.histogram((LatencyPath)i);
+        paths.push_back({
+            {"name", LatencyTracer::name((LatencyPath)i)},
+            {"count", histogram.count()},
+            {"p50_ms", histogram.percentile(0.5)},
+            {"p99_ms", histogram.percentile(0.99)},
+            {"max_ms", histogram.max()}
+        });
+    }
+    return {{"id", "latency"}, {"paths", paths}};
+}
+
+
+void
+Communication::trace_decision(const SensorMeasurement& measurement, bool new_scan){
+    //Only input that is new to this decision is traced, else a stale scan would count every control period.
+    LatencyTrace trace;
+    if(measurement.time_ns != traced_sensor_ns) trace.sensor_ns = measurement.time_ns;
+    if(new_scan) trace.scan_ns = frame->completed();
+    if(trace.sensor_ns == 0 && trace.scan_ns == 0) return;
+
+    traced_sensor_ns = measurement.time_ns;
+    trace.decision_ns = monotonic_ns();
+    latency.decided(trace);
+    steering.decided(trace);
+}
+
+
+void
+Communication::step() {
+    if(!update()) loop.stop();
 }
 
 
 bool 
 Communication::update() {
-    pc->update();
-    sensor.update();
+    //Take the newest scan also in manual mode, an untaken scan keeps waking the event loop.
+    bool new_data = get_rplidar_scan();
 
     /* Separate manual and autonoumus mode and
     init autonomous mode if it not has been done. */
@@ -113,20 +284,23 @@ Communication::update() {
     }
     else {
         if(!inited_auto) {
-            autonomous_init();
+            //The sensors (and localization) get several updates to be ready, the newest scan is used up then.
+            if(!autonomous_init(new_data)) return true;
             inited_auto = true;
+            new_data = false;
         }
     }   
    
     
-    //Get measurements from sensors and rplidar.
+    //Get measurements from sensors, the sensor module is read by the event loop.
     SensorMeasurement measurement = sensor.measurement();
-    std::vector<ScanNode> curr_nodes;
-    bool new_data = false;
-    get_rplidar_scan(curr_nodes, new_data);
+
+    //Fuse everything that moved the robot since last time into one pose.
+    update_pose(measurement, new_data);
 
     //Calculate robot behaviour.
-    bool done = calc_inst(measurement, curr_nodes);
+    trace_decision(measurement, new_data);
+    bool done = calc_inst(measurement, *frame);
     if (done) return false;
 
     steering.update();
@@ -134,9 +308,11 @@ Communication::update() {
     
     //Pc communication
     if (new_data) {
-        pc->rplidar(curr_nodes);
-        pc->robot((float)x_pos/400.0f + 0.5f, (float)y_pos/400.0f + 0.5f, measurement.rot * M_PI / 180.0f);
-        std::thread(&Communication::update_map, this, curr_nodes, measurement).detach();
+        pc->rplidar(frame->nodes());
+        pc->segments(walls.last_segments());
+        update_map(frame);
+        const Pose& pose = estimator.estimate().pose;
+        pc->robot(pose.x/400.0f + 0.5f, pose.y/400.0f + 0.5f, pose.rot * M_PI / 180.0f);
         pc->map(map);
     }
 
@@ -144,123 +320,134 @@ Communication::update() {
 }
 
 
-void
-Communication::get_rplidar_scan(std::vector<ScanNode>& curr_nodes, bool& new_data){
-    static std::vector<ScanNode> old_nodes;
-
-    //Set new rplidar measurement if any, otherwise take most recent ones.
-    curr_nodes = rplidar.get_scan();
-    if (curr_nodes.empty()){
-        curr_nodes = old_nodes;
-    } 
-    else{
-        old_nodes = curr_nodes;
-        new_data = true;
-    }
+bool
+Communication::get_rplidar_scan(){
+    //Take new rplidar measurement if any, otherwise keep the most recent one.
+    ScanFramePtr new_frame = rplidar->get_scan();
+    if (!new_frame) return false;
+
+    frame = std::move(new_frame);
+    return true;
 }
 
 
-void
-Communication::autonomous_init(){
+bool
+Communication::autonomous_init(bool new_scan){
     
-    //Wait for rplidar to return values
-    std::vector<ScanNode> curr_nodes;
-    bool dummy = false;
-    while(curr_nodes.empty()) get_rplidar_scan(curr_nodes,dummy);
-  
-    //Wait for side sensor to return values
-    while(true){
-    	sensor.update();
-	if(sensor.measurement().right != 0) break;
-    }
+    //Wait for rplidar and side sensor to return values
+    if(!frame) return false;
+    if(sensor.measurement().right == 0) return false;
    
-    //Init pos and gyro
-    x_pos = 0;  
-    y_pos = 0; 
-    sensor.init_gyro(sensor.measurement().rot);
+    //Init pos and gyro, in a loaded map where the robot is in it.
+    Pose pose{0, 0, 0};
+    if(map_loaded && !localize(pose, new_scan)) return false;
+    sensor.init_gyro(sensor.measurement().rot - pose.rot);
+    sensor_count = sensor.measurement_count();
+    estimator.reset(pose, std::chrono::steady_clock::now());
+    prev_pose = pose;
+
+    //Keep driving along the axis closest to the heading.
+    int quarter = (int)std::lround(pose.rot / 90.0f);
+    target_rot = quarter * 90;
+    direction = Direction::UP;
+    for(int i = 0; i < ((quarter % 4) + 4) % 4; i++) direction = left_turn(direction);
+    return true;
 }
 
 
-float 
-Communication::get_distance_at(float angle, vector<ScanNode>& curr_nodes, float rot){
-    //Calculate rplidar angle relative to robot rotation
-    angle += rot-target_rot;
+bool
+Communication::localize(Pose& pose, bool new_scan){
+    if(!localizer){
+        localizer = std::make_unique<Localizer>(map, pool);
+        localizer->init_global();
+        localize_start = std::chrono::steady_clock::now();
+    }
 
-    //Make sure angle is between 0 and 360.
-    if(angle > 360) angle -= 360;
-    if(angle < 0) angle += 360;
+    //Weight the particles with every new scan until they have agreed for a few scans, the robot is standing still.
+    if(new_scan){
+        odometry.robot_delta(frame->nodes());
+        localizer->predict(odometry.matched() ? odometry.last_match().delta : Pose{0, 0, 0});
+        localizer->update(frame->nodes());
+    }
 
+    if(localizer->converged()){
+        pose = localizer->estimate();
+        INFO("Localized in loaded map at ", pose.x, ", ", pose.y, ", ", pose.rot, " with ", localizer->particle_count(), " particles");
+    }
+    else if(std::chrono::steady_clock::now() - localize_start > std::chrono::seconds(LOCALIZE_TIMEOUT)){
+        WARN("Could not localize in loaded map, spread: ", localizer->spread(), " mm ", localizer->rotation_spread(), " deg, effective share: ", localizer->effective_share());
+    }
+    else return false;
 
-    //static constants
-    static const float offset = 1.0;
-    static const float LOWER_LIMIT = angle - offset;
-    static const float UPPER_LIMIT = angle + offset;
+    localizer.reset();
+    return true;
+}
 
 
-    //First measurment is sometimes more then 1 deg, therefore return first measurement in list.
-    if(angle < 1) return curr_nodes[0].dist;
-   
-    //Go through nodes until the node with the given angle is found.
-    for (const ScanNode &node: curr_nodes) {
-        if (LOWER_LIMIT < node.angle && node.angle < UPPER_LIMIT) return node.dist;
-    }
+float 
+Communication::get_distance_at(float angle, const ScanFrame& frame, float rot){
+    //Calculate rplidar angle relative to robot rotation, the frame wraps it to [0, 360).
+    angle += rot-target_rot;
 
-    // returns 0.0 if no node at the given angle was found.
-    return 0.0;
+    //Nearest measurement within one degree, 0.0 if there was none (the index wraps around 0 degrees).
+    return frame.distance_at(angle, 1.0f);
 }
 
 
 void
-Communication::update_pos(vector<ScanNode>& curr_nodes, float rot){
-    int dist = get_distance_at(0.0, curr_nodes, rot);
-    
-    //Only update pos when we know the distance to the front.
-    if(dist != 0.0 ){
-        //If this is the first measurement then we have no referens point to compare with
-        if (prev_dist == 0) prev_dist = dist;
-        else {
-            float dist_delta = prev_dist - dist;
-            /*If the previous distance is bigger then the new one,
-             then set the new one as referens point and do not update posistion*/
-            if(dist_delta < 0) WARN("New distance: ",dist," was bigger than the previous: ", prev_dist);
-            /*If distance changed more then 10 cm since last measurement, 
-            then ignore last measurement and set the new one as referense point.*/
-            if(abs(dist_delta) < 100){
-                //Update target distance relative to new position.
-                if (target_dist > 0) target_dist -= prev_dist - dist;
-                //Update pos depending on direction.
-                switch(direction){
-                    case Direction::UP: {
-                        y_pos += prev_dist - dist;
-                        break;
-                    }
-                    case Direction::RIGHT: {        
-                        x_pos += prev_dist - dist;
-                        break;
-                    }
-                    case Direction::DOWN: {
-                        y_pos -= prev_dist - dist;
-                        break;
-                    }
-                    case Direction::LEFT: {
-                        x_pos -= prev_dist - dist;                   
-                        break;
-                    }   
-                }
-            }
-            //Save distance so that we can calculate the position delta next time we update the position.
-            prev_dist = dist;
+Communication::update_pose(const SensorMeasurement& measurement, bool new_scan){
+    //Move the pose with what the wheels were told to do until now.
+    estimator.predict(steering.get_control(), std::chrono::steady_clock::now());
+
+    //The gyro measures the rotation directly, but only once per measurement.
+    if (sensor.measurement_count() != sensor_count) {
+        sensor_count = sensor.measurement_count();
+        estimator.update_rotation(measurement.rot);
+    }
+
+    //Match the new scan against the previous one to get how far the robot moved.
+    if (new_scan) {
+        odometry.robot_delta(frame->nodes());
+        const IcpResult& match = odometry.last_match();
+
+        //If the scan could not be matched against the previous one only the wheels and gyro tell how far we moved.
+        if (odometry.matched()) estimator.update_odometry(match.delta, match.covariance);
+        else WARN("Scan match failed, fitness: ", match.fitness, " inliers: ", match.inlier_ratio);
+
+        //Walls keep the gyro from drifting, scans taken while turning are smeared so only use straight ones.
+        float wall_rotation;
+        const std::vector<LineSegment>& segments = walls.extract(frame->nodes());
+        if (steering.rotation == Rotation::NONE && LineExtractor::axis_rotation(segments, WALL_MIN_LENGTH, wall_rotation)) {
+            float rot = estimator.estimate().pose.rot;
+            float error = std::remainder(-wall_rotation - rot, 90.0f);
+            if (std::abs(error) < WALL_MAX_ROT_ERROR) estimator.update_rotation(rot + error, WALL_ROT_STD);
         }
     }
 }
 
 
+void
+Communication::update_pos(){
+    //Motion since last time in the robot frame, x to the right and y forward.
+    const Pose& pose = estimator.estimate().pose;
+    Pose delta = inverse(prev_pose) * pose;
+    prev_pose = pose;
+
+    //Update target distance relative to new position.
+    if (target_dist > 0) target_dist -= delta.y;
+}
+
+
 bool 
-Communication::calc_inst(SensorMeasurement& sensor_measurements, vector<ScanNode>& curr_nodes){
+Communication::calc_inst(SensorMeasurement& sensor_measurements, const ScanFrame& frame){
     static bool started = false;
+    const Pose& pose = estimator.estimate().pose;
+    float x_pos = pose.x;
+    float y_pos = pose.y;
     
-    //Check if we reached the end of the map
+    //Check if we reached the end of the map, back at the start the map can be corrected for the drift around the loop.
     if(-300 < x_pos && x_pos < 300 && -300 < y_pos && y_pos < 300 && started && (direction == Direction::UP)) {
+        map_worker.close_loop();
         return true;
     }
 
@@ -275,20 +462,20 @@ Communication::calc_inst(SensorMeasurement& sensor_measurements, vector<ScanNode
     static bool adjust_left = false;
     static float prev_rot = 0;
     
-    rot = sensor_measurements.rot;    
+    rot = pose.rot;    
     left = sensor_measurements.left;
     right = sensor_measurements.right;
 
-    float dist_front = get_distance_at(0.0, curr_nodes, rot);
-    float dist_right = get_distance_at(90.0, curr_nodes, rot);
-    float dist_down = get_distance_at(180.0, curr_nodes, rot);
-    float dist_left = get_distance_at(270.0, curr_nodes, rot);
+    float dist_front = get_distance_at(0.0, frame, rot);
+    float dist_right = get_distance_at(90.0, frame, rot);
+    float dist_down = get_distance_at(180.0, frame, rot);
+    float dist_left = get_distance_at(270.0, frame, rot);
     
 
     //Calculate robot behaviour depending on current mode and sensor measurements.
     switch(mode){    
         case Mode::MOVING: {
-            update_pos(curr_nodes, rot);
+            update_pos();
 		
             //Check if we went passed the end of the wall to the right, then turn right.
             if(right == 0){
@@ -301,12 +488,11 @@ Communication::calc_inst(SensorMeasurement& sensor_measurements, vector<ScanNode
                 correct_position();
                 mode = Mode::ROTATING_LEFT;
                 direction = left_turn(direction);
-                prev_dist = dist_left;
                 target_rot += 90;
                 steering.set_rotation(Rotation::LEFT);     
             }
         
-            steering.update_regulation(right, (rot-target_rot), regulate, get_distance_at(0.0, curr_nodes, rot));
+            steering.update_regulation(right, (rot-target_rot), regulate, get_distance_at(0.0, frame, rot));
             break; 
         }
         case Mode::ROTATING_LEFT: {
@@ -337,7 +523,7 @@ Communication::calc_inst(SensorMeasurement& sensor_measurements, vector<ScanNode
             break;
         }
         case Mode::ROTATING_RIGHT_1:{
-            update_pos(curr_nodes, rot); // Update pos only when moving forward
+            update_pos(); // Update pos only when moving forward
             //Check if rotation was initiated by a bad sensor value
             if(right != 0){
                 WARN("Right not zero: ", right);
@@ -366,7 +552,6 @@ Communication::calc_inst(SensorMeasurement& sensor_measurements, vector<ScanNode
                 }
                 mode = Mode::ROTATING_RIGHT_3;
                 target_dist = ROT_RIGHT_3_DIST;
-                prev_dist = dist_front;
                 steering.set_rotation(Rotation::NONE);
             } 
             //Check if the robot over rotated.
@@ -384,7 +569,7 @@ Communication::calc_inst(SensorMeasurement& sensor_measurements, vector<ScanNode
             break;
         }
         case Mode::ROTATING_RIGHT_3:{
-            update_pos(curr_nodes, rot);
+            update_pos();
             //Check if robot drove in towards the wall enough after right turn.
             if(target_dist <= 0){ // || dist_front < STOP_DIST){
                 regulate = true;
@@ -403,69 +588,15 @@ Communication::calc_inst(SensorMeasurement& sensor_measurements, vector<ScanNode
 
 void
 Communication::correct_position(){
-    y_pos = round(y_pos/400.0f)*400;
-    x_pos = round(x_pos/400.0f)*400;
+    //Turns start in the middle of a square, pull the estimate there.
+    const Pose& pose = estimator.estimate().pose;
+    estimator.update_position(round(pose.x/400.0f)*400, round(pose.y/400.0f)*400, CORRECT_POSITION_STD);
+    prev_pose = estimator.estimate().pose;
 }
 
 
 void 
-Communication::update_map(const std::vector<ScanNode>& nodes, const SensorMeasurement& measurement) {
-    // update internal map
-    for(const ScanNode& node : nodes){
-        // delta vector between robot and hit tile
-        float d_x = -(float)node.dist / (float)Map::TILE_SIZE * cos((-node.angle + measurement.rot - 90) * M_PI / 180.0f);
-        float d_y = -(float)node.dist / (float)Map::TILE_SIZE * sin((-node.angle + measurement.rot - 90) * M_PI / 180.0f);
-
-        // calculate coordinates, src = robot position, dst = hit position
-        float src_x = (float)x_pos/400.0f + 0.5f;
-        float src_y = (float)y_pos/400.0f + 0.5f;
-        float dst_x = d_x + src_x;
-        float dst_y = d_y + src_y;
-
-        // create a small delta vector to use for iterating through points between src and dst
-        float d = sqrt(pow(d_x, 2) + pow(d_y, 2));
-        d_x /= d;
-        d_y /= d;
-        d_x *= 0.25f;
-        d_y *= 0.25f;
-
-        // keep track of distance between src and dst
-        float current_distance = d;
-        float last_distance = d + 1.0f;
-
-        // go through tiles between src and dst and set them to empty
-        int last_col = Map::MAP_SIZE, last_row = Map::MAP_SIZE;
-
-        // keep setting to empty until distance between src and dst gets greater (meaning that src has passed dst)
-        while(current_distance <= last_distance)
-        {
-            // col and row of tile closest to src (has to be floored since (-0.5, -0.5) corresponds to tile (-1, -1)))
-            int empty_col = floor(src_x + Map::ORIGIN);
-            int empty_row = floor(src_y + Map::ORIGIN);
-
-            // only update every time a new tile is reached
-            if(empty_col != last_col || empty_row != last_row)
-            {
-                map.update(empty_col, empty_row, Tile::EMPTY);
-            }
-
-            // move src by delta
-            src_x += d_x;
-            src_y += d_y;
-
-            // update last distance and current distance
-            last_distance = current_distance;
-            current_distance = sqrt(pow(src_x - dst_x, 2) + pow(src_y - dst_y, 2));
-
-            // update last col and row
-            last_col = empty_col;
-            last_row = empty_row;
-        }
-
-        int wall_col = floor(src_x + (float)Map::ORIGIN);
-        int wall_row = floor(src_y + (float)Map::ORIGIN);
-
-        // set tile at dst to wall (is this guaranteed to be a new tile from last?)
-        map.update(wall_col, wall_row, Tile::WALL);
-    }
+Communication::update_map(const ScanFramePtr& frame) {
+    // the worker matches the scan against the map around this pose and drops the oldest queued scan if mapping falls behind
+    map_worker.push(frame, estimator.estimate().pose);
 }
@@ -20,9 +20,19 @@ creates a representation of the map, sends data to pc program.
 #include "sensor.hpp"
 #include "steering.hpp"
 #include "rplidar.hpp"
+#include "scan_source.hpp"
 #include "pc.hpp"
 #include "socket.hpp"
 #include "map.hpp"
+#include "map_worker.hpp"
+#include "scan_frame.hpp"
+#include "ai.hpp"
+#include "thread_pool.hpp"
+#include "pose_estimator.hpp"
+#include "line_extractor.hpp"
+#include "localizer.hpp"
+#include "event_loop.hpp"
+#include "latency.hpp"
 
 
 enum class RobotMode
@@ -42,56 +52,91 @@ enum class Mode : int {
 class Communication {
 
 public:
+    /*registers the modules, the pc clients and a control timer with loop, which then runs the robot.
+    rplidar is a scan source opened earlier, see open_scan_source*/
     Communication
     (
+        EventLoop& loop,
         const std::string& sensor_file,
         const std::string& steering_file,
-        const std::string& rplidar_file
+        std::unique_ptr<ScanSource> rplidar,
+        const std::string& record_file = "",
+        const std::string& load_map_file = "",
+        const std::string& save_map_file = "",
+        const std::string& latency_file = ""
     );
     ~Communication();
-    /*transmit to and receive from AVRs, returns false when stopped*/
+    /*act on what the AVRs and rplidar sent since last time, returns false when stopped*/
     bool update(); 
 
 private:
     //-------Variables-------------------
+    EventLoop& loop;
+    TimerWheel::Id control_timer;
+    TimerWheel::Id start_timer;     // pending start of autonomous mode after the competition button, 0 if none
+    TimerWheel::Id stats_timer;
     Map map;
+    bool map_loaded;        // map was loaded from a file, the robot has to localize in it before starting
+    std::string save_map_file;
+    std::string latency_file;   // where the latency histograms are written when stopped, none if empty
+    LatencyTracer latency;      // age of the sensor and rplidar input of what the steering is told
+    int64_t traced_sensor_ns;   // stamp of the sensor measurement last traced, each one is traced once
+    ThreadPool pool;
     Sensor sensor;
     Steering steering;
-    RPLidar rplidar;
+    std::unique_ptr<ScanSource> rplidar;
+    MapWorker map_worker;   // after rplidar, its queued frames must go back before the rplidar is gone
+    ScanFramePtr frame;
+    AI odometry;            // scan matching odometry, matched once per new scan
+    PoseEstimator estimator;
+    LineExtractor walls;    // wall segments of the newest scan
+    std::unique_ptr<Localizer> localizer;   // while finding the robot in a loaded map
+    std::chrono::steady_clock::time_point localize_start;
+    unsigned long long sensor_count;    // sensor measurements given to the estimator
+    Pose prev_pose;         // pose when target_dist was last updated
     std::shared_ptr<PC> pc;
     Mode mode;
     Direction direction;
     
-    int prev_dist;
-    int y_pos;
-    int x_pos;
-	int target_dist; 
+	float target_dist; 
     float start_rot; 
     float target_rot;
     RobotMode robot_mode;
 
     //------Functions----------------------------------
-    /*This function updates the position of x and y coordinate
-     and calculates and updates the position in squares.*/
-    void update_pos(std::vector<ScanNode>& nodes, float);
+    /*This function fuses new gyro, scan matching and steering data into the pose estimate.*/
+    void update_pose(const SensorMeasurement& measurement, bool new_scan);
+    /*This function updates the target distance with how far the robot moved forward since last time.*/
+    void update_pos();
     /*This function calculates what the robot should do next
     depending on the current mode and sensor values.*/
-    bool calc_inst(SensorMeasurement& sensor_measurments, vector<ScanNode>& nodes);
+    bool calc_inst(SensorMeasurement& sensor_measurments, const ScanFrame& frame);
     /*This function returns the distance at a given angle measured with rplidar,
     returns 0 if no distance at that angle.*/
-    float get_distance_at(float angle, std::vector<ScanNode>& nodes, float rot);
+    float get_distance_at(float angle, const ScanFrame& frame, float rot);
     /*This function updates the current moving direction when turning right.*/
     Direction right_turn(Direction dir);
     /*This function updates the current moving direction when turning left.*/
     Direction left_turn(Direction dir);
     /*Fix the position to the closest square */
     void correct_position();
-    /*Update map*/
-    void update_map(const std::vector<ScanNode>& nodes, const SensorMeasurement& measurement);
-    /*Starts the autonomous mode*/
-    void autonomous_init();
-    /*Get most recent rplidar scan*/
-    void get_rplidar_scan(std::vector<ScanNode>& curr_nodes, bool& new_data); 
+    /*Queue scan for the mapping worker together with the current pose*/
+    void update_map(const ScanFramePtr& frame);
+    /*Starts the autonomous mode once the sensors have values, returns false until then*/
+    bool autonomous_init(bool new_scan);
+    /*Find the robot pose in the loaded map a scan at a time, returns true when done.
+    pose is then where the robot was found, or left alone if it could not be found in time*/
+    bool localize(Pose& pose, bool new_scan);
+    /*Run update from the event loop, stops the loop when update returns false*/
+    void step();
+    /*Depth and latency of the queues between the threads, as json for the pc*/
+    nlohmann::json pipeline_stats();
+    /*Input to decision and decision to steering latencies, as json for the pc*/
+    nlohmann::json latency_stats();
+    /*Stamp the decision about to be made with the sensor measurement and scan it is based on*/
+    void trace_decision(const SensorMeasurement& measurement, bool new_scan);
+    /*Take newest scan frame if rplidar has a new one, returns true if it had one*/
+    bool get_rplidar_scan();
 };
 
 
@@ -0,0 +1,180 @@
+/*
+
+file: event_loop.cpp
+created: 2026-10-17
+
+Waits for file descriptors and timers in one epoll_wait.
+
+*/
+
+
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "event_loop.hpp"
+#include "logging.hpp"
+
+
+EventLoop::EventLoop() : epoll_fd(epoll_create1(EPOLL_CLOEXEC)), stopped(false), callbacks(), wheel()
+{
+    if(epoll_fd < 0) ERROR("event loop: epoll_create1 failed, errno ", errno);
+}
+
+EventLoop::~EventLoop()
+{
+    if(epoll_fd >= 0) close(epoll_fd);
+}
+
+
+bool EventLoop::watch(int fd, const Watch& watch, bool added)
+{
+    epoll_event event{};
+    event.events = (watch.readable ? (uint32_t)EPOLLIN : 0u) | (watch.writable ? (uint32_t)EPOLLOUT : 0u);
+    event.data.fd = fd;
+    if(epoll_ctl(epoll_fd, added ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+        WARN("event loop: could not watch fd ", fd, ", errno ", errno);
+        return false;
+    }
+    callbacks[fd] = watch;
+    return true;
+}
+
+
+bool EventLoop::add(int fd, Callback callback)
+{
+    if(fd < 0) return false;
+    auto it = callbacks.find(fd);
+    Watch updated = it != callbacks.end() ? it->second : Watch();
+    updated.readable = std::make_shared<Callback>(std::move(callback));
+    return watch(fd, updated, it != callbacks.end());
+}
+
+
+bool EventLoop::add_writable(int fd, Callback callback)
+{
+    if(fd < 0) return false;
+    auto it = callbacks.find(fd);
+    Watch updated = it != callbacks.end() ? it->second : Watch();
+    updated.writable = std::make_shared<Callback>(std::move(callback));
+    return watch(fd, updated, it != callbacks.end());
+}
+
+
+void EventLoop::remove_writable(int fd)
+{
+    auto it = callbacks.find(fd);
+    if(it == callbacks.end() || !it->second.writable) return;
+    if(!it->second.readable)
+    {
+        remove(fd);
+        return;
+    }
+    Watch updated = it->second;
+    updated.writable.reset();
+    watch(fd, updated, true);
+}
+
+
+void EventLoop::remove(int fd)
+{
+    if(callbacks.erase(fd) == 0) return;
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+
+TimerWheel& EventLoop::timers()
+{
+    return wheel;
+}
+
+
+int EventLoop::run_once(int timeout_ms)
+{
+    // wake up for the next timer
+    int timer_ms = wheel.next_timeout();
+    if(timer_ms >= 0 && (timeout_ms < 0 || timer_ms < timeout_ms)) timeout_ms = timer_ms;
+
+    epoll_event events[MAX_EVENTS];
+    int ready = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout_ms);
+    if(ready < 0)
+    {
+        if(errno != EINTR) WARN("event loop: epoll_wait failed, errno ", errno);
+        ready = 0;
+    }
+
+    int called = 0;
+    for(int i = 0; i < ready; i++)
+    {
+        // an earlier callback may have removed this fd, or the readable callback the writable one
+        int fd = events[i].data.fd;
+        uint32_t happened = events[i].events;
+        auto it = callbacks.find(fd);
+        if(it == callbacks.end()) continue;
+        std::shared_ptr<Callback> readable = it->second.readable;
+        if(readable && (happened & ~EPOLLOUT))
+        {
+            (*readable)();
+            called++;
+        }
+
+        it = callbacks.find(fd);
+        if(it == callbacks.end()) continue;
+        std::shared_ptr<Callback> writable = it->second.writable;
+        if(writable && (happened & (EPOLLOUT | EPOLLERR | EPOLLHUP)))
+        {
+            (*writable)();
+            called++;
+        }
+    }
+    return called + wheel.advance();
+}
+
+
+void EventLoop::run(std::function<bool()> keep_running)
+{
+    stopped = false;
+    while(!stopped && keep_running()) run_once();
+}
+
+
+void EventLoop::stop()
+{
+    stopped = true;
+}
+
+
+Notifier::Notifier() : event_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+    if(event_fd < 0) WARN("notifier: eventfd failed, errno ", errno);
+}
+
+Notifier::~Notifier()
+{
+    if(event_fd >= 0) close(event_fd);
+}
+
+
+void Notifier::notify()
+{
+    if(event_fd < 0) return;
+    uint64_t one = 1;
+    if(write(event_fd, &one, sizeof(one)) != sizeof(one)) return; // only fails when the counter is full, it is readable then
+}
+
+
+void Notifier::clear()
+{
+    if(event_fd < 0) return;
+    uint64_t count;
+    while(read(event_fd, &count, sizeof(count)) == sizeof(count));
+}
+
+
+int Notifier::fd() const
+{
+    return event_fd;
+}
@@ -0,0 +1,110 @@
+/*
+
+file: event_loop.hpp
+created: 2026-10-17
+
+Waits for file descriptors and timers in one epoll_wait.
+
+Callbacks are registered per file descriptor and called when it becomes
+readable, the callback has to read what is there or it is called again on
+the next wait. A writable callback can be added to an fd while there is
+something to write to it, and is called whenever the fd can take more. Timers are kept in a timer wheel, the loop waits no longer
+than until the next one expires and calls the expired ones after the fds.
+
+An event loop is used by one thread. Other threads wake it through a
+Notifier, an eventfd they write to.
+
+*/
+
+
+#ifndef EVENT_LOOP_HPP
+#define EVENT_LOOP_HPP
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+#include "timer_wheel.hpp"
+
+
+class EventLoop
+{
+public:
+    using Callback = std::function<void()>;
+
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // call callback whenever fd is readable, the fd is still owned (and closed) by the caller
+    // returns false if the fd could not be added
+    bool add(int fd, Callback callback);
+
+    // also call callback whenever fd is writable, until remove_writable or remove
+    // returns false if the fd could not be watched
+    bool add_writable(int fd, Callback callback);
+    void remove_writable(int fd);
+
+    // stop watching fd, must be called before it is closed
+    void remove(int fd);
+
+    // timers called back by this loop
+    TimerWheel& timers();
+
+    // wait at most timeout_ms (-1 waits until something happens) and call the callbacks of what is ready
+    // and of the expired timers, returns number of callbacks called
+    int run_once(int timeout_ms = -1);
+
+    // wait and call callbacks until stop is called or keep_running returns false, checked after every wait
+    void run(std::function<bool()> keep_running = [](){ return true; });
+    void stop();
+
+    const static int MAX_EVENTS = 16;   // ready fds handled per wait, the rest are handled by the next one
+
+private:
+    int epoll_fd;
+    bool stopped;
+
+    // callbacks of an fd, either may be empty
+    struct Watch
+    {
+        std::shared_ptr<Callback> readable;
+        std::shared_ptr<Callback> writable;
+    };
+
+    // update what epoll waits for on fd to what it has callbacks for
+    bool watch(int fd, const Watch& watch, bool added);
+
+    // shared so a callback removing itself or others while the ready ones are called is fine
+    std::unordered_map<int, Watch> callbacks;
+    TimerWheel wheel;
+};
+
+
+// lets another thread wake an event loop
+class Notifier
+{
+public:
+    Notifier();
+    ~Notifier();
+
+    Notifier(const Notifier&) = delete;
+    Notifier& operator=(const Notifier&) = delete;
+
+    // make fd readable, safe from any thread
+    void notify();
+
+    // read the fd until it is no longer readable
+    void clear();
+
+    // fd to add to an event loop, -1 if it could not be created
+    int fd() const;
+
+private:
+    int event_fd;
+};
+
+#endif // EVENT_LOOP_HPP
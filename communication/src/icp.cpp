@@ -0,0 +1,252 @@
+/*
+
+file: icp.cpp
+created: 2026-10-17
+
+2D iterative closest point scan matching.
+
+*/
+
+
+#include <cmath>
+#include <algorithm>
+
+#include "icp.hpp"
+
+
+ICP::ICP(const IcpConfig& config) : config(config), bin_start(BINS + 1, 0) {}
+
+
+const IcpConfig& ICP::get_config() const
+{
+    return config;
+}
+
+
+std::vector<Vec2> ICP::to_points(const std::vector<ScanNode>& nodes, int max_points)
+{
+    size_t valid = 0;
+    for(const ScanNode& node : nodes) if(node.dist != 0) valid++;
+    size_t stride = max_points > 0 ? std::max<size_t>(1, (valid + max_points - 1) / max_points) : 1;
+
+    // same convention as the map, rplidar angles go clockwise from the front
+    std::vector<Vec2> points;
+    points.reserve(valid / stride + 1);
+    size_t i = 0;
+    for(const ScanNode& node : nodes)
+    {
+        if(node.dist == 0) continue;
+        if(i++ % stride != 0) continue;
+        float a = node.angle * (float)M_PI / 180.0f;
+        points.emplace_back(node.dist * std::sin(a), node.dist * std::cos(a));
+    }
+    return points;
+}
+
+
+int ICP::bin_of(const Vec2& p)
+{
+    float bearing = std::atan2(p.y, p.x) + (float)M_PI;
+    int b = (int)(bearing * BINS / (2.0f * (float)M_PI));
+    return std::min(std::max(b, 0), BINS - 1);
+}
+
+
+void ICP::index(const std::vector<Vec2>& reference)
+{
+    // counting sort by bearing
+    std::fill(bin_start.begin(), bin_start.end(), 0);
+    order.resize(reference.size());
+    for(size_t i = 0; i < reference.size(); i++)
+    {
+        order[i] = bin_of(reference[i]);
+        bin_start[order[i] + 1]++;
+    }
+    for(int b = 0; b < BINS; b++) bin_start[b + 1] += bin_start[b];
+
+    ref.resize(reference.size());
+    std::vector<int> fill(bin_start.begin(), bin_start.end() - 1);
+    for(size_t i = 0; i < reference.size(); i++) ref[fill[order[i]]++] = reference[i];
+
+    // normal of the line through the neighbours by bearing, wrapping around the scan
+    size_t n = ref.size();
+    normals.resize(n);
+    for(size_t i = 0; i < n; i++)
+    {
+        Vec2 d = ref[(i + 1) % n] - ref[(i + n - 1) % n];
+        float len = d.length();
+        normals[i] = len > 0 ? Vec2(-d.y / len, d.x / len) : Vec2(0, 0);
+    }
+}
+
+
+int ICP::nearest(const Vec2& p) const
+{
+    int best = -1;
+    float best_dist = config.max_distance * config.max_distance;
+    float range = p.length();
+    float bin_angle = 2.0f * (float)M_PI / BINS;
+    int center = bin_of(p);
+
+    // walk outwards from the bearing of p, points k buckets away are at least
+    // (k - 1) buckets off in bearing so they can be no closer than range * sin of that
+    for(int k = 0; k <= BINS / 2; k++)
+    {
+        float off = std::min((k - 1) * bin_angle, (float)M_PI / 2);
+        float bound = k > 1 ? range * std::sin(off) : 0.0f;
+        if(bound * bound >= best_dist) break;
+
+        for(int side = 0; side < (k == 0 || k == BINS / 2 ? 1 : 2); side++)
+        {
+            int b = (center + (side ? -k : k) + BINS) % BINS;
+            for(int i = bin_start[b]; i < bin_start[b + 1]; i++)
+            {
+                Vec2 d = ref[i] - p;
+                float dist = d.dot(d);
+                if(dist < best_dist)
+                {
+                    best_dist = dist;
+                    best = i;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+
+IcpResult ICP::match(const std::vector<Vec2>& reference, const std::vector<Vec2>& scan, const Pose& guess)
+{
+    IcpResult result;
+    result.delta = guess;
+    result.covariance = Eigen::Matrix3f::Identity() * 1e6f;
+    result.fitness = 0.0f;
+    result.inlier_ratio = 0.0f;
+    result.iterations = 0;
+    result.converged = false;
+    if(reference.size() < 2 || scan.empty()) return result;
+
+    index(reference);
+    moved.resize(scan.size());
+
+    bool point_to_line = config.metric == IcpMetric::POINT_TO_LINE;
+    Eigen::Matrix3f H;
+    float error = 0.0f;
+    int inliers = 0;
+
+    for(result.iterations = 1; result.iterations <= config.max_iterations; result.iterations++)
+    {
+        float r = result.delta.rot * (float)M_PI / 180.0f;
+        float c = std::cos(r), s = std::sin(r);
+        for(size_t i = 0; i < scan.size(); i++)
+        {
+            const Vec2& p = scan[i];
+            moved[i] = Vec2(c*p.x - s*p.y + result.delta.x, s*p.x + c*p.y + result.delta.y);
+        }
+
+        // Gauss-Newton normal equations of the step (dx, dy, dtheta) applied on top of the estimate,
+        // point to point has one row per axis, point to line one row along the normal
+        H.setZero();
+        Eigen::Vector3f g = Eigen::Vector3f::Zero();
+        Vec2 mean_p, mean_q;
+        Eigen::Matrix2f cross = Eigen::Matrix2f::Zero();
+        error = 0.0f;
+        inliers = 0;
+
+        for(size_t i = 0; i < scan.size(); i++)
+        {
+            const Vec2& p = moved[i];
+            int j = nearest(p);
+            if(j < 0) continue;
+            const Vec2& q = ref[j];
+
+            if(point_to_line)
+            {
+                const Vec2& n = normals[j];
+                if(n.x == 0 && n.y == 0) continue;
+                float res = n.dot(p - q);
+                Eigen::Vector3f J(n.x, n.y, n.y * p.x - n.x * p.y);
+                H += J * J.transpose();
+                g += J * res;
+                error += res * res;
+            }
+            else
+            {
+                Vec2 d = p - q;
+                Eigen::Vector3f Jx(1, 0, -p.y), Jy(0, 1, p.x);
+                H += Jx * Jx.transpose() + Jy * Jy.transpose();
+                g += Jx * d.x + Jy * d.y;
+                error += d.dot(d);
+                mean_p += p;
+                mean_q += q;
+                cross += Eigen::Vector2f(p.x, p.y) * Eigen::Vector2f(q.x, q.y).transpose();
+            }
+            inliers++;
+        }
+
+        if(inliers < config.min_inliers) return result;
+
+        float step_x, step_y, step_rot;
+        if(point_to_line)
+        {
+            // slightly damped so a corridor (all normals parallel) does not slide along the walls
+            Eigen::Matrix3f damped = H;
+            damped.diagonal() *= 1.0f + 1e-3f;
+            damped.diagonal().array() += 1e-6f;
+            Eigen::Vector3f step = damped.ldlt().solve(-g);
+            step_x = step(0);
+            step_y = step(1);
+            step_rot = step(2);
+        }
+        else
+        {
+            // closed form rigid alignment of the centered point sets
+            mean_p = mean_p / (float)inliers;
+            mean_q = mean_q / (float)inliers;
+            cross -= (float)inliers * Eigen::Vector2f(mean_p.x, mean_p.y) * Eigen::Vector2f(mean_q.x, mean_q.y).transpose();
+            step_rot = std::atan2(cross(0, 1) - cross(1, 0), cross(0, 0) + cross(1, 1));
+            float sc = std::cos(step_rot), ss = std::sin(step_rot);
+            step_x = mean_q.x - (sc*mean_p.x - ss*mean_p.y);
+            step_y = mean_q.y - (ss*mean_p.x + sc*mean_p.y);
+        }
+
+        // the step moves the already transformed points, so it goes after the current estimate
+        result.delta = Pose{step_x, step_y, step_rot * 180.0f / (float)M_PI} * result.delta;
+
+        if(std::hypot(step_x, step_y) < config.min_translation && std::abs(step_rot) * 180.0f / (float)M_PI < config.min_rotation)
+        {
+            result.converged = true;
+            break;
+        }
+    }
+    result.iterations = std::min(result.iterations, config.max_iterations);
+
+    // residual variance over the remaining degrees of freedom scales the inverse information
+    int rows = point_to_line ? inliers : 2 * inliers;
+    float variance = rows > 3 ? error / (rows - 3) : error;
+    result.covariance = variance * (H + Eigen::Matrix3f::Identity() * 1e-6f).inverse();
+    result.fitness = error / inliers;
+    result.inlier_ratio = (float)inliers / scan.size();
+    return result;
+}
+
+
+IcpResult ICP::get_delta(const std::vector<Vec2>& points)
+{
+    IcpResult result;
+    if(previous.empty())
+    {
+        result.delta = Pose{0, 0, 0};
+        result.covariance = Eigen::Matrix3f::Identity() * 1e6f;
+        result.fitness = 0.0f;
+        result.inlier_ratio = 0.0f;
+        result.iterations = 0;
+        result.converged = false;
+    }
+    else
+    {
+        result = match(previous, points);
+    }
+    previous = points;
+    return result;
+}
@@ -0,0 +1,122 @@
+/*
+
+file: icp.hpp
+created: 2026-10-17
+
+2D iterative closest point scan matching.
+
+Finds the rigid motion (SE(2)) that aligns a scan with a reference scan,
+either by minimizing point to point distances or the distances from the
+scan points to the lines through the reference points (point to line,
+converges in a few iterations on the walls of the maze).
+
+Correspondences are found through the bearing: reference points are bucketed
+by bearing from the reference origin and the search for the nearest one starts
+at the bearing of the scan point and stops as soon as the buckets further away
+can not hold anything closer. Consecutive scans move little, so this usually
+only looks at a handful of buckets per point.
+
+*/
+
+
+#ifndef ICP_HPP
+#define ICP_HPP
+
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "pose.hpp"
+#include "scan_frame.hpp"
+#include "vec2.hpp"
+
+
+enum class IcpMetric
+{
+    POINT_TO_POINT,
+    POINT_TO_LINE
+};
+
+
+struct IcpConfig
+{
+    IcpMetric metric = IcpMetric::POINT_TO_LINE;
+    int max_iterations = 20;
+    float max_distance = 200.0f;        // mm, farther correspondences are outliers
+    float min_translation = 0.05f;      // mm, converged when a step moves less than this...
+    float min_rotation = 0.005f;        // degrees, ...and turns less than this
+    int max_points = 360;               // scans are thinned to at most this many points
+    int min_inliers = 3;                // fewer correspondences than this and the match fails
+};
+
+
+struct IcpResult
+{
+    // motion taking the scan frame to the reference frame, x, y in mm and rot in degrees
+    Pose delta;
+
+    // covariance of (x, y, rot) in mm and radians
+    Eigen::Matrix3f covariance;
+
+    // mean squared residual of the inliers in mm^2
+    float fitness;
+
+    // fraction of scan points that had a correspondence
+    float inlier_ratio;
+
+    int iterations;
+    bool converged;
+};
+
+
+class ICP
+{
+public:
+    ICP(const IcpConfig& config = IcpConfig());
+
+    // align a scan with a reference scan, both in their own robot frame
+    // reference: reference points in mm
+    // scan: points to align in mm
+    // guess: initial estimate of the motion
+    IcpResult match(const std::vector<Vec2>& reference, const std::vector<Vec2>& scan, const Pose& guess = Pose{0, 0, 0});
+
+    // motion since the previous call, the points become the reference for the next call
+    // the first call has nothing to match against and returns a zero delta that is not converged
+    // points: scan points in mm
+    IcpResult get_delta(const std::vector<Vec2>& points);
+
+    // scan points in the robot frame in mm, x to the right and y forward, failed measurements are skipped
+    // nodes: rplidar scan
+    // max_points: the scan is thinned evenly to at most this many points, 0 to keep all
+    static std::vector<Vec2> to_points(const std::vector<ScanNode>& nodes, int max_points = 0);
+
+    const IcpConfig& get_config() const;
+
+private:
+    // bucket reference points by bearing and estimate their normals
+    void index(const std::vector<Vec2>& reference);
+
+    // nearest reference point, -1 if none within max_distance
+    int nearest(const Vec2& p) const;
+
+    // bucket of a point by bearing
+    static int bin_of(const Vec2& p);
+
+    const static int BINS = 720;        // 0.5 degree buckets
+
+    IcpConfig config;
+
+    // reference points sorted by bearing, their unit normals and the first point of each bucket
+    std::vector<Vec2> ref;
+    std::vector<Vec2> normals;
+    std::vector<int> bin_start;
+
+    // previous points for get_delta
+    std::vector<Vec2> previous;
+
+    // scratch space reused between matches
+    std::vector<int> order;
+    std::vector<Vec2> moved;
+};
+
+#endif // ICP_HPP
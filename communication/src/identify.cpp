@@ -0,0 +1,158 @@
+/*
+
+file: identify.cpp
+created: 2026-10-17
+
+Finds which serial port the sensor module, the steering module and the
+rplidar are on.
+
+*/
+
+
+#include <errno.h>
+#include <glob.h>
+#include <poll.h>
+#include <dirent.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <memory>
+
+#include "identify.hpp"
+#include "module.hpp"
+#include "serial.hpp"
+#include "serial_frame.hpp"
+#include "logging.hpp"
+
+
+// longest poll, so keep_going is checked often enough
+#define IDENTIFY_POLL 100
+
+
+std::vector<SerialPort> serial_ports(const std::string& by_id_dir, const std::string& pattern)
+{
+    std::vector<SerialPort> ports;
+
+    // stable names that tell what is behind each port
+    DIR* dir = opendir(by_id_dir.c_str());
+    if(dir)
+    {
+        while(dirent* entry = readdir(dir))
+        {
+            std::string id = entry->d_name;
+            if(id == "." || id == "..") continue;
+            char file[PATH_MAX];
+            if(realpath((by_id_dir + "/" + id).c_str(), file)) ports.push_back({file, id});
+        }
+        closedir(dir);
+    }
+
+    if(ports.empty())
+    {
+        glob_t matches;
+        if(glob(pattern.c_str(), 0, nullptr, &matches) == 0)
+        {
+            for(size_t i = 0; i < matches.gl_pathc; i++) ports.push_back({matches.gl_pathv[i], ""});
+        }
+        globfree(&matches);
+    }
+
+    std::sort(ports.begin(), ports.end(), [](const SerialPort& a, const SerialPort& b){ return a.file < b.file; });
+    return ports;
+}
+
+
+bool is_rplidar_port(const SerialPort& port)
+{
+    return port.id.find("CP210") != std::string::npos;
+}
+
+
+bool identify_modules
+(
+    const std::vector<SerialPort>& ports,
+    ModulePorts& found,
+    std::chrono::milliseconds timeout,
+    const std::function<bool()>& keep_going,
+    const std::function<void(const std::string&)>& on_rplidar
+)
+{
+    found = ModulePorts();
+
+    // the rplidar port is left alone, whoever connects to it sets it up for the rplidar
+    std::vector<std::unique_ptr<Serial>> serials;
+    for(const SerialPort& port : ports)
+    {
+        if(found.rplidar.empty() && is_rplidar_port(port))
+        {
+            found.rplidar = port.file;
+            TRACE("rplidar device identified at ", port.file, " by its name");
+            on_rplidar(port.file);
+            continue;
+        }
+        std::unique_ptr<Serial> serial(new Serial());
+        serial->open(port.file);
+        if(serial->get_fd() >= 0) serials.push_back(std::move(serial));
+    }
+
+    std::vector<pollfd> fds(serials.size());
+    std::vector<FrameParser> parsers(serials.size());
+    for(size_t i = 0; i < serials.size(); i++) fds[i] = pollfd{serials[i]->get_fd(), POLLIN, 0};
+
+    // wait for module ids on all ports at once, an identified port is not polled any more
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while((found.sensor.empty() || found.steering.empty()) && keep_going())
+    {
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if(left <= 0) break;
+        int ready = poll(fds.data(), fds.size(), std::min<long>(left, IDENTIFY_POLL));
+        if(ready < 0 && errno != EINTR)
+        {
+            WARN("identify modules: poll failed, errno ", errno);
+            break;
+        }
+
+        for(size_t i = 0; i < fds.size() && ready > 0; i++)
+        {
+            if(fds[i].fd < 0 || !(fds[i].revents & POLLIN)) continue;
+            parsers[i].fill(fds[i].fd);
+            SerialFrame frame;
+            while(fds[i].fd >= 0 && parsers[i].next(frame))
+            {
+                if(frame.type != (uint8_t)FrameType::MODULE_ID || frame.length != 1) continue;
+                uint8_t id = frame.payload[0];
+                if(id != SENSOR && id != STEERING) continue;
+                std::string& module = id == SENSOR ? found.sensor : found.steering;
+                if(!module.empty()) continue;
+                module = serials[i]->get_file();
+                TRACE(id == SENSOR ? "sensor" : "steering", " module identified at ", module);
+                fds[i].fd = -1;
+            }
+        }
+    }
+
+    // the rplidar is on the port that is not a module
+    if(found.rplidar.empty() && !found.sensor.empty() && !found.steering.empty())
+    {
+        for(size_t i = 0; i < fds.size(); i++)
+        {
+            if(fds[i].fd < 0) continue;
+            if(!found.rplidar.empty())
+            {
+                WARN("identify modules: ", serials[i]->get_file(), " is not used, the rplidar is taken to be at ", found.rplidar);
+                continue;
+            }
+            found.rplidar = serials[i]->get_file();
+        }
+        if(!found.rplidar.empty())
+        {
+            TRACE("rplidar device identified at ", found.rplidar);
+            for(auto& serial : serials) serial->close();
+            serials.clear();
+            on_rplidar(found.rplidar);
+        }
+    }
+
+    for(auto& serial : serials) serial->close();
+    return !found.sensor.empty() && !found.steering.empty();
+}
@@ -0,0 +1,65 @@
+/*
+
+file: identify.hpp
+created: 2026-10-17
+
+Finds which serial port the sensor module, the steering module and the
+rplidar are on.
+
+The AVR modules send module id frames every 100 ms until they are told
+they are identified. All candidate ports are opened at once and waited on
+with one poll, so both modules are found as soon as each has sent its first
+id, in whatever order they boot, and no core is spent spinning meanwhile.
+
+The rplidar never sends an id. Its port is known right away if its USB
+bridge shows in /dev/serial/by-id, otherwise it is the port left when both
+modules are found. Either way it is handed to on_rplidar as soon as it is
+known, so the rplidar can be connected to and spun up while the rest of
+the startup goes on.
+
+*/
+
+
+#ifndef IDENTIFY_HPP
+#define IDENTIFY_HPP
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+struct SerialPort
+{
+    std::string file;   // device, e.g. /dev/ttyUSB0
+    std::string id;     // name in /dev/serial/by-id, empty if not known
+};
+
+
+struct ModulePorts
+{
+    std::string sensor;
+    std::string steering;
+    std::string rplidar;    // empty if no port was left for it
+};
+
+
+// ports in by_id_dir if there are any, otherwise the devices matching pattern
+std::vector<SerialPort> serial_ports(const std::string& by_id_dir = "/dev/serial/by-id", const std::string& pattern = "/dev/ttyUSB*");
+
+// whether port is the rplidar's USB to UART bridge (a Silicon Labs CP210x) by its by-id name
+bool is_rplidar_port(const SerialPort& port);
+
+// identify the modules on ports within timeout, or until keep_going returns false (checked at least every 100 ms).
+// on_rplidar is called with the rplidar port as soon as it is known.
+// returns true if both modules were found
+bool identify_modules
+(
+    const std::vector<SerialPort>& ports,
+    ModulePorts& found,
+    std::chrono::milliseconds timeout,
+    const std::function<bool()>& keep_going,
+    const std::function<void(const std::string&)>& on_rplidar
+);
+
+#endif // IDENTIFY_HPP
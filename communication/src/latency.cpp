@@ -0,0 +1,169 @@
+/*
+
+file: latency.cpp
+created: 2026-10-17
+
+Latency histograms from sensor and rplidar input to steering output.
+
+*/
+
+
+#include <time.h>
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+
+#include "latency.hpp"
+
+
+int64_t monotonic_ns()
+{
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (int64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+
+LatencyHistogram::LatencyHistogram() : counts(BUCKETS, 0), total(0), sum_ns(0), max_ns(0)
+{
+
+}
+
+
+size_t LatencyHistogram::bucket_of(uint64_t us)
+{
+    // below 2^SUB_BITS every us has a bucket, above that the top SUB_BITS bits after the leading one pick it
+    if(us < (1u << SUB_BITS)) return us;
+    int exponent = 63 - __builtin_clzll(us);
+    size_t sub = (us >> (exponent - SUB_BITS)) & ((1u << SUB_BITS) - 1);
+    return ((size_t)(exponent - SUB_BITS + 1) << SUB_BITS) + sub;
+}
+
+
+uint64_t LatencyHistogram::lower_bound(size_t bucket)
+{
+    if(bucket < (1u << SUB_BITS)) return bucket;
+    int exponent = (bucket >> SUB_BITS) + SUB_BITS - 1;
+    uint64_t sub = bucket & ((1u << SUB_BITS) - 1);
+    return ((uint64_t)1 << exponent) + (sub << (exponent - SUB_BITS));
+}
+
+
+void LatencyHistogram::record(int64_t ns)
+{
+    ns = std::max<int64_t>(0, ns);
+    counts[bucket_of(ns / 1000)]++;
+    total++;
+    sum_ns += ns;
+    max_ns = std::max(max_ns, ns);
+}
+
+
+unsigned long long LatencyHistogram::count() const
+{
+    return total;
+}
+
+
+double LatencyHistogram::percentile(double p) const
+{
+    if(total == 0) return 0;
+    unsigned long long rank = std::max<unsigned long long>(1, (unsigned long long)std::ceil(p * total));
+    unsigned long long seen = 0;
+    for(size_t bucket = 0; bucket < BUCKETS; bucket++)
+    {
+        seen += counts[bucket];
+        if(seen < rank) continue;
+
+        // middle of the bucket, never above what was recorded
+        double low = lower_bound(bucket);
+        double high = bucket + 1 < BUCKETS ? lower_bound(bucket + 1) : low;
+        return std::min((low + high) / 2.0 / 1000.0, max());
+    }
+    return max();
+}
+
+
+double LatencyHistogram::max() const
+{
+    return max_ns / 1e6;
+}
+
+
+double LatencyHistogram::mean() const
+{
+    return total > 0 ? sum_ns / 1e6 / total : 0;
+}
+
+
+std::vector<std::pair<uint64_t, unsigned long long>> LatencyHistogram::buckets() const
+{
+    std::vector<std::pair<uint64_t, unsigned long long>> result;
+    for(size_t bucket = 0; bucket < BUCKETS; bucket++)
+    {
+        if(counts[bucket] > 0) result.push_back({lower_bound(bucket), counts[bucket]});
+    }
+    return result;
+}
+
+
+void LatencyTracer::record(LatencyPath path, int64_t from_ns, int64_t to_ns)
+{
+    if(from_ns == 0 || to_ns == 0) return;
+    histograms[(int)path].record(to_ns - from_ns);
+}
+
+
+void LatencyTracer::decided(const LatencyTrace& trace)
+{
+    record(LatencyPath::SENSOR_TO_DECISION, trace.sensor_ns, trace.decision_ns);
+    record(LatencyPath::SCAN_TO_DECISION, trace.scan_ns, trace.decision_ns);
+}
+
+
+void LatencyTracer::written(const LatencyTrace& trace, int64_t write_ns)
+{
+    record(LatencyPath::DECISION_TO_WRITE, trace.decision_ns, write_ns);
+    record(LatencyPath::SENSOR_TO_WRITE, trace.sensor_ns, write_ns);
+    record(LatencyPath::SCAN_TO_WRITE, trace.scan_ns, write_ns);
+}
+
+
+const LatencyHistogram& LatencyTracer::histogram(LatencyPath path) const
+{
+    return histograms[(int)path];
+}
+
+
+const char* LatencyTracer::name(LatencyPath path)
+{
+    switch(path)
+    {
+        case LatencyPath::SENSOR_TO_DECISION: return "sensor_to_decision";
+        case LatencyPath::SCAN_TO_DECISION: return "scan_to_decision";
+        case LatencyPath::DECISION_TO_WRITE: return "decision_to_write";
+        case LatencyPath::SENSOR_TO_WRITE: return "sensor_to_write";
+        case LatencyPath::SCAN_TO_WRITE: return "scan_to_write";
+        default: return "unknown";
+    }
+}
+
+
+bool LatencyTracer::dump(const std::string& file) const
+{
+    std::ofstream out(file);
+    if(!out) return false;
+
+    // one summary line per path, then its buckets as "lower bound in us: count"
+    for(int i = 0; i < (int)LatencyPath::COUNT; i++)
+    {
+        const LatencyHistogram& histogram = histograms[i];
+        out << name((LatencyPath)i) << " count " << histogram.count()
+            << " p50 " << histogram.percentile(0.5) << " ms"
+            << " p99 " << histogram.percentile(0.99) << " ms"
+            << " max " << histogram.max() << " ms"
+            << " mean " << histogram.mean() << " ms\n";
+        for(const auto& [lower, count] : histogram.buckets()) out << "    " << lower << " us: " << count << "\n";
+    }
+    return (bool)out;
+}
@@ -0,0 +1,106 @@
+/*
+
+file: latency.hpp
+created: 2026-10-17
+
+Latency histograms from sensor and rplidar input to steering output.
+
+Sensor measurements are stamped when their first byte is read and scans
+when the rplidar driver hands over the complete scan. Each decision the
+control loop makes is stamped with the input it was based on, and when the
+steering writes the resulting PWM to the AVR the age of every stamp is
+recorded in the histogram of its path.
+
+Histograms have eight buckets per power of two microseconds, so
+percentiles are within about 6% of the true value. The max is exact.
+Recording is done on the control thread only.
+
+*/
+
+
+#ifndef LATENCY_HPP
+#define LATENCY_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+// CLOCK_MONOTONIC time in ns
+int64_t monotonic_ns();
+
+
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(int64_t ns);
+
+    unsigned long long count() const;
+
+    // latency in ms that p (0-1) of the recorded latencies are at or below, 0 if none were recorded
+    double percentile(double p) const;
+    double max() const;
+    double mean() const;
+
+    // (lower bound in us, count) of every bucket that has something in it
+    std::vector<std::pair<uint64_t, unsigned long long>> buckets() const;
+
+private:
+    static size_t bucket_of(uint64_t us);
+    static uint64_t lower_bound(size_t bucket);
+
+    const static int SUB_BITS = 3;      // 2^3 buckets per power of two
+    const static size_t BUCKETS = (64 - SUB_BITS + 1) << SUB_BITS;
+
+    std::vector<unsigned long long> counts;
+    unsigned long long total;
+    int64_t sum_ns;
+    int64_t max_ns;
+};
+
+
+// the stamps a steering decision was based on, 0 when not known
+struct LatencyTrace
+{
+    int64_t sensor_ns = 0;      // first byte of the sensor measurement read
+    int64_t scan_ns = 0;        // scan complete
+    int64_t decision_ns = 0;    // control loop decided
+};
+
+
+enum class LatencyPath : int
+{
+    SENSOR_TO_DECISION = 0,
+    SCAN_TO_DECISION = 1,
+    DECISION_TO_WRITE = 2,
+    SENSOR_TO_WRITE = 3,
+    SCAN_TO_WRITE = 4,
+    COUNT = 5
+};
+
+
+class LatencyTracer
+{
+public:
+    // a decision was made at trace.decision_ns from the stamped input
+    void decided(const LatencyTrace& trace);
+
+    // the decision was written to the AVR at write_ns
+    void written(const LatencyTrace& trace, int64_t write_ns);
+
+    const LatencyHistogram& histogram(LatencyPath path) const;
+    static const char* name(LatencyPath path);
+
+    // write p50, p99, max and the buckets of every path to file, returns false if it could not be written
+    bool dump(const std::string& file) const;
+
+private:
+    void record(LatencyPath path, int64_t from_ns, int64_t to_ns);
+
+    LatencyHistogram histograms[(int)LatencyPath::COUNT];
+};
+
+#endif // LATENCY_HPP
@@ -0,0 +1,93 @@
+/*
+
+file: likelihood_field.cpp
+created: 2026-10-17
+
+Likelihood of a scan point landing at a position, given a map.
+
+*/
+
+
+#include <algorithm>
+
+#include "likelihood_field.hpp"
+
+
+LikelihoodField::LikelihoodField(const Map& map, float sigma, float max_distance) :
+    inv_cell_size(1.0f / map.cell_size()), cell_size(map.cell_size()), max_distance(max_distance),
+    origin_col(0), origin_row(0), cols(0), rows(0), has_walls(false)
+{
+    int min_col, min_row, max_col, max_row;
+    if(!map.extent(min_col, min_row, max_col, max_row)) return;
+
+    // room around the map for points just outside it
+    int margin = (int)std::ceil(max_distance / cell_size);
+    origin_col = min_col - margin;
+    origin_row = min_row - margin;
+    cols = max_col - min_col + 1 + 2 * margin;
+    rows = max_row - min_row + 1 + 2 * margin;
+
+    std::vector<int8_t> log_odds((size_t)cols * rows);
+    map.read(origin_col, origin_row, cols, rows, log_odds.data());
+
+    // two pass chamfer distance transform (3-4 weights, within 8% of euclidean), in thirds of a cell
+    const float far = 1e9f;
+    distances.resize(log_odds.size());
+    int8_t wall = map.occupancy_config().wall_threshold;
+    for(size_t i = 0; i < log_odds.size(); i++)
+    {
+        distances[i] = log_odds[i] >= wall ? 0.0f : far;
+        if(log_odds[i] >= wall) has_walls = true;
+    }
+    for(int r = 0; r < rows; r++)
+    {
+        for(int c = 0; c < cols; c++)
+        {
+            float& d = distances[r * cols + c];
+            if(c > 0) d = std::min(d, distances[r * cols + c - 1] + 3);
+            if(r > 0)
+            {
+                d = std::min(d, distances[(r - 1) * cols + c] + 3);
+                if(c > 0) d = std::min(d, distances[(r - 1) * cols + c - 1] + 4);
+                if(c < cols - 1) d = std::min(d, distances[(r - 1) * cols + c + 1] + 4);
+            }
+        }
+    }
+    for(int r = rows - 1; r >= 0; r--)
+    {
+        for(int c = cols - 1; c >= 0; c--)
+        {
+            float& d = distances[r * cols + c];
+            if(c < cols - 1) d = std::min(d, distances[r * cols + c + 1] + 3);
+            if(r < rows - 1)
+            {
+                d = std::min(d, distances[(r + 1) * cols + c] + 3);
+                if(c < cols - 1) d = std::min(d, distances[(r + 1) * cols + c + 1] + 4);
+                if(c > 0) d = std::min(d, distances[(r + 1) * cols + c - 1] + 4);
+            }
+        }
+    }
+
+    field.resize(distances.size());
+    for(size_t i = 0; i < distances.size(); i++)
+    {
+        float d = std::min(distances[i] * cell_size / 3.0f, max_distance);
+        distances[i] = d;
+        field[i] = d >= max_distance ? 0.0f : std::exp(-d * d / (2.0f * sigma * sigma));
+    }
+}
+
+
+float LikelihoodField::distance(float x, float y) const
+{
+    int col = (int)std::floor(x * inv_cell_size + 0.5f) - origin_col;
+    int row = (int)std::floor(y * inv_cell_size + 0.5f) - origin_row;
+    if(col < 0 || row < 0 || col >= cols || row >= rows) return max_distance;
+    return distances[row * cols + col];
+}
+
+
+bool LikelihoodField::valid() const
+{
+    return has_walls;
+}
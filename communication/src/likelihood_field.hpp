@@ -0,0 +1,59 @@
+/*
+
+file: likelihood_field.hpp
+created: 2026-10-17
+
+Likelihood of a scan point landing at a position, given a map.
+
+The distance from every cell to the nearest wall is computed once with a
+chamfer distance transform and turned into a Gaussian likelihood, so scoring
+a beam is a single lookup instead of a ray cast. Meant for maps that do not
+change while they are used, like a saved map during localization.
+
+*/
+
+
+#ifndef LIKELIHOOD_FIELD_HPP
+#define LIKELIHOOD_FIELD_HPP
+
+#include <cmath>
+#include <vector>
+
+#include "map.hpp"
+
+
+class LikelihoodField
+{
+public:
+    // map: map to take the walls from, only read while building
+    // sigma: standard deviation in mm of scan points around walls
+    // max_distance: mm, farther from the walls the likelihood is zero
+    LikelihoodField(const Map& map, float sigma = 50.0f, float max_distance = 500.0f);
+
+    // likelihood (0 to 1) of a point in mm, 0 outside the map
+    float at(float x, float y) const
+    {
+        int col = (int)std::floor(x * inv_cell_size + 0.5f) - origin_col;
+        int row = (int)std::floor(y * inv_cell_size + 0.5f) - origin_row;
+        if(col < 0 || row < 0 || col >= cols || row >= rows) return 0.0f;
+        return field[row * cols + col];
+    }
+
+    // distance in mm from the cell of a point to the nearest wall, capped at max_distance
+    float distance(float x, float y) const;
+
+    // true if the map had any walls
+    bool valid() const;
+
+private:
+    float inv_cell_size;
+    float cell_size;
+    float max_distance;
+    int origin_col, origin_row;
+    int cols, rows;
+    std::vector<float> distances;   // mm
+    std::vector<float> field;
+    bool has_walls;
+};
+
+#endif // LIKELIHOOD_FIELD_HPP
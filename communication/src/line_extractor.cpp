@@ -0,0 +1,260 @@
+/*
+
+file: line_extractor.cpp
+created: 2026-10-17
+
+Wall segments from rplidar scans.
+
+*/
+
+
+#include <cmath>
+#include <algorithm>
+
+#include "line_extractor.hpp"
+
+
+LineExtractor::LineExtractor(const LineExtractorConfig& config) :
+    config(config)
+{
+
+}
+
+
+const LineExtractorConfig& LineExtractor::get_config() const
+{
+    return config;
+}
+
+
+const std::vector<LineSegment>& LineExtractor::last_segments() const
+{
+    return segments;
+}
+
+
+const std::vector<LineSegment>& LineExtractor::extract(const std::vector<ScanNode>& nodes)
+{
+    points.clear();
+    fits.clear();
+    segments.clear();
+
+    // points in angle order, same convention as the map, rplidar angles go clockwise from the front
+    std::vector<const ScanNode*> sorted;
+    sorted.reserve(nodes.size());
+    for(const ScanNode& node : nodes) if(node.dist != 0) sorted.push_back(&node);
+    std::sort(sorted.begin(), sorted.end(), [](const ScanNode* a, const ScanNode* b) { return a->angle < b->angle; });
+    for(const ScanNode* node : sorted)
+    {
+        float a = node->angle * (float)M_PI / 180.0f;
+        points.emplace_back(node->dist * std::sin(a), node->dist * std::cos(a));
+    }
+    if(points.size() < 2) return segments;
+
+    sums.resize(points.size() + 1);
+    sums[0] = {0, 0, 0, 0, 0, 0};
+    for(size_t i = 0; i < points.size(); i++)
+    {
+        const Vec2& p = points[i];
+        sums[i + 1] = sums[i] + Moments{1, p.x, p.y, (double)p.x * p.x, (double)p.x * p.y, (double)p.y * p.y};
+    }
+
+    // runs of points without gaps, each split into lines
+    int first = 0;
+    for(int i = 1; i <= (int)points.size(); i++)
+    {
+        if(i < (int)points.size() && (points[i] - points[i - 1]).length() <= config.max_gap) continue;
+        split(first, i - 1);
+        first = i;
+    }
+
+    merge();
+
+    for(const Fit& fit : fits)
+    {
+        LineSegment segment;
+        if(to_segment(fit, segment)) segments.push_back(segment);
+    }
+    return segments;
+}
+
+
+void LineExtractor::fit_line(Fit& fit)
+{
+    const Moments& m = fit.moments;
+    double mx = m.x / m.n, my = m.y / m.n;
+    double sxx = m.xx / m.n - mx * mx;
+    double syy = m.yy / m.n - my * my;
+    double sxy = m.xy / m.n - mx * my;
+
+    // the normal is the direction of least spread
+    double alpha = 0.5 * std::atan2(-2.0 * sxy, syy - sxx);
+    double distance = mx * std::cos(alpha) + my * std::sin(alpha);
+    if(distance < 0)
+    {
+        distance = -distance;
+        alpha += M_PI;
+    }
+    if(alpha > M_PI) alpha -= 2.0 * M_PI;
+
+    // smallest eigenvalue of the scatter is the mean squared distance to the line
+    double half = (sxx - syy) / 2.0;
+    double least = (sxx + syy) / 2.0 - std::sqrt(half * half + sxy * sxy);
+
+    fit.alpha = (float)alpha;
+    fit.distance = (float)distance;
+    fit.rms = (float)std::sqrt(std::max(0.0, least));
+}
+
+
+LineExtractor::Fit LineExtractor::fit_range(int first, int last) const
+{
+    Fit fit{first, last, sums[last + 1] - sums[first], 0, 0, 0};
+    fit_line(fit);
+    return fit;
+}
+
+
+int LineExtractor::farthest(int first, int last, float alpha, float distance, float& farthest_distance) const
+{
+    float c = std::cos(alpha), s = std::sin(alpha);
+    int index = first;
+    farthest_distance = 0;
+    for(int i = first; i <= last; i++)
+    {
+        float d = std::abs(points[i].x * c + points[i].y * s - distance);
+        if(d > farthest_distance)
+        {
+            farthest_distance = d;
+            index = i;
+        }
+    }
+    return index;
+}
+
+
+void LineExtractor::split(int first, int last)
+{
+    if(last - first + 1 < config.min_points) return;
+
+    Fit fit = fit_range(first, last);
+    float distance;
+    farthest(first, last, fit.alpha, fit.distance, distance);
+    if(distance <= config.split_distance)
+    {
+        fits.push_back(fit);
+        return;
+    }
+
+    // split where the points are farthest from the line between the ends, at a corner the fitted
+    // line runs through the middle and its farthest points are the ends
+    Vec2 chord = points[last] - points[first];
+    int index;
+    if(chord.length() > 0)
+    {
+        float alpha = std::atan2(chord.x, -chord.y);
+        index = farthest(first + 1, last - 1, alpha, points[first].x * std::cos(alpha) + points[first].y * std::sin(alpha), distance);
+    }
+    else index = (first + last) / 2;
+
+    // the corner goes with the side it fits best
+    Fit before = fit_range(first, index), after = fit_range(index, last);
+    if(before.rms <= after.rms)
+    {
+        split(first, index);
+        split(index + 1, last);
+    }
+    else
+    {
+        split(first, index - 1);
+        split(index, last);
+    }
+}
+
+
+void LineExtractor::merge()
+{
+    if(fits.size() < 2) return;
+
+    auto same_line = [this](const Fit& a, const Fit& b, Fit& merged) {
+        float angle = std::abs(std::remainder(a.alpha - b.alpha, 2.0f * (float)M_PI)) * 180.0f / (float)M_PI;
+        if(angle > config.merge_angle) return false;
+        merged = Fit{a.first, b.last, a.moments + b.moments, 0, 0, 0};
+        fit_line(merged);
+        return merged.rms <= config.merge_distance / 2.0f;
+    };
+
+    // neighbours in scan order, only across gaps small enough to be the same wall
+    std::vector<Fit> merged_fits;
+    for(const Fit& fit : fits)
+    {
+        Fit merged;
+        if(!merged_fits.empty() && (points[fit.first] - points[merged_fits.back().last]).length() <= config.max_gap &&
+           same_line(merged_fits.back(), fit, merged))
+        {
+            merged_fits.back() = merged;
+        }
+        else merged_fits.push_back(fit);
+    }
+
+    // a wall behind the robot is cut in two where the angles wrap around
+    Fit merged;
+    if(merged_fits.size() >= 2 && (points[merged_fits.front().first] - points[merged_fits.back().last]).length() <= config.max_gap &&
+       same_line(merged_fits.back(), merged_fits.front(), merged))
+    {
+        merged_fits.front() = merged;
+        merged_fits.pop_back();
+    }
+    fits.swap(merged_fits);
+}
+
+
+bool LineExtractor::to_segment(const Fit& fit, LineSegment& segment) const
+{
+    if(fit.moments.n < config.min_points) return false;
+
+    // endpoints are the first and last point projected onto the line
+    Vec2 normal(std::cos(fit.alpha), std::sin(fit.alpha));
+    const Vec2& a = points[fit.first];
+    const Vec2& b = points[fit.last];
+    segment.start = a - normal * (a.dot(normal) - fit.distance);
+    segment.end = b - normal * (b.dot(normal) - fit.distance);
+    if(segment.length() < config.min_length) return false;
+
+    segment.alpha = fit.alpha;
+    segment.distance = fit.distance;
+    segment.points = (int)fit.moments.n;
+    segment.rms = fit.rms;
+
+    // the angle is as sure as the points are spread along the line, the distance as there are points
+    const Moments& m = fit.moments;
+    double n = m.n;
+    double mx = m.x / n, my = m.y / n;
+    double sxx = m.xx / n - mx * mx, syy = m.yy / n - my * my, sxy = m.xy / n - mx * my;
+    double half = (sxx - syy) / 2.0;
+    double spread = (sxx + syy) / 2.0 + std::sqrt(half * half + sxy * sxy);
+    double variance = std::max((double)config.point_std * config.point_std, (double)fit.rms * fit.rms);
+    double alpha_variance = variance / (n * std::max(spread, 1.0));
+    double along = -mx * std::sin(fit.alpha) + my * std::cos(fit.alpha);
+    segment.covariance << alpha_variance, along * alpha_variance,
+                          along * alpha_variance, variance / n + along * along * alpha_variance;
+    return true;
+}
+
+
+bool LineExtractor::axis_rotation(const std::vector<LineSegment>& segments, float min_length, float& rotation)
+{
+    // angles are folded four times over so walls at right angles agree
+    double s = 0, c = 0, total = 0;
+    for(const LineSegment& segment : segments)
+    {
+        float length = segment.length();
+        s += length * std::sin(4.0 * segment.alpha);
+        c += length * std::cos(4.0 * segment.alpha);
+        total += length;
+    }
+    if(total < min_length || (s == 0 && c == 0)) return false;
+    rotation = (float)(std::atan2(s, c) / 4.0 * 180.0 / M_PI);
+    if(rotation >= 45.0f) rotation -= 90.0f;
+    return true;
+}
@@ -0,0 +1,121 @@
+/*
+
+file: line_extractor.hpp
+created: 2026-10-17
+
+Wall segments from rplidar scans.
+
+The arena is built from straight walls, so a scan is mostly a few dozen
+lines. Points are split into runs at gaps, then every run is split
+recursively at the point farthest from the line between its ends until all
+points are close to the line fitted to them, and neighbouring segments that
+lie on the same line are merged again (split-and-merge). Line fits come
+from running sums of the point coordinates, so fitting any range of points
+is O(1) and the whole extraction O(n log n).
+
+Lines are fitted with total least squares and given in normal form,
+x cos(alpha) + y sin(alpha) = distance, with the covariance of
+(alpha, distance) from the point noise and the spread of the points.
+
+*/
+
+
+#ifndef LINE_EXTRACTOR_HPP
+#define LINE_EXTRACTOR_HPP
+
+#include <vector>
+#include <Eigen/Dense>
+
+#include "scan_frame.hpp"
+#include "vec2.hpp"
+
+
+struct LineExtractorConfig
+{
+    float split_distance = 25.0f;   // mm, runs are split until no point is farther than this from its line
+    float max_gap = 200.0f;         // mm, points farther apart than this are not on the same wall
+    int min_points = 6;             // shorter segments are dropped...
+    float min_length = 100.0f;      // ...and so are segments shorter than this in mm
+    float merge_angle = 5.0f;       // degrees, neighbouring segments this parallel...
+    float merge_distance = 25.0f;   // ...whose merged line fits all points this well in mm are merged
+    float point_std = 10.0f;        // mm, rplidar noise, the least the fit residual is assumed to be
+};
+
+
+struct LineSegment
+{
+    Vec2 start, end;                // endpoints in mm in the robot frame, in scan order
+    float alpha;                    // radians, direction of the line normal
+    float distance;                 // mm, distance from the robot to the line, >= 0
+    Eigen::Matrix2f covariance;     // of (alpha, distance) in radians and mm
+    int points;                     // number of points fitted
+    float rms;                      // mm, root mean square distance of the points to the line
+
+    float length() const { return (end - start).length(); }
+};
+
+
+class LineExtractor
+{
+public:
+    LineExtractor(const LineExtractorConfig& config = LineExtractorConfig());
+
+    // segments of a scan, valid until the next call
+    // nodes: rplidar scan
+    const std::vector<LineSegment>& extract(const std::vector<ScanNode>& nodes);
+
+    // segments of the last extracted scan
+    const std::vector<LineSegment>& last_segments() const;
+
+    // rotation of the walls in degrees in [-45, 45), weighted by segment length,
+    // e.g. 10 if walls run 10 degrees counter-clockwise from the robot's forward and sideways axes
+    // false if the segments are shorter than min_length in total
+    static bool axis_rotation(const std::vector<LineSegment>& segments, float min_length, float& rotation);
+
+    const LineExtractorConfig& get_config() const;
+
+private:
+    // running sums of the points, the moments of a range are the difference of two
+    struct Moments
+    {
+        double n, x, y, xx, xy, yy;
+
+        Moments operator+(const Moments& o) const { return {n + o.n, x + o.x, y + o.y, xx + o.xx, xy + o.xy, yy + o.yy}; }
+        Moments operator-(const Moments& o) const { return {n - o.n, x - o.x, y - o.y, xx - o.xx, xy - o.xy, yy - o.yy}; }
+    };
+
+    // a range [first, last] of points and its line
+    struct Fit
+    {
+        int first, last;
+        Moments moments;
+        float alpha, distance;
+        float rms;
+    };
+
+    // total least squares line through the points with these moments
+    static void fit_line(Fit& fit);
+
+    Fit fit_range(int first, int last) const;
+
+    // index of the point in [first, last] farthest from the line, and its distance
+    int farthest(int first, int last, float alpha, float distance, float& farthest_distance) const;
+
+    // split run into fits that all points are close to, appended to fits
+    void split(int first, int last);
+
+    // merge neighbouring fits on the same line, the last and first too if the scan wraps around
+    void merge();
+
+    // segment of a fit, false if it is too short
+    bool to_segment(const Fit& fit, LineSegment& segment) const;
+
+    LineExtractorConfig config;
+
+    std::vector<Vec2> points;
+    std::vector<Moments> sums;      // sums[i] are the moments of points [0, i)
+    std::vector<Fit> fits;
+    std::vector<LineSegment> segments;
+};
+
+#endif // LINE_EXTRACTOR_HPP
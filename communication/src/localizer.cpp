@@ -0,0 +1,293 @@
+/*
+
+file: localizer.cpp
+created: 2026-10-17
+
+Monte Carlo localization against a saved map.
+
+*/
+
+
+#include <cmath>
+#include <algorithm>
+#include <unordered_set>
+
+#include "localizer.hpp"
+#include "icp.hpp"
+
+
+// wrap angle in degrees to (-180, 180]
+static float wrap(float angle)
+{
+    angle = std::fmod(angle, 360.0f);
+    if(angle <= -180.0f) angle += 360.0f;
+    if(angle > 180.0f) angle -= 360.0f;
+    return angle;
+}
+
+
+Localizer::Localizer(const Map& map, ThreadPool& pool, const LocalizerConfig& config, unsigned seed) :
+    config(config), field(map, config.sigma), pool(pool), random(seed), cell_size(map.cell_size()),
+    mean{0, 0, 0}, position_std(0), rotation_std(0), effective(0), agreeing(0)
+{
+    // centers of the empty cells, where the robot can be
+    int min_col, min_row, max_col, max_row;
+    if(!map.extent(min_col, min_row, max_col, max_row)) return;
+    int cols = max_col - min_col + 1, rows = max_row - min_row + 1;
+    std::vector<int8_t> log_odds((size_t)cols * rows);
+    map.read(min_col, min_row, cols, rows, log_odds.data());
+    for(int r = 0; r < rows; r++)
+    {
+        for(int c = 0; c < cols; c++)
+        {
+            if(log_odds[r * cols + c] > map.occupancy_config().empty_threshold) continue;
+            free_cells.push_back(Vec2((min_col + c) * cell_size, (min_row + r) * cell_size));
+        }
+    }
+}
+
+
+void Localizer::init_global()
+{
+    particles.clear();
+    agreeing = 0;
+    if(free_cells.empty()) return;
+
+    double weight = 1.0 / config.max_particles;
+    for(int i = 0; i < config.max_particles; i++) particles.push_back({random_pose(), weight});
+    summarize();
+}
+
+
+Pose Localizer::random_pose()
+{
+    std::uniform_int_distribution<size_t> pick(0, free_cells.size() - 1);
+    std::uniform_real_distribution<float> offset(-0.5f, 0.5f);
+    std::uniform_real_distribution<float> rotation(-180.0f, 180.0f);
+    const Vec2& center = free_cells[pick(random)];
+    return Pose{center.x + offset(random) * cell_size, center.y + offset(random) * cell_size, rotation(random)};
+}
+
+
+void Localizer::init_pose(const Pose& pose, float spread, float rotation_spread)
+{
+    particles.clear();
+    agreeing = 0;
+    std::normal_distribution<float> position(0.0f, spread);
+    std::normal_distribution<float> rotation(0.0f, rotation_spread);
+    double weight = 1.0 / config.min_particles;
+    for(int i = 0; i < config.min_particles; i++)
+    {
+        particles.push_back({Pose{pose.x + position(random), pose.y + position(random), wrap(pose.rot + rotation(random))}, weight});
+    }
+    summarize();
+}
+
+
+void Localizer::predict(const Pose& delta)
+{
+    float translation = std::hypot(delta.x, delta.y);
+    float translation_noise = std::max(config.min_noise, config.odometry_noise * translation);
+    float rotation_noise = std::max(config.min_rotation_noise, config.odometry_noise * std::abs(delta.rot));
+    std::normal_distribution<float> position(0.0f, translation_noise);
+    std::normal_distribution<float> rotation(0.0f, rotation_noise);
+
+    for(Particle& particle : particles)
+    {
+        Pose noisy{delta.x + position(random), delta.y + position(random), delta.rot + rotation(random)};
+        particle.pose = particle.pose * noisy;
+        particle.pose.rot = wrap(particle.pose.rot);
+    }
+}
+
+
+void Localizer::update(const std::vector<ScanNode>& nodes)
+{
+    if(particles.empty()) return;
+    beams = ICP::to_points(nodes, config.beams);
+    if(beams.empty()) return;
+
+    // log likelihood of every particle, each independent of the others
+    float random_ratio = config.random_ratio;
+    pool.parallel_for(particles.size(), [this, random_ratio](size_t begin, size_t end) {
+        for(size_t i = begin; i < end; i++)
+        {
+            const Pose& pose = particles[i].pose;
+            float r = pose.rot * (float)M_PI / 180.0f;
+            float c = std::cos(r), s = std::sin(r);
+            double log_likelihood = 0;
+            for(const Vec2& p : beams)
+            {
+                float likelihood = field.at(pose.x + c*p.x - s*p.y, pose.y + s*p.x + c*p.y);
+                log_likelihood += std::log((1.0f - random_ratio) * likelihood + random_ratio);
+            }
+            particles[i].weight = log_likelihood;
+        }
+    }, 64);
+
+    // normalize in log space first, the products underflow otherwise
+    double best = particles[0].weight;
+    for(const Particle& particle : particles) best = std::max(best, particle.weight);
+    double total = 0;
+    for(Particle& particle : particles)
+    {
+        particle.weight = std::exp(particle.weight - best);
+        total += particle.weight;
+    }
+    double square_sum = 0;
+    for(Particle& particle : particles)
+    {
+        particle.weight /= total;
+        square_sum += particle.weight * particle.weight;
+    }
+
+    // judged before resampling, which turns a few heavy particles into many that agree
+    effective = (float)(1.0 / square_sum / particles.size());
+    summarize();
+    bool agree = position_std < config.converged_spread && rotation_std < config.converged_rotation &&
+        effective >= config.converged_effective;
+    agreeing = agree ? agreeing + 1 : 0;
+
+    resample();
+    roughen();
+    if(!converged()) inject();
+}
+
+
+size_t Localizer::kld_limit(size_t k) const
+{
+    if(k <= 1) return config.min_particles;
+
+    // Wilson-Hilferty approximation of the chi-square quantile
+    double a = 2.0 / (9.0 * (k - 1));
+    double b = 1.0 - a + std::sqrt(a) * config.kld_z;
+    double n = (k - 1) / (2.0 * config.kld_error) * b * b * b;
+    return std::clamp<size_t>((size_t)std::ceil(n), config.min_particles, config.max_particles);
+}
+
+
+void Localizer::resample()
+{
+    // cumulative weights to draw from
+    std::vector<double> cumulative(particles.size());
+    double sum = 0;
+    for(size_t i = 0; i < particles.size(); i++)
+    {
+        sum += particles[i].weight;
+        cumulative[i] = sum;
+    }
+
+    std::uniform_real_distribution<double> draw(0.0, sum);
+    std::unordered_set<uint64_t> bins;
+    bins.reserve(2 * config.max_particles);
+    drawn.clear();
+    size_t limit = config.min_particles;
+
+    while(drawn.size() < limit)
+    {
+        size_t i = std::upper_bound(cumulative.begin(), cumulative.end(), draw(random)) - cumulative.begin();
+        i = std::min(i, particles.size() - 1);
+        const Pose& pose = particles[i].pose;
+        drawn.push_back(particles[i]);
+
+        // every new occupied bin means the particles are more spread out and more are needed
+        uint64_t x = (uint64_t)(int64_t)std::floor(pose.x / config.bin_size) & 0xFFFFFF;
+        uint64_t y = (uint64_t)(int64_t)std::floor(pose.y / config.bin_size) & 0xFFFFFF;
+        uint64_t a = (uint64_t)(int64_t)std::floor((pose.rot + 180.0f) / config.bin_angle) & 0xFFFF;
+        if(bins.insert(x << 40 | y << 16 | a).second) limit = kld_limit(bins.size());
+    }
+
+    double weight = 1.0 / drawn.size();
+    for(Particle& particle : drawn) particle.weight = weight;
+    std::swap(particles, drawn);
+}
+
+
+void Localizer::roughen()
+{
+    // copies of one particle are spread out again, less so the more particles there are
+    float scale = config.roughening / std::cbrt((float)particles.size());
+    std::normal_distribution<float> position(0.0f, std::max(config.min_noise, scale * position_std));
+    std::normal_distribution<float> rotation(0.0f, std::max(config.min_rotation_noise, scale * rotation_std));
+    for(Particle& particle : particles)
+    {
+        particle.pose.x += position(random);
+        particle.pose.y += position(random);
+        particle.pose.rot = wrap(particle.pose.rot + rotation(random));
+    }
+}
+
+
+void Localizer::inject()
+{
+    if(free_cells.empty()) return;
+
+    // resampling draws in random order, so the last particles are as good as any to replace
+    size_t count = std::min(particles.size(), (size_t)std::ceil(config.random_particles * particles.size()));
+    for(size_t i = particles.size() - count; i < particles.size(); i++) particles[i].pose = random_pose();
+}
+
+
+void Localizer::summarize()
+{
+    if(particles.empty()) return;
+
+    double x = 0, y = 0, sin_sum = 0, cos_sum = 0, total = 0;
+    for(const Particle& particle : particles)
+    {
+        double r = particle.pose.rot * M_PI / 180.0;
+        x += particle.weight * particle.pose.x;
+        y += particle.weight * particle.pose.y;
+        sin_sum += particle.weight * std::sin(r);
+        cos_sum += particle.weight * std::cos(r);
+        total += particle.weight;
+    }
+    mean = Pose{(float)(x / total), (float)(y / total), (float)(std::atan2(sin_sum, cos_sum) * 180.0 / M_PI)};
+
+    double position_var = 0, rotation_var = 0;
+    for(const Particle& particle : particles)
+    {
+        double dx = particle.pose.x - mean.x, dy = particle.pose.y - mean.y;
+        double dr = wrap(particle.pose.rot - mean.rot);
+        position_var += particle.weight * (dx * dx + dy * dy);
+        rotation_var += particle.weight * dr * dr;
+    }
+    position_std = (float)std::sqrt(position_var / total);
+    rotation_std = (float)std::sqrt(rotation_var / total);
+}
+
+
+Pose Localizer::estimate() const
+{
+    return mean;
+}
+
+
+bool Localizer::converged() const
+{
+    return !particles.empty() && agreeing >= config.converged_updates;
+}
+
+
+float Localizer::spread() const
+{
+    return position_std;
+}
+
+
+float Localizer::rotation_spread() const
+{
+    return rotation_std;
+}
+
+
+float Localizer::effective_share() const
+{
+    return effective;
+}
+
+
+size_t Localizer::particle_count() const
+{
+    return particles.size();
+}
@@ -0,0 +1,146 @@
+/*
+
+file: localizer.hpp
+created: 2026-10-17
+
+Monte Carlo localization against a saved map.
+
+A particle filter: every particle is a guess of the robot pose. Particles
+are moved by odometry with some noise and weighted by how well the scan
+fits the map from their pose, looked up in a likelihood field. Weighting is
+split over a thread pool.
+
+The number of particles is adapted with KLD sampling: when resampling, new
+particles are drawn until there are enough to represent the spread of the
+particles drawn so far (the number of occupied pose bins) within an error
+bound. Spread out particles during global localization need many, a
+converged filter needs few, which keeps CPU use down.
+
+A sharp scan likelihood can put almost all weight on one particle, and
+resampling then copies it into every slot whether it is right or not. So
+convergence is judged on the weighted particles before resampling: they
+must agree on a pose, the weight must be spread over a fair share of them
+(the effective sample size), and both must hold for several updates in a
+row. Resampled particles are roughened with noise so copies spread out
+again, and while not converged a few are put anywhere on the map so a
+wrong pick can still be recovered from.
+
+*/
+
+
+#ifndef LOCALIZER_HPP
+#define LOCALIZER_HPP
+
+#include <stdint.h>
+#include <random>
+#include <vector>
+
+#include "likelihood_field.hpp"
+#include "map.hpp"
+#include "pose.hpp"
+#include "scan_frame.hpp"
+#include "thread_pool.hpp"
+#include "vec2.hpp"
+
+
+struct LocalizerConfig
+{
+    int min_particles = 200;
+    int max_particles = 20000;
+    float kld_error = 0.05f;            // max KL divergence between the particles and the true distribution...
+    float kld_z = 2.33f;                // ...with probability 0.99 (upper standard normal quantile)
+    float bin_size = 100.0f;            // mm, pose bins for counting the spread
+    float bin_angle = 10.0f;            // degrees
+    int beams = 60;                     // scan points used to weight each particle
+    float sigma = 50.0f;                // mm, scan point noise around walls
+    float random_ratio = 0.05f;         // likelihood of a point that does not fit the map at all
+    float odometry_noise = 0.1f;        // standard deviation as a fraction of the motion...
+    float min_noise = 5.0f;             // ...but at least this many mm...
+    float min_rotation_noise = 1.0f;    // ...and degrees, so a standing robot still explores
+    float converged_spread = 100.0f;    // mm, converged when the weighted particles are within this...
+    float converged_rotation = 5.0f;    // ...and this many degrees (standard deviations)...
+    float converged_effective = 0.1f;   // ...the effective sample size is at least this share of the particles...
+    int converged_updates = 3;          // ...for this many updates in a row
+    float roughening = 0.2f;            // resampled particles are moved by this share of the spread, over the cube root of their number
+    float random_particles = 0.02f;     // share of particles put anywhere after resampling while not converged
+};
+
+
+class Localizer
+{
+public:
+    // map: saved map to localize in, must have walls
+    // pool: threads to weight the particles with
+    Localizer(const Map& map, ThreadPool& pool, const LocalizerConfig& config = LocalizerConfig(), unsigned seed = 1);
+
+    // spread max_particles over the empty cells of the map with any rotation
+    void init_global();
+
+    // put all particles around a known pose
+    void init_pose(const Pose& pose, float spread, float rotation_spread);
+
+    // move particles by the motion since the last update, in the robot frame
+    void predict(const Pose& delta);
+
+    // weight particles by a scan and resample
+    void update(const std::vector<ScanNode>& nodes);
+
+    // weighted mean pose of the particles
+    Pose estimate() const;
+
+    // true if the weighted particles agreed on a pose for the last converged_updates updates
+    bool converged() const;
+
+    // standard deviation of the weighted particle positions in mm and rotations in degrees
+    float spread() const;
+    float rotation_spread() const;
+
+    // share of the particles the weight was spread over at the last update
+    float effective_share() const;
+
+    size_t particle_count() const;
+
+private:
+    struct Particle
+    {
+        Pose pose;
+        double weight;
+    };
+
+    // draw particles from the weighted ones until KLD sampling says there are enough
+    void resample();
+
+    // move resampled particles apart by noise scaled to the spread
+    void roughen();
+
+    // replace a few particles by ones anywhere on the map
+    void inject();
+
+    // anywhere in an empty cell with any rotation
+    Pose random_pose();
+
+    // number of particles needed for k occupied bins
+    size_t kld_limit(size_t k) const;
+
+    // recompute estimate and spreads
+    void summarize();
+
+    LocalizerConfig config;
+    LikelihoodField field;
+    ThreadPool& pool;
+    std::mt19937 random;
+
+    std::vector<Particle> particles;
+    std::vector<Particle> drawn;
+    std::vector<Vec2> beams;
+    std::vector<Vec2> free_cells;
+    float cell_size;
+
+    Pose mean;
+    float position_std;
+    float rotation_std;
+    float effective;
+    int agreeing;   // updates in a row the weighted particles agreed
+};
+
+#endif // LOCALIZER_HPP
@@ -5,12 +5,28 @@ author: osklu414
 created: 2019-11-14
 
 Program entry point. Identifies modules connected via UART and creates communication object.
+The rplidar is connected to and spun up on a thread of its own as soon as its port is known.
+
+usage: communication [-r scan_log] [-p scan_log] [-m map_file] [-s map_file] [-c cpu] [-l latency_file]
+    -r: record all rplidar scans to scan_log
+    -p: replay scans from scan_log instead of using the rplidar
+    -m: continue in a map saved earlier, the robot localizes itself in it
+    -s: save the map to map_file when stopped
+    -c: run the control thread on cpu only and ahead of the other threads (needs root for the priority)
+    -l: write latency histograms from sensor and rplidar input to steering output to latency_file when stopped
+
+Threads: the control thread (this one) runs the event loop that reads the
+sensor module and decides what the steering does. The rplidar, mapping and
+telemetry to the PC have threads of their own, connected to the control
+thread by queues.
 
 */
 
 
 #include <iostream>
 #include <atomic>
+#include <cstdlib>
+#include <future>
 
 #include <unistd.h>
 #include <signal.h>
@@ -19,13 +35,20 @@ Program entry point. Identifies modules connected via UART and creates communica
 #include "serial.hpp"
 #include "communication.hpp"
 #include "rplidar.hpp"
+#include "event_loop.hpp"
+#include "realtime.hpp"
+#include "identify.hpp"
+
+// real-time priority of the control thread when pinned, below the kernel threads handling interrupts (50)
+#define CONTROL_PRIORITY 40
+
+// ms to wait for the modules to send their ids, they send one every 100 ms once booted
+#define IDENTIFY_TIMEOUT 10000
 
 static std::atomic<bool> quit(false);
 
 void signal_callback(int) { quit.store(true); }
 
-void identify_modules(std::string& sensor_file, std::string& steering_file, std::string& rplidar_file);
-
 int main(int argc, char* argv[])
 {
     TRACE("communication module started");
@@ -37,89 +60,58 @@ int main(int argc, char* argv[])
     sigfillset(&sa.sa_mask);
     sigaction(SIGINT, &sa, NULL);
 
-    // identify modules
-    std::string sensor_file, steering_file, rplidar_file;
-    identify_modules(sensor_file, steering_file, rplidar_file);
-
-    // start communication module and update it until signal or update returns false
-    Communication communication(sensor_file, steering_file, rplidar_file);
-    while(communication.update() && !quit.load());
-
-    TRACE("communication module stopped");
-    return 0;
-}
+    // options
+    std::string record_file, replay_file, load_map_file, save_map_file, latency_file;
+    int control_cpu = -1;
+    int opt;
+    while((opt = getopt(argc, argv, "r:p:m:s:c:l:")) != -1)
+    {
+        if(opt == 'r') record_file = optarg;
+        else if(opt == 'p') replay_file = optarg;
+        else if(opt == 'm') load_map_file = optarg;
+        else if(opt == 's') save_map_file = optarg;
+        else if(opt == 'c') control_cpu = atoi(optarg);
+        else if(opt == 'l') latency_file = optarg;
+    }
 
+    // connect to the rplidar and spin it up while the modules are identified and the rest starts
+    std::future<std::unique_ptr<ScanSource>> rplidar;
+    auto open_rplidar = [&rplidar](const std::string& file) {
+        rplidar = std::async(std::launch::async, [file]() {
+            std::unique_ptr<ScanSource> source = open_scan_source(file);
+            source->start_motor();
+            return source;
+        });
+    };
+    if(!replay_file.empty()) open_rplidar(replay_file);
 
-void identify_modules
-(
-    std::string& sensor_file,
-    std::string& steering_file, 
-    std::string& rplidar_file
-)
-{
-    // determine which port is belongs to which device/module
+    // identify modules
     TRACE("identifying modules");
-
-    Serial serials[3];
-    serials[0].open("/dev/ttyUSB0");
-    serials[1].open("/dev/ttyUSB1");
-    serials[2].open("/dev/ttyUSB2");
-    
-    
-    // identify steering module
-    TRACE("identifying steering module...");
-    bool steering_identified = false;
-    while(!steering_identified)
+    ModulePorts ports;
+    bool identified = identify_modules(
+        serial_ports(), ports, std::chrono::milliseconds(IDENTIFY_TIMEOUT),
+        [](){ return !quit.load(); },
+        [&](const std::string& file){ if(replay_file.empty()) open_rplidar(file); }
+    );
+    if(quit.load()) return 0;
+    if(!identified || !rplidar.valid())
     {
-        // make sure program quits when sending signal
-        if(quit.load()) break;
-
-        for(int s = 0; s < 3; s++)
-        {
-            uint8_t module_id;
-            if(serials[s].read(&module_id, 1) == 1 && (ModuleId)module_id == STEERING)
-            {
-                steering_identified = true;
-                std::swap(serials[s], serials[2]); // move identified serial to back
-                steering_file = serials[2].get_file();
-                break;
-            }
-        }
+        ERROR("could not identify", ports.sensor.empty() ? " the sensor module" : "", ports.steering.empty() ? " the steering module" : "",
+            rplidar.valid() ? "" : " the rplidar", " in ", IDENTIFY_TIMEOUT, " ms");
+        return 1;
     }
-    TRACE("steering module identified at ", steering_file);
 
+    // start communication module, the event loop runs it whenever something happens until signal or update returns false
+    EventLoop loop;
+    Communication communication(loop, ports.sensor, ports.steering, rplidar.get(), record_file, load_map_file, save_map_file, latency_file);
 
-    // identify sensor module
-    TRACE("identifying sensor module...");
-    bool sensor_identified = false;
-    while(!sensor_identified)
+    // the other threads have started and keep their scheduling, only the control thread is pinned
+    if(control_cpu >= 0 && pin_thread(control_cpu) && set_realtime_priority(CONTROL_PRIORITY))
     {
-        // make sure program quits when sending signal
-        if(quit.load()) break;
-
-        for(int s = 0; s < 2; s++)
-        {
-            uint8_t module_id;
-            if(serials[s].read(&module_id, 1) == 1 && (ModuleId)module_id == SENSOR)
-            {
-                sensor_identified = true;
-                std::swap(serials[s], serials[1]); // move identified serial to back
-                sensor_file = serials[1].get_file();
-                break;
-            }
-        }
+        INFO("control thread on cpu ", control_cpu, " with priority ", CONTROL_PRIORITY);
     }
-    TRACE("sensor module identified at ", sensor_file);
-
-    // identify rplidar device
-    TRACE("identifying rplidar device...");
-    rplidar_file = serials[0].get_file();
-    TRACE("rplidar device identified at ", rplidar_file);
-
-    serials[0].close();
-    serials[1].close();
-    serials[2].close();
+    loop.run([](){ return !quit.load(); });
 
+    TRACE("communication module stopped");
+    return 0;
 }
-
-
@@ -9,28 +9,40 @@ Map model class.
 */
 
 
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+
 #include "map.hpp"
+#include "logging.hpp"
+
+
+// header of saved maps, followed by chunk_count chunks of chunk col, chunk row (int32) and the cells
+struct MapFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    int32_t cell_size;
+    uint64_t chunk_count;
+};
 
 
 // robot starts in the middle of tile (0, 0)
 Robot::Robot() : x(0.5f), y(0.5f), r(0) {}
 
 
-Map::Map()
+Map::Chunk::Chunk() : version(0)
 {
-    // each tile starts of as unknown
-    for(int r = 0; r < MAP_SIZE; r++)
-    {
-        for(int  c = 0; c < MAP_SIZE; c++)
-        {
-            tiles[r][c] = Tile::UNKNOWN;
-            confidence_empty[r][c] = 0;
-            confidence_wall[r][c] = 0;
-        }
-    }
+    // each cell starts of as unknown
+    for(std::atomic<int8_t>& cell : cells) cell.store(0, std::memory_order_relaxed);
+}
+
 
+Map::Map(const int cell_size, const OccupancyConfig& config) : size(cell_size), config(config), chunks(), current_version(0)
+{
     // the starting position of the robot is empty
-    //tiles[ORIGIN][ORIGIN] = Tile::EMPTY;
+    //set(0, 0, Tile::EMPTY);
 }
 
 Map::~Map()
@@ -41,39 +53,265 @@ Map::~Map()
 
 void Map::set(const int col, const int row, Tile tile)
 {
-    tiles[row][col] = tile;
+    int8_t value = 0;
+    if(tile == Tile::EMPTY) value = config.min;
+    if(tile == Tile::WALL) value = config.max;
+
+    // unknown cells do not need a chunk
+    Chunk* chunk = value == 0 ? find_chunk(col, row) : get_chunk(col, row);
+    if(chunk) store(chunk, cell_index(col, row), value);
 }
 
 
 Tile Map::get(const int col, const int row) const
 {
-    return tiles[row][col];
+    return tile_of(log_odds(col, row));
 }
 
 
 void Map::update(const int col, const int row, const Tile tile)
 {
+    Cursor cursor;
+    update(col, row, tile, cursor);
+}
+
+
+void Map::update(const int col, const int row, const Tile tile, Cursor& cursor)
+{
+    int delta = 0;
     switch(tile)
     {
         case Tile::EMPTY:
         {
-            if(++confidence_empty[row][col] > confidence_wall[row][col])
-            {
-                 if(confidence_empty[row][col] >= CONFIDENCE_MIN) tiles[row][col] = Tile::EMPTY;
-            }
+            delta = -config.miss;
             break;
         }
         case Tile::WALL:
         {
-            if(++confidence_wall[row][col] > confidence_empty[row][col])
-            {
-                if(confidence_wall[row][col] >= CONFIDENCE_MIN) tiles[row][col] = Tile::WALL;
-            }
+            delta = config.hit;
             break;
         }
         case Tile::UNKNOWN:
         {
-            break;
+            return;
+        }
+    }
+
+    // there is only one writer, so no read-modify-write is needed
+    Chunk* chunk = get_chunk(col, row, cursor);
+    int index = cell_index(col, row);
+    int updated = std::clamp(chunk->cells[index].load(std::memory_order_relaxed) + delta, (int)config.min, (int)config.max);
+    store(chunk, index, (int8_t)updated);
+}
+
+
+int8_t Map::log_odds(const int col, const int row) const
+{
+    Chunk* chunk = find_chunk(col, row);
+    if(!chunk) return 0;
+    return chunk->cells[cell_index(col, row)].load(std::memory_order_relaxed);
+}
+
+
+void Map::read(const int col, const int row, const int cols, const int rows, int8_t* out) const
+{
+    // walk the rectangle chunk by chunk, unallocated chunks are unknown
+    for(int r0 = row; r0 < row + rows; r0 = ((r0 >> CHUNK_BITS) + 1) << CHUNK_BITS)
+    {
+        int r1 = std::min(row + rows, ((r0 >> CHUNK_BITS) + 1) << CHUNK_BITS);
+        for(int c0 = col; c0 < col + cols; c0 = ((c0 >> CHUNK_BITS) + 1) << CHUNK_BITS)
+        {
+            int c1 = std::min(col + cols, ((c0 >> CHUNK_BITS) + 1) << CHUNK_BITS);
+            Chunk* chunk = find_chunk(c0, r0);
+            for(int r = r0; r < r1; r++)
+            {
+                int8_t* dst = out + (size_t)(r - row) * cols + (c0 - col);
+                for(int c = c0; c < c1; c++)
+                {
+                    *dst++ = chunk ? chunk->cells[cell_index(c, r)].load(std::memory_order_relaxed) : 0;
+                }
+            }
+        }
+    }
+}
+
+
+int Map::cell_size() const
+{
+    return size;
+}
+
+
+const OccupancyConfig& Map::occupancy_config() const
+{
+    return config;
+}
+
+
+size_t Map::chunk_count() const
+{
+    std::shared_lock<std::shared_mutex> lock(chunks_mutex);
+    return chunks.size();
+}
+
+
+uint64_t Map::version() const
+{
+    return current_version.load();
+}
+
+
+std::vector<std::pair<int, int>> Map::changed_chunks(const uint64_t since, uint64_t& latest) const
+{
+    // every chunk changed up to the published version has stored its version before it was published,
+    // chunks changed while iterating may show up again next time, which is harmless
+    latest = current_version.load(std::memory_order_acquire);
+    std::vector<std::pair<int, int>> changed;
+    std::shared_lock<std::shared_mutex> lock(chunks_mutex);
+    for(const auto& [key, chunk] : chunks)
+    {
+        if(chunk->version.load(std::memory_order_acquire) <= since) continue;
+
+        changed.push_back(chunk_origin(key));
+    }
+    return changed;
+}
+
+
+bool Map::extent(int& min_col, int& min_row, int& max_col, int& max_row) const
+{
+    std::shared_lock<std::shared_mutex> lock(chunks_mutex);
+    if(chunks.empty()) return false;
+
+    bool first = true;
+    for(const auto& [key, chunk] : chunks)
+    {
+        auto [col, row] = chunk_origin(key);
+        if(first || col < min_col) min_col = col;
+        if(first || row < min_row) min_row = row;
+        if(first || col + CHUNK_SIZE - 1 > max_col) max_col = col + CHUNK_SIZE - 1;
+        if(first || row + CHUNK_SIZE - 1 > max_row) max_row = row + CHUNK_SIZE - 1;
+        first = false;
+    }
+    return true;
+}
+
+
+bool Map::save(const std::string& file) const
+{
+    FILE* fp = fopen(file.c_str(), "wb");
+    if(!fp)
+    {
+        ERROR("could not open map file ", file);
+        return false;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(chunks_mutex);
+    MapFileHeader header;
+    memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    header.version = FILE_VERSION;
+    header.cell_size = size;
+    header.chunk_count = chunks.size();
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+
+    int8_t cells[CHUNK_SIZE * CHUNK_SIZE];
+    for(const auto& [key, chunk] : chunks)
+    {
+        auto [col, row] = chunk_origin(key);
+        int32_t origin[2] = {col >> CHUNK_BITS, row >> CHUNK_BITS};
+        for(int i = 0; i < CHUNK_SIZE * CHUNK_SIZE; i++) cells[i] = chunk->cells[i].load(std::memory_order_relaxed);
+        ok = ok && fwrite(origin, sizeof(origin), 1, fp) == 1 && fwrite(cells, sizeof(cells), 1, fp) == 1;
+    }
+    ok = fclose(fp) == 0 && ok;
+
+    if(!ok) ERROR("could not write map file ", file);
+    else INFO("saved ", header.chunk_count, " map chunks to ", file);
+    return ok;
+}
+
+
+bool Map::load(const std::string& file)
+{
+    FILE* fp = fopen(file.c_str(), "rb");
+    if(!fp)
+    {
+        ERROR("could not open map file ", file);
+        return false;
+    }
+
+    MapFileHeader header;
+    if(fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != FILE_VERSION)
+    {
+        ERROR(file, " is not a map file");
+        fclose(fp);
+        return false;
+    }
+    if(header.cell_size != size)
+    {
+        ERROR("map file ", file, " has ", header.cell_size, " mm cells, expected ", size);
+        fclose(fp);
+        return false;
+    }
+
+    // stored through the normal path so readers see the loaded cells as changes
+    int8_t cells[CHUNK_SIZE * CHUNK_SIZE];
+    for(uint64_t c = 0; c < header.chunk_count; c++)
+    {
+        int32_t origin[2];
+        if(fread(origin, sizeof(origin), 1, fp) != 1 || fread(cells, sizeof(cells), 1, fp) != 1)
+        {
+            ERROR("map file ", file, " ended after ", c, " chunks");
+            fclose(fp);
+            return false;
+        }
+        int col = origin[0] * CHUNK_SIZE, row = origin[1] * CHUNK_SIZE;
+        Chunk* chunk = get_chunk(col, row);
+        for(int i = 0; i < CHUNK_SIZE * CHUNK_SIZE; i++) store(chunk, i, cells[i]);
+    }
+    fclose(fp);
+
+    INFO("loaded ", header.chunk_count, " map chunks from ", file);
+    return true;
+}
+
+
+void Map::assign(const Map& other)
+{
+    // chunks are never freed, so the pointers can be used without the locks
+    std::vector<uint64_t> own;
+    {
+        std::shared_lock<std::shared_mutex> lock(chunks_mutex);
+        for(const auto& [key, chunk] : chunks) own.push_back(key);
+    }
+    std::vector<std::pair<uint64_t, const Chunk*>> theirs;
+    {
+        std::shared_lock<std::shared_mutex> lock(other.chunks_mutex);
+        for(const auto& [key, chunk] : other.chunks) theirs.push_back({key, chunk.get()});
+    }
+
+    // copy the chunks of other, allocating the ones this map does not have yet
+    for(const auto& [key, from] : theirs)
+    {
+        auto [col, row] = chunk_origin(key);
+        Chunk* chunk = get_chunk(col, row);
+        for(int i = 0; i < CHUNK_SIZE * CHUNK_SIZE; i++)
+        {
+            int8_t value = from->cells[i].load(std::memory_order_relaxed);
+            if(chunk->cells[i].load(std::memory_order_relaxed) != value) store(chunk, i, value);
+        }
+    }
+
+    // and forget what other has not seen
+    std::sort(theirs.begin(), theirs.end());
+    for(uint64_t key : own)
+    {
+        auto it = std::lower_bound(theirs.begin(), theirs.end(), std::make_pair(key, (const Chunk*)nullptr));
+        if(it != theirs.end() && it->first == key) continue;
+        auto [col, row] = chunk_origin(key);
+        Chunk* chunk = find_chunk(col, row);
+        for(int i = 0; i < CHUNK_SIZE * CHUNK_SIZE; i++)
+        {
+            if(chunk->cells[i].load(std::memory_order_relaxed) != 0) store(chunk, i, 0);
         }
     }
 }
@@ -82,8 +320,87 @@ void Map::update(const int col, const int row, const Tile tile)
 void Map::clean()
 {
     // start from origin and find outer walls
-    int c = ORIGIN;
-    int r = ORIGIN;
+    int c = 0;
+    int r = 0;
 
 
-}
\ No newline at end of file
+}
+
+
+Tile Map::tile_of(const int8_t value) const
+{
+    if(value >= config.wall_threshold) return Tile::WALL;
+    if(value <= config.empty_threshold) return Tile::EMPTY;
+    return Tile::UNKNOWN;
+}
+
+
+void Map::store(Chunk* chunk, const int index, const int8_t value)
+{
+    std::atomic<int8_t>& cell = chunk->cells[index];
+    Tile previous = tile_of(cell.load(std::memory_order_relaxed));
+    cell.store(value, std::memory_order_relaxed);
+
+    // publish the new version only after the chunk has been marked, there is only one writer
+    if(tile_of(value) != previous)
+    {
+        uint64_t version = current_version.load(std::memory_order_relaxed) + 1;
+        chunk->version.store(version, std::memory_order_release);
+        current_version.store(version, std::memory_order_release);
+    }
+}
+
+
+uint64_t Map::chunk_key(const int col, const int row)
+{
+    // arithmetic shift floors negative cells into the right chunk
+    uint32_t chunk_col = (uint32_t)(col >> CHUNK_BITS);
+    uint32_t chunk_row = (uint32_t)(row >> CHUNK_BITS);
+    return ((uint64_t)chunk_row << 32) | chunk_col;
+}
+
+
+std::pair<int, int> Map::chunk_origin(const uint64_t key)
+{
+    // undo chunk_key, the casts sign extend negative chunks
+    int chunk_col = (int32_t)(uint32_t)(key & 0xFFFFFFFF);
+    int chunk_row = (int32_t)(uint32_t)(key >> 32);
+    return {chunk_col * CHUNK_SIZE, chunk_row * CHUNK_SIZE};
+}
+
+
+int Map::cell_index(const int col, const int row)
+{
+    return (row & (CHUNK_SIZE - 1)) * CHUNK_SIZE + (col & (CHUNK_SIZE - 1));
+}
+
+
+Map::Chunk* Map::find_chunk(const int col, const int row) const
+{
+    std::shared_lock<std::shared_mutex> lock(chunks_mutex);
+    auto it = chunks.find(chunk_key(col, row));
+    return it == chunks.end() ? nullptr : it->second.get();
+}
+
+
+Map::Chunk* Map::get_chunk(const int col, const int row)
+{
+    Chunk* chunk = find_chunk(col, row);
+    if(chunk) return chunk;
+
+    // chunks are never freed, so pointers stay valid after the lock is released
+    std::unique_lock<std::shared_mutex> lock(chunks_mutex);
+    std::unique_ptr<Chunk>& slot = chunks[chunk_key(col, row)];
+    if(!slot) slot = std::make_unique<Chunk>();
+    return slot.get();
+}
+
+
+Map::Chunk* Map::get_chunk(const int col, const int row, Cursor& cursor)
+{
+    uint64_t key = chunk_key(col, row);
+    if(cursor.chunk && key == cursor.key) return cursor.chunk;
+    cursor.chunk = get_chunk(col, row);
+    cursor.key = key;
+    return cursor.chunk;
+}
@@ -6,13 +6,35 @@ created: 2019-11-15
 
 Map model class.
 
+Each cell stores the log-odds of being a wall as a single saturating byte.
+Rays ending in a cell add to it and rays passing through subtract from it,
+so a cell can flip back if an obstacle moves. The Tile of a cell is derived
+from its log-odds with the thresholds in OccupancyConfig.
+
+Cells are stored in CHUNK_SIZE x CHUNK_SIZE chunks that are allocated the
+first time one of their cells is updated, so the map has no fixed extent
+and memory only grows with the area actually observed. Cell (0, 0) is the
+cell the robot started in, (col, row) can be negative.
+
+Every time a cell changes Tile the map version is increased and stored in
+the cell's chunk, so readers can find the chunks changed since a version
+they have seen without scanning any cells.
+
 */
 
 
 #ifndef MAP_HPP
 #define MAP_HPP
 
+#include <stdint.h>
+#include <stddef.h>
 #include <atomic>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 enum class Tile
 {
@@ -32,37 +54,136 @@ struct Robot
     float r;
 };
 
+// log-odds update and thresholds, all in the same scaled log-odds unit (0 is unknown)
+struct OccupancyConfig
+{
+    int8_t hit = 8;                 // added when a ray ends in a cell
+    int8_t miss = 3;                // subtracted when a ray passes through a cell
+    int8_t min = -64;               // log-odds are clamped to [min, max]
+    int8_t max = 64;
+    int8_t wall_threshold = 24;     // cells at or above this are walls
+    int8_t empty_threshold = -24;   // cells at or below this are empty
+};
+
 
 class Map
 {
     friend class PC;
+    struct Chunk;
 public:
-    Map();
+    // the chunk one writer updated last, so cells along a ray only look a chunk up when they enter a new one
+    // chunks are never freed, so a cursor stays valid for as long as its map
+    class Cursor
+    {
+        friend class Map;
+        uint64_t key = 0;
+        Chunk* chunk = nullptr;     // nullptr until the first chunk is looked up
+    };
+
+    // cell_size: size of each cell in mm
+    // config: log-odds update and thresholds
+    Map(const int cell_size = TILE_SIZE, const OccupancyConfig& config = OccupancyConfig());
     ~Map();
 
-    // set tile (use update_tile when filling in map)
+    // set cell (use update when filling in map)
     void set(const int col, const int row, const Tile tile);
 
-    // get tile
+    // get cell, cells that were never updated are unknown
     Tile get(const int col, const int row) const;
 
-    // set tile with confidence in consideration (this should be used when filling in map)
+    // update cell with confidence in consideration (this should be used when filling in map)
     void update(const int col, const int row, const Tile tile);
 
-    // clean up map by removing tiles with too low confidence values and ones outside the outer wall
+    // same, without locking or looking up the chunk when the cell is in the chunk of cursor
+    void update(const int col, const int row, const Tile tile, Cursor& cursor);
+
+    // get log-odds of cell being a wall
+    int8_t log_odds(const int col, const int row) const;
+
+    // copy log-odds of a cols x rows rectangle starting at (col, row), one chunk lookup per chunk
+    // out: row major, cols * rows values
+    void read(const int col, const int row, const int cols, const int rows, int8_t* out) const;
+
+    // size of each cell in mm
+    int cell_size() const;
+
+    // log-odds update and thresholds
+    const OccupancyConfig& occupancy_config() const;
+
+    // number of allocated chunks
+    size_t chunk_count() const;
+
+    // smallest rectangle of cells covering all allocated chunks, false if there are none
+    bool extent(int& min_col, int& min_row, int& max_col, int& max_row) const;
+
+    // write all allocated chunks to a file, returns false on failure
+    bool save(const std::string& file) const;
+
+    // read chunks written by save into the map, returns false on failure or if the cell size differs
+    bool load(const std::string& file);
+
+    // make every cell equal to the same cell of other, which must have the same cell size
+    // cells that changed Tile are marked as changes, so readers only resend what differs
+    void assign(const Map& other);
+
+    // current map version, increased every time a cell changes Tile
+    uint64_t version() const;
+
+    // get first (col, row) of each chunk with a cell that changed Tile after version since
+    // latest: set to the current version, pass it as since next time to get only newer changes
+    std::vector<std::pair<int, int>> changed_chunks(const uint64_t since, uint64_t& latest) const;
+
+    // clean up map by removing cells with too low confidence values and ones outside the outer wall
     void clean();
 
-    const static int AREA_SIZE = 10000;                         // area is 10x10m
-    const static int TILE_SIZE = 400;                           // each "square" is 40x40cm
-    const static int ORIGIN = AREA_SIZE/TILE_SIZE;              // intitial tile position of robot is (ORIGIN, ORIGIN)
-    const static int MAP_SIZE = 2*(AREA_SIZE/TILE_SIZE) + 1;    // number of tiles in each dimension
+    const static int TILE_SIZE = 400;                           // each "square" of the arena is 40x40cm
+    const static int CHUNK_BITS = 5;
+    const static int CHUNK_SIZE = 1 << CHUNK_BITS;              // number of cells in each dimension of a chunk
+    constexpr static const char* FILE_MAGIC = "MAPCHUNK";       // first bytes of saved maps
+    const static uint32_t FILE_VERSION = 1;
 
 private:
-    std::atomic<Tile> tiles[MAP_SIZE][MAP_SIZE];
-    unsigned long long confidence_empty[MAP_SIZE][MAP_SIZE];
-    unsigned long long confidence_wall[MAP_SIZE][MAP_SIZE];
+    struct Chunk
+    {
+        Chunk();
+
+        // log-odds per cell, only written by one thread at a time but read by others
+        std::atomic<int8_t> cells[CHUNK_SIZE * CHUNK_SIZE];
+
+        // map version of the last Tile change in the chunk
+        std::atomic<uint64_t> version;
+    };
+
+    // Tile of a log-odds value
+    Tile tile_of(const int8_t value) const;
+
+    // store log-odds of a cell, marking its chunk as changed if its Tile changed
+    void store(Chunk* chunk, const int index, const int8_t value);
+
+    // key of chunk containing cell
+    static uint64_t chunk_key(const int col, const int row);
+
+    // first cell of chunk with key
+    static std::pair<int, int> chunk_origin(const uint64_t key);
+
+    // index of cell within its chunk
+    static int cell_index(const int col, const int row);
+
+    // get chunk containing cell, nullptr if it has not been allocated
+    Chunk* find_chunk(const int col, const int row) const;
+
+    // get chunk containing cell, allocating it if needed
+    Chunk* get_chunk(const int col, const int row);
+
+    // get chunk containing cell, the one of cursor if it is the same
+    Chunk* get_chunk(const int col, const int row, Cursor& cursor);
+
+    int size;
+    OccupancyConfig config;
 
-    const static unsigned int CONFIDENCE_MIN = 10;
+    std::unordered_map<uint64_t, std::unique_ptr<Chunk>> chunks;
+    mutable std::shared_mutex chunks_mutex;
+    std::atomic<uint64_t> current_version;
 };
 
 #endif // MAP_HPP
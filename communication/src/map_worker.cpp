@@ -0,0 +1,361 @@
+/*
+
+file: map_worker.cpp
+created: 2026-10-17
+
+Long lived mapping thread.
+
+*/
+
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+
+#include "map_worker.hpp"
+#include "raycast.hpp"
+#include "logging.hpp"
+
+
+//A scan becomes a keyframe when this far (mm) or turned this much (degrees) from the previous keyframe
+#define KEYFRAME_DISTANCE 150
+#define KEYFRAME_ANGLE 15
+
+//How sure the motion between consecutive keyframes is, standard deviations in mm and degrees
+#define KEYFRAME_STD 20
+#define KEYFRAME_ROT_STD 1
+
+//Loops are closed against keyframes at least this many keyframes old and this close (mm) to the latest one
+#define LOOP_MIN_AGE 20
+#define LOOP_SEARCH_DISTANCE 1000
+
+//Old keyframes within this distance (mm) of the one closed against make up the map matched against
+#define LOOP_SUBMAP_RADIUS 1500
+
+//Search window of the loop closure match, how much of the points must fit and how sure the match is then
+#define LOOP_WINDOW 800
+#define LOOP_ANGLE 20
+#define LOOP_MIN_SCORE 0.6
+#define LOOP_STD 30
+#define LOOP_ROT_STD 2
+
+//Keyframes each thread casts before the updates are applied when redrawing, bounds the memory the updates take
+#define REDRAW_BATCH 8
+
+
+// a cell a ray passed through or ended in
+struct CellUpdate
+{
+    int32_t col;
+    int32_t row;
+    Tile tile;
+};
+
+
+void draw_keyframes(Map& map, const std::vector<Keyframe>& keyframes, ThreadPool* pool)
+{
+    RayCaster caster(map.cell_size());
+    if(!pool || pool->size() <= 1)
+    {
+        Map::Cursor cursor;
+        for(const Keyframe& keyframe : keyframes)
+        {
+            caster.cast(keyframe.nodes, keyframe.pose,
+                [&](int col, int row){ map.update(col, row, Tile::EMPTY, cursor); },
+                [&](int col, int row){ map.update(col, row, Tile::WALL, cursor); }
+            );
+        }
+        return;
+    }
+
+    // updates[part * bands + band]: cells of band from the keyframes of part, in the order they were cast
+    const size_t parts = pool->size();
+    const int bands = pool->size();
+    std::vector<std::vector<CellUpdate>> updates(parts * bands);
+    auto band_of = [bands](int row){ return ((row >> Map::CHUNK_BITS) % bands + bands) % bands; };
+
+    for(size_t first = 0; first < keyframes.size(); first += REDRAW_BATCH * parts)
+    {
+        size_t count = std::min(keyframes.size() - first, REDRAW_BATCH * parts);
+
+        // every thread casts the rays of its share of the keyframes, the parts are in keyframe order
+        pool->parallel_for(parts, [&](size_t begin, size_t end) {
+            for(size_t part = begin; part < end; part++)
+            {
+                std::vector<CellUpdate>* mine = &updates[part * bands];
+                for(int band = 0; band < bands; band++) mine[band].clear();
+                for(size_t k = first + count * part / parts; k < first + count * (part + 1) / parts; k++)
+                {
+                    caster.cast(keyframes[k].nodes, keyframes[k].pose,
+                        [&](int col, int row){ mine[band_of(row)].push_back({col, row, Tile::EMPTY}); },
+                        [&](int col, int row){ mine[band_of(row)].push_back({col, row, Tile::WALL}); }
+                    );
+                }
+            }
+        }, 1);
+
+        // every band is applied by one thread, part after part, so each cell keeps a single writer and its order
+        pool->parallel_for(bands, [&](size_t begin, size_t end) {
+            for(size_t band = begin; band < end; band++)
+            {
+                Map::Cursor cursor;
+                for(size_t part = 0; part < parts; part++)
+                {
+                    for(const CellUpdate& update : updates[part * bands + band]) map.update(update.col, update.row, update.tile, cursor);
+                }
+            }
+        }, 1);
+    }
+}
+
+
+MapWorker::MapWorker(Map& map, ThreadPool& pool, size_t capacity, DropPolicy policy, bool match_scans) :
+    map(map),
+    pool(pool),
+    queue(capacity, policy),
+    processed_scans(0),
+    matched_scans(0),
+    closed_loops(0),
+    keyframe_count(0),
+    loop_requested(false),
+    match_scans(match_scans),
+    matcher(),
+    correction{0, 0, 0},
+    latest_pose{0, 0, 0},
+    thread(&MapWorker::run, this)
+{
+
+}
+
+MapWorker::~MapWorker()
+{
+    stop();
+}
+
+
+void MapWorker::stop()
+{
+    // integrate what is left in the queue, then stop
+    queue.close();
+    if(!thread.joinable()) return;
+    thread.join();
+    INFO("map worker stopped, processed: ", processed(), ", matched: ", matched(), ", dropped: ", dropped(), ", loops: ", loops());
+}
+
+
+void MapWorker::close_loop()
+{
+    loop_requested.store(true);
+}
+
+
+void MapWorker::push(const ScanFramePtr& frame, const Pose& pose)
+{
+    queue.push({frame, pose});
+}
+
+
+unsigned long long MapWorker::processed() const
+{
+    return processed_scans.load();
+}
+
+Pose MapWorker::pose() const
+{
+    std::lock_guard<std::mutex> lock(pose_mutex);
+    return latest_pose;
+}
+
+
+unsigned long long MapWorker::matched() const
+{
+    return matched_scans.load();
+}
+
+unsigned long long MapWorker::dropped() const
+{
+    return queue.dropped();
+}
+
+QueueStats MapWorker::queue_stats() const
+{
+    return queue.stats();
+}
+
+size_t MapWorker::depth() const
+{
+    return queue.depth();
+}
+
+size_t MapWorker::keyframes() const
+{
+    return keyframe_count.load();
+}
+
+unsigned long long MapWorker::loops() const
+{
+    return closed_loops.load();
+}
+
+
+void MapWorker::run()
+{
+    Job job;
+    while(queue.pop(job))
+    {
+        integrate(job);
+        processed_scans++;
+
+        // let the frame go back to the rplidar while waiting for the next one
+        job.frame = ScanFramePtr();
+
+        if(loop_requested.exchange(false)) find_loop();
+    }
+
+    // a loop asked for while stopping
+    if(loop_requested.exchange(false)) find_loop();
+}
+
+
+void MapWorker::integrate(const Job& job)
+{
+    // odometry pose moved by how far off odometry was last time (or by the last loop closure)
+    Pose pose = correction * job.pose;
+    if(match_scans)
+    {
+        // until the map has walls there is nothing to match and the guess is used
+        ScanMatch match = matcher.match(map, job.frame->nodes(), pose);
+        pose = match.pose;
+        if(match.matched)
+        {
+            correction = match.pose * inverse(job.pose);
+            matched_scans++;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pose_mutex);
+        latest_pose = pose;
+    }
+    add_keyframe(job.frame->nodes(), pose);
+
+    RayCaster caster(map.cell_size());
+    Map::Cursor cursor;
+
+    // set cells between robot and hit to empty and the hit cell to wall
+    caster.cast(job.frame->nodes(), pose,
+        [this, &cursor](int col, int row){ map.update(col, row, Tile::EMPTY, cursor); },
+        [this, &cursor](int col, int row){ map.update(col, row, Tile::WALL, cursor); }
+    );
+}
+
+
+void MapWorker::add_keyframe(const std::vector<ScanNode>& nodes, const Pose& pose)
+{
+    if(!keyframe_scans.empty())
+    {
+        Pose delta = inverse(keyframe_scans.back().pose) * pose;
+        if(std::hypot(delta.x, delta.y) < KEYFRAME_DISTANCE && std::abs(delta.rot) < KEYFRAME_ANGLE) return;
+
+        // consecutive keyframes are tied together by the motion between them
+        Eigen::Matrix3d information = Eigen::Vector3d(
+            1.0 / (KEYFRAME_STD * KEYFRAME_STD),
+            1.0 / (KEYFRAME_STD * KEYFRAME_STD),
+            1.0 / std::pow(KEYFRAME_ROT_STD * M_PI / 180.0, 2)).asDiagonal();
+        graph.add_edge(keyframe_scans.size() - 1, keyframe_scans.size(), delta, information);
+    }
+
+    // the scan frame goes back to the rplidar, so keep a copy of the points
+    keyframe_scans.push_back({pose, nodes});
+    graph.add_node(pose);
+    keyframe_count.store(keyframe_scans.size());
+}
+
+
+bool MapWorker::find_loop()
+{
+    if(keyframe_scans.size() <= LOOP_MIN_AGE) return false;
+    const Keyframe& latest = keyframe_scans.back();
+    int last_old = keyframe_scans.size() - 1 - LOOP_MIN_AGE;
+
+    // closest old keyframe
+    int closest = -1;
+    float closest_distance = LOOP_SEARCH_DISTANCE;
+    for(int i = 0; i <= last_old; i++)
+    {
+        float distance = std::hypot(keyframe_scans[i].pose.x - latest.pose.x, keyframe_scans[i].pose.y - latest.pose.y);
+        if(distance < closest_distance)
+        {
+            closest = i;
+            closest_distance = distance;
+        }
+    }
+    if(closest < 0)
+    {
+        INFO("no keyframe to close a loop with");
+        return false;
+    }
+
+    // map of the old keyframes only, the current map has already drifted along with the robot
+    Map submap(map.cell_size(), map.occupancy_config());
+    RayCaster caster(map.cell_size());
+    Map::Cursor cursor;
+    const Pose& center = keyframe_scans[closest].pose;
+    for(int i = 0; i <= last_old; i++)
+    {
+        const Keyframe& keyframe = keyframe_scans[i];
+        if(std::hypot(keyframe.pose.x - center.x, keyframe.pose.y - center.y) > LOOP_SUBMAP_RADIUS) continue;
+        caster.cast(keyframe.nodes, keyframe.pose,
+            [&](int col, int row){ submap.update(col, row, Tile::EMPTY, cursor); },
+            [&](int col, int row){ submap.update(col, row, Tile::WALL, cursor); }
+        );
+    }
+
+    // drift can be large, search a wide window without preferring the drifted guess
+    ScanMatcherConfig config;
+    config.linear_window = LOOP_WINDOW;
+    config.angular_window = LOOP_ANGLE;
+    config.min_score = LOOP_MIN_SCORE;
+    config.translation_cost = 0;
+    config.rotation_cost = 0;
+    ScanMatcher loop_matcher(config);
+    ScanMatch match = loop_matcher.match(submap, latest.nodes, latest.pose);
+    if(!match.matched)
+    {
+        INFO("could not close loop with keyframe ", closest);
+        return false;
+    }
+
+    Eigen::Matrix3d information = Eigen::Vector3d(
+        1.0 / (LOOP_STD * LOOP_STD),
+        1.0 / (LOOP_STD * LOOP_STD),
+        1.0 / std::pow(LOOP_ROT_STD * M_PI / 180.0, 2)).asDiagonal();
+    graph.add_edge(closest, keyframe_scans.size() - 1, inverse(center) * match.pose, information);
+    double before = graph.error();
+    double after = graph.optimize();
+
+    // later scans follow the corrected latest keyframe
+    Pose moved = graph.pose(keyframe_scans.size() - 1) * inverse(latest.pose);
+    correction = moved * correction;
+    for(size_t i = 0; i < keyframe_scans.size(); i++) keyframe_scans[i].pose = graph.pose(i);
+    {
+        std::lock_guard<std::mutex> lock(pose_mutex);
+        latest_pose = moved * latest_pose;
+    }
+
+    INFO("closed loop with keyframe ", closest, " of ", keyframe_scans.size(), ", error ", before, " -> ", after,
+         ", latest keyframe moved ", moved.x, ", ", moved.y, ", ", moved.rot);
+    redraw();
+    closed_loops++;
+    return true;
+}
+
+
+void MapWorker::redraw()
+{
+    Map redrawn(map.cell_size(), map.occupancy_config());
+    draw_keyframes(redrawn, keyframe_scans, &pool);
+
+    // readers of the map see the redraw as ordinary changes
+    map.assign(redrawn);
+}
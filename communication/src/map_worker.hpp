@@ -0,0 +1,146 @@
+/*
+
+file: map_worker.hpp
+created: 2026-10-17
+
+Long lived mapping thread.
+
+Scans are queued together with the pose they were taken at and integrated
+into the map one at a time, so the map only ever has a single writer.
+
+The queued poses come from odometry and drift. When scan matching is on,
+each scan is first matched against the map around its pose, corrected by
+the previous match, and integrated at the matched pose instead.
+
+Matching against the map still drifts slowly, the map follows along. To
+undo that, every scan taken far enough from the previous one is kept as a
+keyframe in a pose graph, tied to the previous keyframe by the motion
+between them. When asked to close a loop, the latest keyframe is matched
+against a map of the old keyframes around it; if it fits, that match is
+added as an edge, the graph is optimized and the map is drawn again from
+the corrected keyframes. The rays are cast over a thread pool, each thread
+its share of the keyframes, into cell updates sorted by bands of chunk rows.
+Each band is then applied by one thread, so every cell still has a single
+writer and gets its updates in keyframe order.
+
+*/
+
+
+#ifndef MAP_WORKER_HPP
+#define MAP_WORKER_HPP
+
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "bounded_queue.hpp"
+#include "map.hpp"
+#include "pose.hpp"
+#include "pose_graph.hpp"
+#include "scan_frame.hpp"
+#include "scan_matcher.hpp"
+#include "thread_pool.hpp"
+
+
+// a scan kept to draw the map again from, and the pose it was taken at
+struct Keyframe
+{
+    Pose pose;
+    std::vector<ScanNode> nodes;
+};
+
+
+// draw keyframes into map, every cell gets the same updates in the same order as when drawn one by one
+// pool: threads to split the rays over, nullptr draws them all on the calling thread
+void draw_keyframes(Map& map, const std::vector<Keyframe>& keyframes, ThreadPool* pool);
+
+
+class MapWorker
+{
+public:
+    // map: map to integrate scans into, must outlive the worker
+    // pool: threads to draw the map again with after a loop closure, must outlive the worker
+    // capacity: max number of scans waiting to be integrated
+    // policy: which scan to drop when mapping falls behind
+    // match_scans: match scans against the map before integrating them
+    MapWorker(Map& map, ThreadPool& pool, size_t capacity = 4, DropPolicy policy = DropPolicy::DROP_OLDEST, bool match_scans = true);
+    ~MapWorker();
+
+    // integrate the queued scans, close a loop if asked to and stop the thread
+    void stop();
+
+    // try to close a loop at the latest keyframe after the scans queued so far, e.g. back at the start
+    void close_loop();
+
+    // queue a scan for integration, never blocks
+    // frame: the scan, held until it has been integrated
+    // pose: robot pose from odometry when the scan was taken
+    void push(const ScanFramePtr& frame, const Pose& pose);
+
+    // pose the latest scan was integrated at
+    Pose pose() const;
+
+    // number of scans integrated into the map
+    unsigned long long processed() const;
+
+    // number of scans integrated at a matched pose
+    unsigned long long matched() const;
+
+    // scans waiting to be integrated and how long they waited
+    QueueStats queue_stats() const;
+
+    // number of scans dropped because mapping fell behind
+    unsigned long long dropped() const;
+
+    // number of scans waiting to be integrated
+    size_t depth() const;
+
+    // number of keyframes and closed loops
+    size_t keyframes() const;
+    unsigned long long loops() const;
+
+private:
+    struct Job
+    {
+        ScanFramePtr frame;
+        Pose pose;
+    };
+
+    // worker thread loop
+    void run();
+
+    // integrate a single scan into the map
+    void integrate(const Job& job);
+
+    // keep the scan as a keyframe if it is far enough from the previous one
+    void add_keyframe(const std::vector<ScanNode>& nodes, const Pose& pose);
+
+    // match the latest keyframe against old keyframes near it and optimize, returns true if a loop was closed
+    bool find_loop();
+
+    // draw the map again from the keyframes
+    void redraw();
+
+    Map& map;
+    ThreadPool& pool;
+    BoundedQueue<Job> queue;
+    std::atomic<unsigned long long> processed_scans;
+    std::atomic<unsigned long long> matched_scans;
+    std::atomic<unsigned long long> closed_loops;
+    std::atomic<size_t> keyframe_count;
+    std::atomic<bool> loop_requested;
+
+    // only used by the worker thread
+    bool match_scans;
+    ScanMatcher matcher;
+    Pose correction;        // latest matched pose relative to its odometry pose
+    std::vector<Keyframe> keyframe_scans;
+    PoseGraph graph;        // one node per keyframe
+
+    mutable std::mutex pose_mutex;
+    Pose latest_pose;
+    std::thread thread;
+};
+
+#endif // MAP_WORKER_HPP
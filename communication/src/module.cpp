@@ -24,8 +24,29 @@ Module::~Module()
 }
 
 
+int
+Module::get_fd()
+{
+    return serial.get_fd();
+}
+
+
 void
 Module::set_pc(const std::shared_ptr<PC>& pc)
 {
     this->pc = pc;
+}
+
+
+void
+Module::attach(EventLoop& loop)
+{
+    serial.attach(loop);
+}
+
+
+SerialStats
+Module::serial_stats() const
+{
+    return serial.stats();
 }
\ No newline at end of file
@@ -20,6 +20,7 @@ Base class for modules (steering and sensor).
 
 
 class PC;
+class EventLoop;
 
 
 enum ModuleId : uint8_t
@@ -36,7 +37,13 @@ public:
     virtual ~Module();
 
     virtual void update() = 0;
+    // serial fd, readable when the module sent something
+    int get_fd();
     void set_pc(const std::shared_ptr<PC>& pc);
+    // write to the module from loop when its port is writable, loop must outlive the module
+    void attach(EventLoop& loop);
+    // bytes written and frames queued and dropped on the way to the module
+    SerialStats serial_stats() const;
 
 protected:
     Serial serial;
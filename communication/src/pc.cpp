@@ -11,6 +11,8 @@ Interface to PC client.
 
 #include <vector>
 #include <string>
+#include <cmath>
+#include <algorithm>
 
 #include <json/json.hpp>
 #include <deque>
@@ -22,7 +24,34 @@ Interface to PC client.
 using json = nlohmann::json;
 
 
-PC::PC() : socket(30), command_callback(), calibration_callback(), map_clock(std::clock())
+// default number of map updates per second
+#define MAP_RATE 5.0f
+
+// max number of messages waiting for the telemetry thread, more are dropped
+#define OUTGOING_CAPACITY 256
+
+// max number of commands waiting for the control thread
+#define INCOMING_CAPACITY 64
+
+
+PC::PC() :
+    command_callback(),
+    calibration_callback(),
+    control_loop(nullptr),
+    telemetry_loop(),
+    socket(30),
+    outgoing(OUTGOING_CAPACITY),
+    incoming(INCOMING_CAPACITY),
+    outgoing_ready(),
+    incoming_ready(),
+    stopping(false),
+    telemetry_thread(),
+    timers(nullptr),
+    map_timer(0),
+    map_due(true),
+    map_period(1.0f / MAP_RATE),
+    sent_tiles(MAP_SIZE * MAP_SIZE, Tile::UNKNOWN),
+    sent_version(0)
 {
     // route all received data here
     socket.on_json([this](json data, int sd)
@@ -35,26 +64,55 @@ PC::PC() : socket(30), command_callback(), calibration_callback(), map_clock(std
         {
             TRACE("received command from pc");
             SteeringCommand command = (SteeringCommand)data["type"].get<int>();
-            this->command_callback(command);
+            this->deliver([this, command](){ this->command_callback(command); });
         }
         else if(id == "calibration")
         {
             TRACE("received calibration from pc");
             float kp = data["kp"].get<float>();
             float kd = data["kd"].get<float>();
-            this->calibration_callback(kp, kd);
+            this->deliver([this, kp, kd](){ this->calibration_callback(kp, kd); });
         }
         else
         {
             TRACE("received unknown id from pc");
         }        
     });
+
+    // a client behind gets the latest state, not every one in between, but every map change
+    for(const char* topic : {"robot", "sensor", "steering", "rplidar", "segments", "pipeline", "latency"})
+    {
+        socket.set_topic_policy(topic, TopicPolicy::COALESCE);
+    }
+    for(const char* topic : {"map", "tiles", "tile", "message"})
+    {
+        socket.set_topic_policy(topic, TopicPolicy::KEEP);
+    }
+
+    // new clients get the tiles everyone else has, changes are streamed on top of them
+    socket.on_connect([this](int sd)
+    {
+        TRACE("sending map snapshot to new pc");
+        this->socket.send_to_client_json(sd,
+        {
+            {"id", "map"},
+            {"tiles", this->sent_tiles}
+        });
+    });
     socket.start_socket();
 }
 
 PC::~PC()
 {
-
+    if(telemetry_thread.joinable())
+    {
+        // messages queued before are still sent
+        stopping.store(true);
+        outgoing_ready.notify();
+        telemetry_thread.join();
+        control_loop->remove(incoming_ready.fd());
+    }
+    if(timers) timers->cancel(map_timer);
 }
 
 
@@ -63,97 +121,239 @@ void PC::update()
     socket.check_activity();
 }
 
+void PC::attach(EventLoop& loop)
+{
+    if(control_loop) return;
+    control_loop = &loop;
+    loop.add(incoming_ready.fd(), [this](){ run_incoming(); });
+
+    // set up before the thread starts, the telemetry loop is only touched by the thread after that
+    socket.attach(telemetry_loop);
+    telemetry_loop.add(outgoing_ready.fd(), [this](){ run_outgoing(); });
+    timers = &telemetry_loop.timers();
+    start_map_timer();
+    telemetry_thread = std::thread(&PC::telemetry, this);
+}
+
+
+void PC::telemetry()
+{
+    telemetry_loop.run([this](){ return !stopping.load(); });
+    run_outgoing();
+}
+
+
+void PC::post(Task task)
+{
+    if(!control_loop)
+    {
+        task();
+        return;
+    }
+    if(outgoing.push(std::move(task))) outgoing_ready.notify();
+}
+
+
+void PC::deliver(Task task)
+{
+    if(!control_loop)
+    {
+        task();
+        return;
+    }
+    if(incoming.push(std::move(task))) incoming_ready.notify();
+    else WARN("command from pc dropped, control thread is not keeping up");
+}
+
+
+void PC::run_outgoing()
+{
+    // clear first, a message queued in between notifies again
+    outgoing_ready.clear();
+    Task task;
+    while(outgoing.pop(task)) task();
+}
+
+
+void PC::run_incoming()
+{
+    incoming_ready.clear();
+    Task task;
+    while(incoming.pop(task)) task();
+}
+
+
+QueueStats PC::outgoing_stats() const
+{
+    return outgoing.stats();
+}
+
+
+QueueStats PC::incoming_stats() const
+{
+    return incoming.stats();
+}
+
+void PC::start_map_timer()
+{
+    timers->cancel(map_timer);
+    map_timer = timers->every(std::chrono::milliseconds((int)(map_period * 1000)), [this](){ map_due = true; });
+}
+
 
 void PC::send_json(const json& data)
 {
     TRACE("sending json to pc");
-    socket.send_to_clients_json(data);
+    post([this, data](){ socket.send_to_clients_json(data); });
 }
 
 void PC::message(const std::string& text)
 {
     //TRACE("sending message to pc");
-    socket.send_to_clients_json
-    ({
-        {"id", "message"},
-        {"text", text}  
+    post([this, text](){
+        socket.send_to_clients_json
+        ({
+            {"id", "message"},
+            {"text", text}  
+        });
     });
 }
 
 void PC::tile(const int col, const int row, Tile tile)
 {
     //TRACE("sending tile to pc");
-    socket.send_to_clients_json
-    ({
-        {"id", "tile"},
-        {"col", col},
-        {"row", row},
-        {"type", (int)tile}
+    post([this, col, row, tile](){
+        socket.send_to_clients_json
+        ({
+            {"id", "tile"},
+            {"col", col},
+            {"row", row},
+            {"type", (int)tile}
+        });
     });
 }
 
 void PC::map(const Map& map)
 {
-    std::clock_t now = std::clock();
-    if((now - map_clock) / CLOCKS_PER_SEC >= 1)
+    post([this, &map](){ send_map(map); });
+}
+
+void PC::send_map(const Map& map)
+{
+    // without timers every call sends
+    if(timers && !map_due) return;
+    map_due = false;
+
+    uint64_t latest;
+    std::vector<std::pair<int, int>> changed = map.changed_chunks(sent_version, latest);
+    sent_version = latest;
+    if(changed.empty()) return;
+
+    // the map can be finer than the tiles shown by the PC, use the cell at the center of each tile
+    const float scale = (float)Map::TILE_SIZE / map.cell_size();
+    std::vector<int> cells(MAP_SIZE);
+    for(int i = 0; i < MAP_SIZE; i++) cells[i] = (int)std::floor((i - MAP_ORIGIN) * scale + 0.5f);
+
+    // only look at tiles sampled from changed chunks, and only send the ones that differ from what was sent
+    std::vector<json> tiles;
+    for(const auto& [chunk_col, chunk_row] : changed)
     {
-        std::vector<Tile> tiles;
-        for(int r = 0; r < Map::MAP_SIZE; r++)
+        int r_begin = std::lower_bound(cells.begin(), cells.end(), chunk_row) - cells.begin();
+        int r_end = std::lower_bound(cells.begin(), cells.end(), chunk_row + Map::CHUNK_SIZE) - cells.begin();
+        int c_begin = std::lower_bound(cells.begin(), cells.end(), chunk_col) - cells.begin();
+        int c_end = std::lower_bound(cells.begin(), cells.end(), chunk_col + Map::CHUNK_SIZE) - cells.begin();
+        for(int r = r_begin; r < r_end; r++)
         {
-            for(int c = 0; c < Map::MAP_SIZE; c++)
+            for(int c = c_begin; c < c_end; c++)
             {
-                tiles.push_back(map.get(c, r));
+                Tile tile = map.get(cells[c], cells[r]);
+                Tile& sent = sent_tiles[r * MAP_SIZE + c];
+                if(tile == sent) continue;
+                sent = tile;
+                tiles.push_back({c, r, (int)tile});
             }
         }
-        socket.send_to_clients_json
-        ({
-            {"id", "map"},
-            {"tiles", tiles}
-        });
-        map_clock = std::clock();
     }
-    //TRACE("sending map to pc");
+
+    //TRACE("sending changed tiles to pc");
+    if(tiles.empty()) return;
+    socket.send_to_clients_json
+    ({
+        {"id", "tiles"},
+        {"tiles", tiles}
+    });
+}
+
+void PC::set_map_rate(const float rate)
+{
+    post([this, rate](){
+        map_period = 1.0f / rate;
+        if(timers) start_map_timer();
+    });
 }
 
 void PC::robot(const float x, const float y, const float r)
 {
     //TRACE("sending robot state to pc");
-    socket.send_to_clients_json
-    ({
-        {"id", "robot"},
-        {"x", x},
-        {"y", y},
-        {"r", r}
+    post([this, x, y, r](){
+        socket.send_to_clients_json
+        ({
+            {"id", "robot"},
+            {"x", x},
+            {"y", y},
+            {"r", r}
+        });
     });
 }
 
 
 void PC::rplidar(const std::vector<ScanNode>& nodes)
 {
-    std::vector<json> json_nodes;
-    for (const ScanNode &node: nodes)
-    {
-        json_nodes.push_back
-        ({
-            {"dist", node.dist},
-            {"angle", node.angle},
-            {"quality", node.quality}
+    // encoding is what takes time, only the nodes are copied on the caller's thread
+    post([this, nodes](){
+        std::vector<json> json_nodes;
+        for (const ScanNode &node: nodes)
+        {
+            json_nodes.push_back
+            ({
+                {"dist", node.dist},
+                {"angle", node.angle},
+                {"quality", node.quality}
+            });
+        }
+        socket.send_to_clients_json({
+            {"id", "rplidar"},
+            {"nodes", json_nodes}
+        });
+    });
+}
+
+
+void PC::segments(const std::vector<LineSegment>& segments)
+{
+    post([this, segments](){
+        std::vector<json> json_segments;
+        for (const LineSegment& segment : segments)
+        {
+            json_segments.push_back({segment.start.x, segment.start.y, segment.end.x, segment.end.y});
+        }
+        socket.send_to_clients_json({
+            {"id", "segments"},
+            {"segments", json_segments}
         });
-    }
-    socket.send_to_clients_json({
-        {"id", "rplidar"},
-        {"nodes", json_nodes}
     });
 }
 
 
 void PC::point(const float col, const float row)
 {
-    socket.send_to_clients_json
-    ({
-        {"id", "point"},
-        {"col", col},
-        {"row", row}
+    post([this, col, row](){
+        socket.send_to_clients_json
+        ({
+            {"id", "point"},
+            {"col", col},
+            {"row", row}
+        });
     });
 }
 
@@ -161,12 +361,14 @@ void PC::point(const float col, const float row)
 void PC::sensor(const SensorMeasurement& measurement)
 {
     //TRACE("sending sensor measurement to pc");
-    socket.send_to_clients_json
-    ({
-        {"id", "sensor"},
-        {"left", measurement.left},
-        {"right", measurement.right},
-        {"rot", measurement.rot}
+    post([this, measurement](){
+        socket.send_to_clients_json
+        ({
+            {"id", "sensor"},
+            {"left", measurement.left},
+            {"right", measurement.right},
+            {"rot", measurement.rot}
+        });
     });
 }
 
@@ -174,13 +376,15 @@ void PC::sensor(const SensorMeasurement& measurement)
 void PC::steering(const SteeringControl& control)
 {
     //TRACE("sending steering control to pc");
-    socket.send_to_clients_json
-    ({
-        {"id", "steering"},
-        {"left_speed", control.left_speed},
-        {"right_speed", control.right_speed},
-        {"left_forward", control.left_forward},
-        {"right_forward", control.right_forward}
+    post([this, control](){
+        socket.send_to_clients_json
+        ({
+            {"id", "steering"},
+            {"left_speed", control.left_speed},
+            {"right_speed", control.right_speed},
+            {"left_forward", control.left_forward},
+            {"right_forward", control.right_forward}
+        });
     });
 }
 
@@ -6,6 +6,13 @@ created: 2019-11-25
 
 Interface to PC client.
 
+Once attached to the control thread's event loop, clients are served by a
+telemetry thread of its own. Messages are queued by the control thread and
+encoded to JSON and sent by the telemetry thread, so a slow client or a
+large scan never holds up steering. A client that falls behind gets only
+the latest robot state, sensor measurement, steering and scan. Commands from clients go the other way
+and are called back on the control thread.
+
 */
 
 
@@ -15,6 +22,9 @@ Interface to PC client.
 #include <string>
 #include <functional>
 #include <chrono>
+#include <vector>
+#include <thread>
+#include <atomic>
 
 #include <json/json.hpp>
 
@@ -23,6 +33,9 @@ Interface to PC client.
 #include "sensor.hpp"
 #include "rplidar.hpp"
 #include "socket.hpp"
+#include "event_loop.hpp"
+#include "spsc_queue.hpp"
+#include "line_extractor.hpp"
 
 
 class PC
@@ -31,8 +44,13 @@ public:
     PC();
     ~PC();
 
+    // handle clients that connected or sent something, without waiting
     void update();
 
+    // serve clients from a telemetry thread, update is not needed then.
+    // commands and calibrations are called back on loop, messages must only be sent from loop's thread from now on.
+    void attach(EventLoop& loop);
+
     // send any JSON to PC
     // json: json to send
     void send_json(const nlohmann::json& data);
@@ -46,10 +64,16 @@ public:
     // tile: tile's type
     void tile(const int col, const int row, Tile tile);
     
-    // send full map to PC.
+    // send tiles changed since last time to PC, at most map rate times per second once attached.
+    // the map is read by the telemetry thread and must outlive the PC.
+    // each tile shown by the PC is sampled at its center, new clients get all tiles when they connect.
     // map: the map
     void map(const Map& map);
 
+    // set how many times per second changed tiles are sent
+    // rate: updates per second
+    void set_map_rate(const float rate);
+
     // send robot state to PC.
     // (x, y): robot's position in tile units
     // r: robots rotation in radians
@@ -59,6 +83,10 @@ public:
     // nodes: vector of scannodes
     void rplidar(const std::vector<ScanNode>& nodes);
 
+    // send wall segments of the latest scan to PC
+    // segments: segments in mm in the robot frame
+    void segments(const std::vector<LineSegment>& segments);
+
     // send debug point to PC
     // (col, row): point's position
     // color: point's color TODO
@@ -82,12 +110,54 @@ public:
     // set calibration callback
     void on_calibration(CalibrationCallback callback);
 
+    // messages waiting for the telemetry thread, and commands waiting for the control thread
+    QueueStats outgoing_stats() const;
+    QueueStats incoming_stats() const;
+
+    const static int MAP_ORIGIN = 10000/Map::TILE_SIZE;    // the PC shows tiles within 10m of the start, (MAP_ORIGIN, MAP_ORIGIN) is the start tile
+    const static int MAP_SIZE = 2*MAP_ORIGIN + 1;          // number of tiles shown in each dimension
+
 private:
-    Socket socket;
+    using Task = std::function<void()>;
+
+    // run task on the telemetry thread, right away when there is none
+    void post(Task task);
+    // run task on the control thread, right away when not attached
+    void deliver(Task task);
+
+    // telemetry thread, serves clients and runs queued messages until stopped
+    void telemetry();
+    void run_outgoing();
+    void run_incoming();
+
+    // diff and send the map, on the telemetry thread
+    void send_map(const Map& map);
+
     CommandCallback command_callback;
     CalibrationCallback calibration_callback;
 
-    std::clock_t map_clock;
+    EventLoop* control_loop;
+    EventLoop telemetry_loop;
+    Socket socket;          // after the loop that serves it, so it goes first
+    SpscQueue<Task> outgoing;
+    SpscQueue<Task> incoming;
+    Notifier outgoing_ready;
+    Notifier incoming_ready;
+    std::atomic<bool> stopping;
+    std::thread telemetry_thread;
+
+    TimerWheel* timers;
+    TimerWheel::Id map_timer;
+    bool map_due;           // a map period passed since the map was last sent
+    float map_period;
+
+    // send maps every map period from now on, on the telemetry thread
+    void start_map_timer();
+
+    // tiles as last sent to clients, row major
+    std::vector<Tile> sent_tiles;
+    // map version the sent tiles are up to date with
+    uint64_t sent_version;
 };
 
 #endif // PC_HPP
\ No newline at end of file
@@ -0,0 +1,48 @@
+/*
+
+file: pose.hpp
+created: 2026-10-17
+
+Robot pose in the map frame.
+
+x is to the right and y is forward when the robot is at its starting
+rotation, rotation is counter clockwise. A pose is also a rigid transform
+(SE(2)) taking points in the robot frame to the map frame, so poses can be
+composed to chain relative motions.
+
+*/
+
+
+#ifndef POSE_HPP
+#define POSE_HPP
+
+#include <cmath>
+
+
+struct Pose
+{
+    // position of robot in mm, (0, 0) is the starting position
+    float x, y;
+
+    // rotation of robot in degrees, same convention as the gyro
+    float rot;
+};
+
+
+// pose b expressed in the frame of pose a, i.e. a followed by the relative motion b
+inline Pose operator*(const Pose& a, const Pose& b)
+{
+    float r = a.rot * (float)M_PI / 180.0f;
+    float c = std::cos(r), s = std::sin(r);
+    return Pose{a.x + c*b.x - s*b.y, a.y + s*b.x + c*b.y, a.rot + b.rot};
+}
+
+// relative motion undoing pose a
+inline Pose inverse(const Pose& a)
+{
+    float r = a.rot * (float)M_PI / 180.0f;
+    float c = std::cos(r), s = std::sin(r);
+    return Pose{-c*a.x - s*a.y, s*a.x - c*a.y, -a.rot};
+}
+
+#endif // POSE_HPP
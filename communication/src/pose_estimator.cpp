@@ -0,0 +1,190 @@
+/*
+
+file: pose_estimator.cpp
+created: 2026-10-17
+
+Robot pose from gyro, scan matching and wheel commands.
+
+*/
+
+
+#include <cmath>
+#include <algorithm>
+
+#include "pose_estimator.hpp"
+
+
+static const float DEG_TO_RAD = (float)M_PI / 180.0f;
+
+
+// wrap angle in radians to [-pi, pi)
+static float wrap(float angle)
+{
+    angle = std::fmod(angle + (float)M_PI, 2.0f * (float)M_PI);
+    if(angle < 0) angle += 2.0f * (float)M_PI;
+    return angle - (float)M_PI;
+}
+
+
+// signed speed of a wheel pair in mm/s, from the pwm Steering::transmit_control sends for it
+static float wheel_speed(float speed, bool forward, float full_speed)
+{
+    return (forward ? 1.0f : -1.0f) * full_speed * speed_pwm(speed) / 255.0f;
+}
+
+
+PoseEstimator::PoseEstimator(const PoseEstimatorConfig& config) :
+    config(config)
+{
+    reset(Pose{0, 0, 0}, std::chrono::steady_clock::now());
+}
+
+
+void PoseEstimator::reset(const Pose& pose, std::chrono::steady_clock::time_point time, float position_std, float rotation_std)
+{
+    state << pose.x, pose.y, pose.rot * DEG_TO_RAD, pose.x, pose.y, pose.rot * DEG_TO_RAD;
+
+    // the copy is the same pose, fully correlated with it
+    Eigen::Matrix3f P = Eigen::Vector3f(position_std * position_std, position_std * position_std,
+                                        std::pow(rotation_std * DEG_TO_RAD, 2.0f)).asDiagonal();
+    covariance << P, P, P, P;
+
+    latest.time = time;
+    publish();
+}
+
+
+void PoseEstimator::predict(const SteeringControl& control, std::chrono::steady_clock::time_point time)
+{
+    float dt = std::chrono::duration<float>(time - latest.time).count();
+    latest.time = time;
+    dt = std::clamp(dt, 0.0f, config.max_dt);
+    if(dt == 0.0f) return;
+
+    // differential drive, turning left is counter-clockwise like the gyro
+    float left = wheel_speed(control.left_speed, control.left_forward, config.full_speed);
+    float right = wheel_speed(control.right_speed, control.right_forward, config.full_speed);
+    float v = (left + right) / 2.0f;
+    float w = (right - left) / config.track_width;
+
+    // move along the heading halfway through the motion, forward is y when the rotation is 0
+    float mid = state(2) + w * dt / 2.0f;
+    float c = std::cos(mid), s = std::sin(mid);
+    state(0) += -s * v * dt;
+    state(1) += c * v * dt;
+    state(2) += w * dt;
+
+    // jacobian of the motion with respect to the state, the copy does not move
+    Covariance F = Covariance::Identity();
+    F(0, 2) = -c * v * dt;
+    F(1, 2) = -s * v * dt;
+
+    // and with respect to the speeds (v, w) and sideways slip, all uncertain in proportion to the speeds
+    Eigen::Matrix<float, 6, 3> G = Eigen::Matrix<float, 6, 3>::Zero();
+    G(0, 0) = -s * dt;
+    G(0, 1) = -c * v * dt * dt / 2.0f;
+    G(0, 2) = c * dt;
+    G(1, 0) = c * dt;
+    G(1, 1) = -s * v * dt * dt / 2.0f;
+    G(1, 2) = s * dt;
+    G(2, 1) = dt;
+    float left_std = std::max(config.min_speed_noise, config.speed_noise * std::abs(left));
+    float right_std = std::max(config.min_speed_noise, config.speed_noise * std::abs(right));
+    float slip_std = std::max(config.min_speed_noise, config.slip_noise * std::abs(v));
+    float v_var = (left_std * left_std + right_std * right_std) / 4.0f;
+    float w_var = (left_std * left_std + right_std * right_std) / (config.track_width * config.track_width);
+    Eigen::Matrix3f Q = Eigen::Vector3f(v_var, w_var, slip_std * slip_std).asDiagonal();
+
+    covariance = F * covariance * F.transpose() + G * Q * G.transpose();
+    publish();
+}
+
+
+void PoseEstimator::update_rotation(float rot)
+{
+    update_rotation(rot, config.gyro_std);
+}
+
+
+void PoseEstimator::update_rotation(float rot, float std)
+{
+    Eigen::Matrix<float, 1, 6> H = Eigen::Matrix<float, 1, 6>::Zero();
+    H(0, 2) = 1.0f;
+    Eigen::Matrix<float, 1, 1> innovation(rot * DEG_TO_RAD - state(2));
+    Eigen::Matrix<float, 1, 1> R(std::pow(std * DEG_TO_RAD, 2.0f));
+    correct<1>(H, innovation, R);
+    publish();
+}
+
+
+void PoseEstimator::update_odometry(const Pose& delta, const Eigen::Matrix3f& covariance)
+{
+    // motion from the copy to the current pose, in the frame of the copy
+    float dx = state(0) - state(3), dy = state(1) - state(4);
+    float c = std::cos(state(5)), s = std::sin(state(5));
+    float hx = c * dx + s * dy;
+    float hy = -s * dx + c * dy;
+
+    Eigen::Matrix<float, 3, 6> H;
+    H << c,  s, 0, -c, -s,  hy,
+        -s,  c, 0,  s, -c, -hx,
+         0,  0, 1,  0,  0,  -1;
+
+    Eigen::Vector3f innovation(delta.x - hx, delta.y - hy, wrap(delta.rot * DEG_TO_RAD - (state(2) - state(5))));
+
+    Eigen::Matrix3f R = covariance;
+    R(0, 0) = std::max(R(0, 0), config.min_odometry_std * config.min_odometry_std);
+    R(1, 1) = std::max(R(1, 1), config.min_odometry_std * config.min_odometry_std);
+    R(2, 2) = std::max(R(2, 2), std::pow(config.min_odometry_rot_std * DEG_TO_RAD, 2.0f));
+
+    correct<3>(H, innovation, R);
+    clone();
+    publish();
+}
+
+
+void PoseEstimator::update_position(float x, float y, float std)
+{
+    Eigen::Matrix<float, 2, 6> H = Eigen::Matrix<float, 2, 6>::Zero();
+    H(0, 0) = 1.0f;
+    H(1, 1) = 1.0f;
+    Eigen::Vector2f innovation(x - state(0), y - state(1));
+    Eigen::Matrix2f R = Eigen::Matrix2f::Identity() * std::max(std * std, 1e-3f);
+    correct<2>(H, innovation, R);
+    publish();
+}
+
+
+const PoseEstimate& PoseEstimator::estimate() const
+{
+    return latest;
+}
+
+
+template<int n>
+void PoseEstimator::correct(const Eigen::Matrix<float, n, 6>& H, const Eigen::Matrix<float, n, 1>& innovation, const Eigen::Matrix<float, n, n>& R)
+{
+    Eigen::Matrix<float, n, n> S = H * covariance * H.transpose() + R;
+    Eigen::Matrix<float, 6, n> K = covariance * H.transpose() * S.inverse();
+    state += K * innovation;
+
+    // joseph form keeps the covariance positive definite in floats
+    Covariance I_KH = Covariance::Identity() - K * H;
+    covariance = I_KH * covariance * I_KH.transpose() + K * R * K.transpose();
+}
+
+
+void PoseEstimator::clone()
+{
+    state.tail<3>() = state.head<3>();
+    covariance.block<3, 3>(3, 3) = covariance.block<3, 3>(0, 0);
+    covariance.block<3, 3>(0, 3) = covariance.block<3, 3>(0, 0);
+    covariance.block<3, 3>(3, 0) = covariance.block<3, 3>(0, 0);
+}
+
+
+void PoseEstimator::publish()
+{
+    latest.pose = Pose{state(0), state(1), state(2) / DEG_TO_RAD};
+    latest.covariance = covariance.block<3, 3>(0, 0);
+}
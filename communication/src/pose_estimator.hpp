@@ -0,0 +1,105 @@
+/*
+
+file: pose_estimator.hpp
+created: 2026-10-17
+
+Robot pose from gyro, scan matching and wheel commands.
+
+An extended Kalman filter over the pose (x, y in mm, rotation in radians).
+Between measurements the pose is moved by the speeds the steering module
+was commanded, with a lot of noise since there are no wheel encoders. The
+gyro measures the rotation directly. Scan matching measures the motion
+between two scans, so the filter keeps a copy of the pose at the previous
+scan in its state (stochastic cloning) and updates both with the relative
+motion, the copy is replaced by the current pose afterwards.
+
+Rotation is not wrapped, it follows the gyro so it can be compared with
+target rotations directly. All matrices have a fixed size and nothing is
+allocated after construction.
+
+*/
+
+
+#ifndef POSE_ESTIMATOR_HPP
+#define POSE_ESTIMATOR_HPP
+
+#include <chrono>
+#include <Eigen/Dense>
+
+#include "pose.hpp"
+#include "steering.hpp"
+
+
+struct PoseEstimatorConfig
+{
+    float full_speed = 600.0f;          // mm/s of a wheel pair at pwm 255
+    float track_width = 180.0f;         // mm between the left and right wheels
+    float speed_noise = 1.0f;           // standard deviation of wheel speeds as a fraction of the commanded speed, speeds depend on the battery...
+    float min_speed_noise = 5.0f;       // ...but at least this many mm/s
+    float slip_noise = 0.2f;            // standard deviation of sideways speed as a fraction of the forward speed
+    float gyro_std = 1.0f;              // degrees
+    float min_odometry_std = 2.0f;      // mm, scan match covariances are floored to this...
+    float min_odometry_rot_std = 0.2f;  // ...and this many degrees, they are often too sure of themselves
+    float max_dt = 0.5f;                // s, longer gaps between predictions are cut to this
+};
+
+
+struct PoseEstimate
+{
+    Pose pose;
+    Eigen::Matrix3f covariance;                     // of (x, y, rot) in mm and radians
+    std::chrono::steady_clock::time_point time;     // when the pose was last predicted
+};
+
+
+class PoseEstimator
+{
+public:
+    PoseEstimator(const PoseEstimatorConfig& config = PoseEstimatorConfig());
+
+    // start over at a known pose, position_std in mm and rotation_std in degrees
+    void reset(const Pose& pose, std::chrono::steady_clock::time_point time, float position_std = 0.0f, float rotation_std = 0.0f);
+
+    // move the pose with the wheel speeds commanded since the last prediction
+    void predict(const SteeringControl& control, std::chrono::steady_clock::time_point time);
+
+    // gyro rotation in degrees, same convention as Pose
+    void update_rotation(float rot);
+
+    // rotation in degrees measured some other way, std in degrees
+    void update_rotation(float rot, float std);
+
+    // motion since the previous scan from scan matching, in the robot frame of the previous scan
+    // covariance: of (x, y, rot) in mm and radians
+    void update_odometry(const Pose& delta, const Eigen::Matrix3f& covariance);
+
+    // position measured some other way, std in mm
+    void update_position(float x, float y, float std);
+
+    // latest pose with covariance and time
+    const PoseEstimate& estimate() const;
+
+private:
+    using State = Eigen::Matrix<float, 6, 1>;
+    using Covariance = Eigen::Matrix<float, 6, 6>;
+
+    // kalman update with a measurement of size n, innovation is the measurement minus what the state predicts
+    template<int n>
+    void correct(const Eigen::Matrix<float, n, 6>& H, const Eigen::Matrix<float, n, 1>& innovation, const Eigen::Matrix<float, n, n>& R);
+
+    // copy the current pose over the previous scan pose
+    void clone();
+
+    // write the current pose to the estimate
+    void publish();
+
+    PoseEstimatorConfig config;
+
+    // current pose, then pose at the previous scan
+    State state;
+    Covariance covariance;
+
+    PoseEstimate latest;
+};
+
+#endif // POSE_ESTIMATOR_HPP
@@ -0,0 +1,174 @@
+/*
+
+file: pose_graph.cpp
+created: 2026-10-17
+
+Pose graph optimization.
+
+*/
+
+
+#include <cmath>
+#include <Eigen/SparseCholesky>
+
+#include "pose_graph.hpp"
+
+
+// wrap angle in radians to [-pi, pi)
+static double wrap(double angle)
+{
+    angle = std::fmod(angle + M_PI, 2.0 * M_PI);
+    if(angle < 0) angle += 2.0 * M_PI;
+    return angle - M_PI;
+}
+
+
+// residual of an edge and its jacobians with respect to the from and to poses, rotations in radians
+static Eigen::Vector3d residual(const Pose& a, const Pose& b, const PoseGraphEdge& edge, Eigen::Matrix3d* A = nullptr, Eigen::Matrix3d* B = nullptr)
+{
+    double ra = a.rot * M_PI / 180.0, rz = edge.delta.rot * M_PI / 180.0;
+    Eigen::Matrix2d Ra, Rz, dRa;
+    Ra << std::cos(ra), -std::sin(ra), std::sin(ra), std::cos(ra);
+    Rz << std::cos(rz), -std::sin(rz), std::sin(rz), std::cos(rz);
+    dRa << -std::sin(ra), -std::cos(ra), std::cos(ra), -std::sin(ra);
+
+    // difference between the measured motion and the one between the poses, in the frame of the measurement
+    Eigen::Vector2d t(b.x - a.x, b.y - a.y);
+    Eigen::Vector3d e;
+    e.head<2>() = Rz.transpose() * (Ra.transpose() * t - Eigen::Vector2d(edge.delta.x, edge.delta.y));
+    e(2) = wrap((b.rot - a.rot) * M_PI / 180.0 - rz);
+
+    if(A && B)
+    {
+        A->setZero();
+        A->block<2, 2>(0, 0) = -Rz.transpose() * Ra.transpose();
+        A->block<2, 1>(0, 2) = Rz.transpose() * dRa.transpose() * t;
+        (*A)(2, 2) = -1;
+
+        B->setZero();
+        B->block<2, 2>(0, 0) = Rz.transpose() * Ra.transpose();
+        (*B)(2, 2) = 1;
+    }
+    return e;
+}
+
+
+PoseGraph::PoseGraph()
+{
+
+}
+
+
+int PoseGraph::add_node(const Pose& pose)
+{
+    nodes.push_back(pose);
+    return nodes.size() - 1;
+}
+
+
+void PoseGraph::add_edge(int from, int to, const Pose& delta, const Eigen::Matrix3d& information)
+{
+    edges.push_back({from, to, delta, information});
+}
+
+
+double PoseGraph::optimize(int max_iterations)
+{
+    if(nodes.size() < 2) return error();
+
+    // the first node is fixed, the others are variables 3 * (node - 1) to 3 * node - 1
+    int n = 3 * (nodes.size() - 1);
+    std::vector<Eigen::Triplet<double>> triplets;
+    Eigen::SparseMatrix<double> H(n, n);
+    Eigen::VectorXd b(n);
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> solver;
+    bool analyzed = false;
+
+    for(int iteration = 0; iteration < max_iterations; iteration++)
+    {
+        triplets.clear();
+        b.setZero();
+
+        for(const PoseGraphEdge& edge : edges)
+        {
+            Eigen::Matrix3d A, B;
+            Eigen::Vector3d e = residual(nodes[edge.from], nodes[edge.to], edge, &A, &B);
+            const Eigen::Matrix3d& omega = edge.information;
+
+            int blocks[2] = {3 * (edge.from - 1), 3 * (edge.to - 1)};
+            const Eigen::Matrix3d* J[2] = {&A, &B};
+            for(int i = 0; i < 2; i++)
+            {
+                if(blocks[i] < 0) continue;
+                b.segment<3>(blocks[i]) += J[i]->transpose() * omega * e;
+                for(int j = 0; j < 2; j++)
+                {
+                    if(blocks[j] < 0) continue;
+                    Eigen::Matrix3d block = J[i]->transpose() * omega * *J[j];
+                    for(int r = 0; r < 3; r++)
+                        for(int c = 0; c < 3; c++)
+                            triplets.emplace_back(blocks[i] + r, blocks[j] + c, block(r, c));
+                }
+            }
+        }
+
+        // duplicate entries are summed, the sparsity pattern is the same every iteration
+        H.setFromTriplets(triplets.begin(), triplets.end());
+        if(!analyzed)
+        {
+            solver.analyzePattern(H);
+            analyzed = true;
+        }
+        solver.factorize(H);
+        if(solver.info() != Eigen::Success) break;
+        Eigen::VectorXd dx = -solver.solve(b);
+
+        // rotations are solved in radians and stored in degrees
+        for(size_t node = 1; node < nodes.size(); node++)
+        {
+            Eigen::Vector3d step = dx.segment<3>(3 * (node - 1));
+            nodes[node].x += step(0);
+            nodes[node].y += step(1);
+            nodes[node].rot += step(2) * 180.0 / M_PI;
+        }
+        if(dx.lpNorm<Eigen::Infinity>() < 1e-3) break;
+    }
+    return error();
+}
+
+
+double PoseGraph::error() const
+{
+    double sum = 0;
+    for(const PoseGraphEdge& edge : edges)
+    {
+        Eigen::Vector3d e = residual(nodes[edge.from], nodes[edge.to], edge);
+        sum += e.dot(edge.information * e);
+    }
+    return sum;
+}
+
+
+const Pose& PoseGraph::pose(int node) const
+{
+    return nodes[node];
+}
+
+
+size_t PoseGraph::node_count() const
+{
+    return nodes.size();
+}
+
+
+size_t PoseGraph::edge_count() const
+{
+    return edges.size();
+}
+
+
+void PoseGraph::clear()
+{
+    nodes.clear();
+    edges.clear();
+}
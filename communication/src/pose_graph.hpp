@@ -0,0 +1,66 @@
+/*
+
+file: pose_graph.hpp
+created: 2026-10-17
+
+Pose graph optimization.
+
+Nodes are robot poses, edges are measured motions between two of them with
+an information matrix saying how sure the measurement is. Consecutive poses
+are tied together by odometry, a loop closure ties a pose to one seen long
+before. Optimizing finds the poses that agree best with all edges at once,
+which spreads the error a loop closure reveals over the whole loop instead
+of leaving it all at the end.
+
+Solved with Gauss-Newton on a sparse system, the first node is held fixed.
+
+*/
+
+
+#ifndef POSE_GRAPH_HPP
+#define POSE_GRAPH_HPP
+
+#include <vector>
+#include <Eigen/Dense>
+
+#include "pose.hpp"
+
+
+struct PoseGraphEdge
+{
+    int from, to;                   // node indices
+    Pose delta;                     // pose of to in the frame of from
+    Eigen::Matrix3d information;    // of (x, y, rot) in mm and radians
+};
+
+
+class PoseGraph
+{
+public:
+    PoseGraph();
+
+    // add a node at an initial guess, returns its index
+    int add_node(const Pose& pose);
+
+    // add a measured motion from one node to another
+    void add_edge(int from, int to, const Pose& delta, const Eigen::Matrix3d& information);
+
+    // move the nodes to agree with the edges, returns the remaining error
+    double optimize(int max_iterations = 20);
+
+    // sum of squared edge errors weighted by their information
+    double error() const;
+
+    const Pose& pose(int node) const;
+
+    size_t node_count() const;
+    size_t edge_count() const;
+
+    void clear();
+
+private:
+    std::vector<Pose> nodes;
+    std::vector<PoseGraphEdge> edges;
+};
+
+#endif // POSE_GRAPH_HPP
@@ -0,0 +1,96 @@
+/*
+
+file: queue_stats.hpp
+created: 2026-10-17
+
+Depth and latency counters of a queue between two threads.
+
+The producer counts pushed and dropped items and the deepest the queue has
+been, the consumer how long items waited from push to pop. Every counter
+has a single writer, so they are plain relaxed atomics.
+
+*/
+
+
+#ifndef QUEUE_STATS_HPP
+#define QUEUE_STATS_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+
+struct QueueStats
+{
+    size_t depth = 0;                   // items waiting now
+    size_t max_depth = 0;               // most items waiting at once
+    unsigned long long pushed = 0;      // items pushed, including dropped ones
+    unsigned long long dropped = 0;     // items dropped because the queue was full
+    unsigned long long popped = 0;
+    double mean_latency_ms = 0;         // time from push to pop of the popped items...
+    double max_latency_ms = 0;          // ...on average and at most
+};
+
+
+class QueueCounters
+{
+public:
+    // monotonic time to stamp pushed items with
+    static int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // producer side, depth: items waiting after the push
+    void on_push(size_t depth)
+    {
+        pushed.store(pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if(depth > max_depth.load(std::memory_order_relaxed)) max_depth.store(depth, std::memory_order_relaxed);
+    }
+
+    // whether depth would be a new max depth, producer side
+    bool above_max(size_t depth) const
+    {
+        return depth > max_depth.load(std::memory_order_relaxed);
+    }
+
+    void on_drop()
+    {
+        dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // consumer side, pushed_ns: now_ns when the item was pushed
+    void on_pop(int64_t pushed_ns)
+    {
+        int64_t latency = std::max<int64_t>(0, now_ns() - pushed_ns);
+        popped.store(popped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        latency_sum.store(latency_sum.load(std::memory_order_relaxed) + latency, std::memory_order_relaxed);
+        if(latency > latency_max.load(std::memory_order_relaxed)) latency_max.store(latency, std::memory_order_relaxed);
+    }
+
+    // depth: items waiting now, as known by the queue
+    QueueStats stats(size_t depth) const
+    {
+        QueueStats stats;
+        stats.depth = depth;
+        stats.max_depth = max_depth.load(std::memory_order_relaxed);
+        stats.pushed = pushed.load(std::memory_order_relaxed);
+        stats.dropped = dropped.load(std::memory_order_relaxed);
+        stats.popped = popped.load(std::memory_order_relaxed);
+        if(stats.popped > 0) stats.mean_latency_ms = latency_sum.load(std::memory_order_relaxed) / 1e6 / stats.popped;
+        stats.max_latency_ms = latency_max.load(std::memory_order_relaxed) / 1e6;
+        return stats;
+    }
+
+private:
+    std::atomic<unsigned long long> pushed{0};
+    std::atomic<unsigned long long> dropped{0};
+    std::atomic<size_t> max_depth{0};
+    std::atomic<unsigned long long> popped{0};
+    std::atomic<int64_t> latency_sum{0};
+    std::atomic<int64_t> latency_max{0};
+};
+
+#endif // QUEUE_STATS_HPP
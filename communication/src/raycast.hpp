@@ -0,0 +1,122 @@
+/*
+
+file: raycast.hpp
+created: 2026-10-17
+
+Grid traversal of rplidar rays.
+
+Amanatides-Woo traversal done in 16.16 fixed point, so every cell crossed by
+a ray is visited exactly once and no square roots are needed. Cells are in
+map cell units relative to the starting position: cell (0, 0) is the cell the
+robot started in, i.e. position (0, 0) mm is in the middle of it.
+
+*/
+
+
+#ifndef RAYCAST_HPP
+#define RAYCAST_HPP
+
+#include <stdint.h>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "pose.hpp"
+#include "rplidar.hpp"
+
+
+class RayCaster
+{
+public:
+    // cell_size: size of each cell in mm
+    RayCaster(float cell_size) : cell_size(cell_size) {}
+
+    // visit all cells crossed by the segment from (x0, y0) to (x1, y1), in cell units
+    // on_cell(col, row) is called once for every cell except the one containing (x1, y1),
+    // which is written to (end_col, end_row)
+    template<typename F>
+    static void trace(float x0, float y0, float x1, float y1, F&& on_cell, int& end_col, int& end_row);
+
+    // cast all rays of a scan from a pose
+    // on_empty(col, row) is called for every cell a ray passes through
+    // on_hit(col, row) is called for the cell each ray ends in
+    // failed measurements (distance 0) are skipped
+    template<typename Empty, typename Hit>
+    void cast(const std::vector<ScanNode>& nodes, const Pose& pose, Empty&& on_empty, Hit&& on_hit) const;
+
+private:
+    const static int FRACTION_BITS = 16;
+    const static int64_t ONE = (int64_t)1 << FRACTION_BITS;
+
+    // floor of a fixed point value as an integer cell
+    static int64_t floor_cell(int64_t fixed) { return fixed >= 0 ? fixed / ONE : -((-fixed + ONE - 1) / ONE); }
+
+    float cell_size;
+};
+
+
+template<typename F>
+void RayCaster::trace(float x0, float y0, float x1, float y1, F&& on_cell, int& end_col, int& end_row)
+{
+    // fixed point start and end
+    int64_t fx0 = std::llround(x0 * ONE), fy0 = std::llround(y0 * ONE);
+    int64_t fx1 = std::llround(x1 * ONE), fy1 = std::llround(y1 * ONE);
+
+    int64_t col = floor_cell(fx0), row = floor_cell(fy0);
+    end_col = floor_cell(fx1);
+    end_row = floor_cell(fy1);
+
+    int64_t dx = std::llabs(fx1 - fx0), dy = std::llabs(fy1 - fy0);
+    int step_col = fx1 > fx0 ? 1 : -1;
+    int step_row = fy1 > fy0 ? 1 : -1;
+
+    // distance along each axis to the next cell boundary, in fixed point
+    int64_t next_x = step_col > 0 ? (col + 1) * ONE - fx0 : fx0 - col * ONE;
+    int64_t next_y = step_row > 0 ? (row + 1) * ONE - fy0 : fy0 - row * ONE;
+
+    // every step crosses exactly one boundary
+    int64_t steps = std::llabs(end_col - col) + std::llabs(end_row - row);
+    for(int64_t s = 0; s < steps; s++)
+    {
+        on_cell((int)col, (int)row);
+
+        // next_x/dx < next_y/dy without dividing, a zero delta never wins
+        if(next_x * dy < next_y * dx || dy == 0)
+        {
+            col += step_col;
+            next_x += ONE;
+        }
+        else
+        {
+            row += step_row;
+            next_y += ONE;
+        }
+    }
+}
+
+
+template<typename Empty, typename Hit>
+void RayCaster::cast(const std::vector<ScanNode>& nodes, const Pose& pose, Empty&& on_empty, Hit&& on_hit) const
+{
+    // robot position in cell units, (0, 0) mm is in the middle of cell (0, 0)
+    float src_x = pose.x / cell_size + 0.5f;
+    float src_y = pose.y / cell_size + 0.5f;
+
+    for(const ScanNode& node : nodes)
+    {
+        if(node.dist == 0) continue;
+
+        // delta vector between robot and hit position
+        float a = (-node.angle + pose.rot - 90.0f) * (float)M_PI / 180.0f;
+        float range = (float)node.dist / cell_size;
+        float dst_x = src_x - range * std::cos(a);
+        float dst_y = src_y - range * std::sin(a);
+
+        int hit_col, hit_row;
+        trace(src_x, src_y, dst_x, dst_y, on_empty, hit_col, hit_row);
+        on_hit(hit_col, hit_row);
+    }
+}
+
+
+#endif // RAYCAST_HPP
@@ -0,0 +1,46 @@
+/*
+
+file: realtime.cpp
+created: 2026-10-17
+
+Pin threads to a core and raise their scheduling priority.
+
+*/
+
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "realtime.hpp"
+#include "logging.hpp"
+
+
+bool pin_thread(int cpu)
+{
+    if(cpu < 0 || cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if(error != 0)
+    {
+        WARN("could not pin thread to cpu ", cpu, ", error ", error);
+        return false;
+    }
+    return true;
+}
+
+
+bool set_realtime_priority(int priority)
+{
+    sched_param param{};
+    param.sched_priority = priority;
+    int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if(error != 0)
+    {
+        WARN("could not set real-time priority ", priority, ", error ", error);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,25 @@
+/*
+
+file: realtime.hpp
+created: 2026-10-17
+
+Pin threads to a core and raise their scheduling priority.
+
+Threads created afterwards inherit both from their creator, so pin a thread
+after the threads that should run elsewhere have been started.
+
+*/
+
+
+#ifndef REALTIME_HPP
+#define REALTIME_HPP
+
+
+// run the calling thread on cpu only, returns false if there is no such cpu
+bool pin_thread(int cpu);
+
+// schedule the calling thread first-in first-out at priority (1-99) ahead of every normal thread,
+// returns false if not allowed (needs root or CAP_SYS_NICE)
+bool set_realtime_priority(int priority);
+
+#endif // REALTIME_HPP
@@ -0,0 +1,101 @@
+/*
+
+file: replay_rplidar.cpp
+created: 2026-10-17
+
+Scan source replaying a recorded scan log instead of a real rplidar.
+
+*/
+
+
+#include "replay_rplidar.hpp"
+#include "rplidar.hpp"
+#include "logging.hpp"
+#include "latency.hpp"
+
+
+ReplayRPLidar::ReplayRPLidar(const std::string& file, ReplayPace pace, bool loop) :
+    scan_log(),
+    buffer(RPLidar::MAX_NODES),
+    pace(pace),
+    loop(loop),
+    started(false),
+    next_frame(0),
+    start_us(0),
+    first_timestamp_us(0)
+{
+    INFO("Replay rplidar constructor, file: ", file);
+    if(scan_log.open(file)) INFO("replaying ", scan_log.frame_count(), " scans");
+}
+
+ReplayRPLidar::~ReplayRPLidar()
+{
+
+}
+
+
+bool ReplayRPLidar::is_ok()
+{
+    return scan_log.frame_count() > 0;
+}
+
+void ReplayRPLidar::start_scanning()
+{
+    if(started || !is_ok()) return;
+    started = true;
+    next_frame = 0;
+    start_us = scan_log_time_us();
+    first_timestamp_us = scan_log.frame(0).timestamp_us;
+}
+
+void ReplayRPLidar::stop_motor()
+{
+    started = false;
+}
+
+
+ScanFramePtr ReplayRPLidar::get_scan()
+{
+    start_scanning();
+    if(!started) return ScanFramePtr();
+
+    if(next_frame >= scan_log.frame_count())
+    {
+        if(!loop) return ScanFramePtr();
+        started = false;
+        start_scanning();
+    }
+
+    ScanLogReader::Frame next = scan_log.frame(next_frame);
+    if(pace == ReplayPace::REAL_TIME && scan_log_time_us() - start_us < next.timestamp_us - first_timestamp_us)
+    {
+        return ScanFramePtr();
+    }
+
+    // in real time, skip frames that are already late so the newest one is returned like the rplidar does
+    while(pace == ReplayPace::REAL_TIME && next_frame + 1 < scan_log.frame_count()
+        && scan_log_time_us() - start_us >= scan_log.frame(next_frame + 1).timestamp_us - first_timestamp_us)
+    {
+        next = scan_log.frame(++next_frame);
+    }
+    next_frame++;
+
+    ScanFrame* frame = buffer.acquire();
+    if(!frame) return ScanFramePtr();
+    frame->build(next.nodes, next.count);
+    frame->set_completed(monotonic_ns());
+    buffer.publish(frame);
+    return buffer.take();
+}
+
+
+QueueStats ReplayRPLidar::queue_stats()
+{
+    return buffer.stats();
+}
+
+
+bool ReplayRPLidar::finished() const
+{
+    return !loop && next_frame >= scan_log.frame_count();
+}
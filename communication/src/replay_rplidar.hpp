@@ -0,0 +1,61 @@
+/*
+
+file: replay_rplidar.hpp
+created: 2026-10-17
+
+Scan source replaying a recorded scan log instead of a real rplidar.
+
+*/
+
+
+#ifndef REPLAY_RPLIDAR_HPP
+#define REPLAY_RPLIDAR_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#include "scan_source.hpp"
+#include "scan_buffer.hpp"
+#include "scan_log.hpp"
+
+
+enum class ReplayPace : int
+{
+    REAL_TIME = 0,      // scans become available with the same spacing as when recorded
+    FAST = 1            // every call to get_scan returns the next scan
+};
+
+
+class ReplayRPLidar : public ScanSource
+{
+public:
+    // file: scan log to replay
+    // pace: how fast to replay
+    // loop: start over when the end of the log is reached
+    ReplayRPLidar(const std::string& file, ReplayPace pace = ReplayPace::REAL_TIME, bool loop = false);
+    ~ReplayRPLidar();
+
+    virtual bool is_ok();
+    virtual void start_scanning();
+    virtual void stop_motor();
+    virtual ScanFramePtr get_scan();
+    virtual QueueStats queue_stats();
+
+    // true when all scans have been replayed and the replay does not loop
+    bool finished() const;
+
+private:
+    ScanLogReader scan_log;
+    ScanBuffer buffer;
+    ReplayPace pace;
+    bool loop;
+    bool started;
+    size_t next_frame;
+
+    // monotonic time replay started and timestamp of the first frame, in microseconds
+    uint64_t start_us;
+    uint64_t first_timestamp_us;
+};
+
+#endif // REPLAY_RPLIDAR_HPP
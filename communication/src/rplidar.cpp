@@ -12,10 +12,19 @@ RPLIDAR driver wrapper class.
 #include "rplidar.hpp"
 #include <vector>
 #include <signal.h>
+#include <chrono>
 #include "stdio.h"
 #include "logging.hpp"
+#include "latency.hpp"
 
-RPLidar::RPLidar(const std::string& port_name) {
+// max time to wait for a scan before checking if the scan thread should stop
+#define SCAN_TIMEOUT_MS 100
+
+RPLidar::RPLidar(const std::string& port_name) :
+    buffer(MAX_NODES),
+    raw_nodes(new rplidar_response_measurement_node_hq_t[MAX_NODES]),
+    scanning(false)
+{
     INFO("Rplidar constructor, port: ", port_name);
     opt_com_path = port_name;
     driver = RPlidarDriver::CreateDriver(DRIVER_TYPE_SERIALPORT);
@@ -35,6 +44,7 @@ RPLidar::RPLidar(const std::string& port_name) {
 }
 
 RPLidar::~RPLidar() {
+    stop_scan_thread();
     on_finish();
 }
 
@@ -46,6 +56,13 @@ void RPLidar::print_err(const char* msg) {
     ERROR(msg);
 }
 
+void RPLidar::start_motor(){
+    if (status < 0){
+        return;
+    }
+    driver->startMotor();
+}
+
 void RPLidar::start_scanning(){
     if (status < 0){
         return;
@@ -53,40 +70,69 @@ void RPLidar::start_scanning(){
     driver->startMotor();
     driver->startScan(0, 1);
     status = SCANNING;
+
+    if (!scan_thread.joinable()) {
+        scanning.store(true);
+        scan_thread = std::thread(&RPLidar::scan_loop, this);
+    }
 }
 
 void RPLidar::print_scan(){
-    vector<ScanNode> nodes = get_scan();
-    for (const ScanNode &node: nodes) {
+    ScanFramePtr frame = get_scan();
+    if (!frame) return;
+    for (const ScanNode &node: frame->nodes()) {
         node.print();
     }
 }
-vector<ScanNode> RPLidar::get_scan(){
-    vector<ScanNode> res;
 
+ScanFramePtr RPLidar::get_scan(){
     if (status == OK) {
         start_scanning();
     } else if (status < 0) {
-        return res;    
+        return ScanFramePtr();
     }
-    size_t count = 8192;
-    rplidar_response_measurement_node_hq_t nodes[8192];
-
-    // Timeout = 0 -> No waiting
-    op_result = driver->grabScanDataHq(nodes, count, 0); 
-    // cout is now equal to how many nodes were fetched
-    if (IS_OK(op_result)) {
-        driver->ascendScanData(nodes, count);
-        for (int pos = 0; pos < (int)count ; ++pos) {
-            res.push_back({
-                nodes[pos].dist_mm_q2/4,
-                nodes[pos].angle_z_q14 * 90.f / (1 << 14),
-                nodes[pos].quality
-            });
-        
+    return buffer.take();
+}
+
+int RPLidar::event_fd(){
+    return buffer.event_fd();
+}
+
+QueueStats RPLidar::queue_stats(){
+    return buffer.stats();
+}
+
+void RPLidar::scan_loop(){
+    while (scanning.load()) {
+        // blocks until the driver's cache thread has a complete scan
+        size_t count = MAX_NODES;
+        u_result result = driver->grabScanDataHq(raw_nodes.get(), count, SCAN_TIMEOUT_MS);
+        if (!IS_OK(result)) {
+            if (result != RESULT_OPERATION_TIMEOUT) std::this_thread::sleep_for(std::chrono::milliseconds(SCAN_TIMEOUT_MS));
+            continue;
         }
+        int64_t completed = monotonic_ns();
+        driver->ascendScanData(raw_nodes.get(), count);
+        recorder.write(scan_log_time_us(), raw_nodes.get(), count);
+
+        // all frames held by readers, drop scan
+        ScanFrame* frame = buffer.acquire();
+        if (!frame) continue;
+
+        frame->build(raw_nodes.get(), count);
+        frame->set_completed(completed);
+        buffer.publish(frame);
     }
-    return res;
+}
+
+bool RPLidar::record(const std::string& file){
+    INFO("recording rplidar scans to ", file);
+    return recorder.open(file);
+}
+
+void RPLidar::stop_scan_thread(){
+    scanning.store(false);
+    if (scan_thread.joinable()) scan_thread.join();
 }
 
 void RPLidar::print_node(rplidar_response_measurement_node_hq_t node){
@@ -98,6 +144,7 @@ void RPLidar::print_node(rplidar_response_measurement_node_hq_t node){
 }
 
 void RPLidar::stop_motor(){
+    stop_scan_thread();
     driver->stop();
     driver->stopMotor();
 }
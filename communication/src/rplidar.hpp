@@ -6,6 +6,9 @@ created: 2019-11-17
 
 RPLIDAR driver wrapper class.
 
+Scans are fetched from the driver on a separate thread as soon as they are
+complete and handed to readers through a ScanBuffer.
+
 */
 
 #pragma once
@@ -14,23 +17,19 @@ RPLIDAR driver wrapper class.
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <atomic>
+#include <memory>
+#include <thread>
 
 #include <rplidar/rplidar_inc.h>
+#include "scan_buffer.hpp"
+#include "scan_log.hpp"
+#include "scan_source.hpp"
 using namespace std;
 using namespace rp::standalone::rplidar; // Only 4 variables in namespace
 
 //using rplib = rp::standalone::rplidar;
 
-struct ScanNode {
-    uint32_t dist;
-    float angle; 
-    uint8_t quality;
-    void print() const {
-        int q = (int) quality;
-        cout << "Dist: " << dist << " Angle: " << angle << " Quality: " << q << endl;
-    }
-};
-
 enum RPLidarStatus : int {
     BAD_HEALTH = -3,
     NO_DRIVER_CONNECTION = -2,
@@ -39,17 +38,26 @@ enum RPLidarStatus : int {
     SCANNING = 1
 };
 
-class RPLidar {
+class RPLidar : public ScanSource {
 
 public:
     RPLidar(const std::string& file);
     ~RPLidar();
     bool check_health();
-    bool is_ok();
-    void stop_motor();
-    void start_scanning();
-    vector<ScanNode> get_scan();
+    virtual bool is_ok();
+    virtual void stop_motor();
+    virtual void start_motor();
+    virtual void start_scanning();
+    // get newest scan, empty if there has been no new scan since last call
+    virtual ScanFramePtr get_scan();
+    // readable when the scan thread published a scan
+    virtual int event_fd();
+    virtual QueueStats queue_stats();
     void print_scan();
+    // record every scan to a scan log, call before start_scanning
+    bool record(const std::string& file);
+
+    const static size_t MAX_NODES = 8192;
 private:
     RPLidarStatus status;
     RPlidarDriver* driver;
@@ -59,5 +67,15 @@ private:
     void print_err(const char* msg);
     void print_node(rplidar_response_measurement_node_hq_t node);
     void on_finish();
-    
+
+    // fetch scans from driver until stopped
+    void scan_loop();
+    void stop_scan_thread();
+
+    ScanBuffer buffer;
+    std::unique_ptr<rplidar_response_measurement_node_hq_t[]> raw_nodes;
+    std::thread scan_thread;
+    std::atomic<bool> scanning;
+    ScanLogWriter recorder;
+
 };
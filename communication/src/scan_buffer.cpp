@@ -0,0 +1,87 @@
+/*
+
+file: scan_buffer.cpp
+created: 2026-10-17
+
+Lock-free hand-off of scans from the rplidar thread to its readers.
+
+*/
+
+
+#include "scan_buffer.hpp"
+
+
+ScanBuffer::ScanBuffer(const size_t capacity) : frames(new ScanFrame[FRAMES]), latest(-1), dropped_frames(0)
+{
+    for(int i = 0; i < FRAMES; i++) frames[i].scan.reserve(capacity);
+}
+
+ScanBuffer::~ScanBuffer()
+{
+
+}
+
+
+ScanFrame* ScanBuffer::acquire()
+{
+    for(int i = 0; i < FRAMES; i++)
+    {
+        // acquire pairs with the release in ~ScanFramePtr, so readers are done with the frame
+        if(frames[i].refs.load(std::memory_order_acquire) == 0)
+        {
+            frames[i].refs.store(1, std::memory_order_relaxed);
+            return &frames[i];
+        }
+    }
+    dropped_frames++;
+    return nullptr;
+}
+
+
+void ScanBuffer::publish(ScanFrame* frame)
+{
+    published_ns[frame - frames.get()] = QueueCounters::now_ns();
+    counters.on_push(1);
+
+    // the reference taken in acquire now belongs to the published slot
+    int previous = latest.exchange(frame - frames.get(), std::memory_order_acq_rel);
+    if(previous >= 0)
+    {
+        frames[previous].refs.fetch_sub(1, std::memory_order_release);
+        dropped_frames++;
+    }
+    published.notify();
+}
+
+
+ScanFramePtr ScanBuffer::take()
+{
+    // clear before taking, a frame published in between notifies again instead of being missed
+    published.clear();
+
+    // the reference of the published slot is handed over to the returned handle
+    int index = latest.exchange(-1, std::memory_order_acq_rel);
+    if(index < 0) return ScanFramePtr();
+    counters.on_pop(published_ns[index]);
+    return ScanFramePtr(&frames[index]);
+}
+
+
+int ScanBuffer::event_fd() const
+{
+    return published.fd();
+}
+
+
+unsigned long long ScanBuffer::dropped() const
+{
+    return dropped_frames.load();
+}
+
+
+QueueStats ScanBuffer::stats() const
+{
+    QueueStats stats = counters.stats(latest.load() >= 0 ? 1 : 0);
+    stats.dropped = dropped();
+    return stats;
+}
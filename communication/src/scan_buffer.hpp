@@ -0,0 +1,76 @@
+/*
+
+file: scan_buffer.hpp
+created: 2026-10-17
+
+Lock-free hand-off of scans from the rplidar thread to its readers.
+
+A fixed pool of frames is allocated up front. The rplidar thread fills a
+frame nobody holds and publishes it, replacing the previously published
+frame if it was never taken. Readers take the newest published frame as a
+ScanFramePtr. A frame with no handles (reference count 0) can never gain
+one again, so the rplidar thread can reuse it without locking.
+
+Publishing also makes an eventfd readable, so a reader can wait for scans
+in an event loop instead of polling take.
+
+*/
+
+
+#ifndef SCAN_BUFFER_HPP
+#define SCAN_BUFFER_HPP
+
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+
+#include "scan_frame.hpp"
+#include "event_loop.hpp"
+#include "queue_stats.hpp"
+
+
+class ScanBuffer
+{
+public:
+    // capacity: number of nodes to reserve in each frame
+    ScanBuffer(const size_t capacity);
+    ~ScanBuffer();
+
+    // get a frame to fill, nullptr if all frames are held by readers (the scan is then dropped)
+    // called by the producer only
+    ScanFrame* acquire();
+
+    // publish a frame filled after acquire, replacing the published frame if it was not taken yet
+    // called by the producer only
+    void publish(ScanFrame* frame);
+
+    // take newest published frame, empty if nothing was published since the last take
+    ScanFramePtr take();
+
+    // readable after a publish until the next take
+    int event_fd() const;
+
+    // number of scans dropped because they were never taken or no frame was free
+    unsigned long long dropped() const;
+
+    // the published slot as a queue of at most one scan, latency is from publish to take
+    QueueStats stats() const;
+
+    const static int FRAMES = 8;    // enough for the reader, the mapping queue and one being filled
+
+private:
+    std::unique_ptr<ScanFrame[]> frames;
+
+    // index of published frame that has not been taken yet, -1 if none
+    std::atomic<int> latest;
+
+    std::atomic<unsigned long long> dropped_frames;
+
+    // when each frame was published, written before and read after the exchange of latest
+    int64_t published_ns[FRAMES];
+    QueueCounters counters;
+
+    Notifier published;
+};
+
+#endif // SCAN_BUFFER_HPP
@@ -0,0 +1,191 @@
+/*
+
+file: scan_frame.cpp
+created: 2026-10-17
+
+Angle indexed rplidar scan.
+
+*/
+
+
+#include <cmath>
+#include <algorithm>
+
+#include "scan_frame.hpp"
+
+
+ScanFrame::ScanFrame() : scan(), completed_ns(0), refs(0)
+{
+    bins.fill(0);
+    prev_valid.fill(-1);
+    next_valid.fill(-1);
+}
+
+
+void ScanFrame::build(const std::vector<ScanNode>& nodes)
+{
+    completed_ns = 0;
+    scan = nodes;
+    index();
+}
+
+
+void ScanFrame::build(const rplidar_response_measurement_node_hq_t* nodes, const size_t count)
+{
+    completed_ns = 0;
+    scan.clear();
+    for(size_t i = 0; i < count; i++)
+    {
+        scan.push_back({
+            nodes[i].dist_mm_q2/4,
+            nodes[i].angle_z_q14 * 90.f / (1 << 14),
+            nodes[i].quality
+        });
+    }
+    index();
+}
+
+
+void ScanFrame::index()
+{
+    bins.fill(0);
+
+    // keep nearest valid range in each bin (distance 0 means the measurement failed)
+    for(const ScanNode& node : scan)
+    {
+        if(node.dist == 0) continue;
+        uint32_t& bin = bins[bin_of(node.angle)];
+        if(bin == 0 || node.dist < bin) bin = node.dist;
+    }
+
+    // find any non-empty bin to start the wrapping sweeps from
+    int first = -1;
+    for(int b = 0; b < BINS; b++)
+    {
+        if(bins[b] != 0)
+        {
+            first = b;
+            break;
+        }
+    }
+    if(first < 0)
+    {
+        prev_valid.fill(-1);
+        next_valid.fill(-1);
+        return;
+    }
+
+    // sweep forward for closest non-empty bin at or before each bin
+    int last = first;
+    for(int i = 0; i < BINS; i++)
+    {
+        int b = (first + i) % BINS;
+        if(bins[b] != 0) last = b;
+        prev_valid[b] = last;
+    }
+
+    // sweep backward for closest non-empty bin at or after each bin
+    last = first;
+    for(int i = 0; i < BINS; i++)
+    {
+        int b = (first - i + BINS) % BINS;
+        if(bins[b] != 0) last = b;
+        next_valid[b] = last;
+    }
+}
+
+
+float ScanFrame::distance_at(float angle, float tolerance) const
+{
+    int b = bin_of(angle);
+    if(bins[b] != 0) return bins[b];
+    if(prev_valid[b] < 0) return 0.0f;
+
+    // closest measured bin on either side
+    int d_prev = bin_distance(b, prev_valid[b]);
+    int d_next = bin_distance(b, next_valid[b]);
+    int nearest = d_prev <= d_next ? prev_valid[b] : next_valid[b];
+
+    if(std::min(d_prev, d_next) * BIN_SIZE > tolerance) return 0.0f;
+    return bins[nearest];
+}
+
+
+float ScanFrame::interpolated_at(float angle) const
+{
+    int b = bin_of(angle);
+    if(bins[b] != 0) return bins[b];
+    if(prev_valid[b] < 0) return 0.0f;
+
+    int d_prev = bin_distance(b, prev_valid[b]);
+    int d_next = bin_distance(b, next_valid[b]);
+    float t = (float)d_prev / (float)(d_prev + d_next);
+    return (1.0f - t) * bins[prev_valid[b]] + t * bins[next_valid[b]];
+}
+
+
+bool ScanFrame::empty() const
+{
+    return scan.empty();
+}
+
+
+const std::vector<ScanNode>& ScanFrame::nodes() const
+{
+    return scan;
+}
+
+
+int64_t ScanFrame::completed() const
+{
+    return completed_ns;
+}
+
+
+void ScanFrame::set_completed(int64_t ns)
+{
+    completed_ns = ns;
+}
+
+
+int ScanFrame::bin_of(float angle)
+{
+    int b = (int)std::floor(angle / BIN_SIZE + 0.5f) % BINS;
+    return b < 0 ? b + BINS : b;
+}
+
+
+int ScanFrame::bin_distance(int a, int b)
+{
+    int d = std::abs(a - b);
+    return std::min(d, BINS - d);
+}
+
+
+ScanFramePtr::ScanFramePtr() : frame(nullptr) {}
+
+ScanFramePtr::ScanFramePtr(const ScanFrame* frame) : frame(frame) {}
+
+ScanFramePtr::ScanFramePtr(const ScanFramePtr& other) : frame(other.frame)
+{
+    // the other handle keeps the frame alive, so relaxed is enough
+    if(frame) frame->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+ScanFramePtr::ScanFramePtr(ScanFramePtr&& other) : frame(other.frame)
+{
+    other.frame = nullptr;
+}
+
+ScanFramePtr::~ScanFramePtr()
+{
+    // release so the buffer does not reuse the frame before we are done reading it
+    if(frame) frame->refs.fetch_sub(1, std::memory_order_release);
+}
+
+
+ScanFramePtr& ScanFramePtr::operator=(ScanFramePtr other)
+{
+    std::swap(frame, other.frame);
+    return *this;
+}
@@ -0,0 +1,130 @@
+/*
+
+file: scan_frame.hpp
+created: 2026-10-17
+
+Angle indexed rplidar scan.
+
+Frames handed out by the rplidar are immutable and shared through
+ScanFramePtr, a reference counted handle. When the last handle is gone the
+frame goes back to the ScanBuffer it came from and is reused for a later
+scan, so no memory is allocated per scan.
+
+*/
+
+
+#ifndef SCAN_FRAME_HPP
+#define SCAN_FRAME_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+#include <rplidar/rplidar_inc.h>
+
+
+struct ScanNode {
+    uint32_t dist;
+    float angle; 
+    uint8_t quality;
+    void print() const {
+        int q = (int) quality;
+        std::cout << "Dist: " << dist << " Angle: " << angle << " Quality: " << q << std::endl;
+    }
+};
+
+
+class ScanFrame
+{
+    friend class ScanFramePtr;
+    friend class ScanBuffer;
+public:
+    ScanFrame();
+
+    // rebuild the angle index from a new scan, call once per new scan
+    // nodes: scannodes of the scan
+    void build(const std::vector<ScanNode>& nodes);
+
+    // rebuild the angle index from a new scan straight from the driver, does not allocate
+    // once the frame has held a scan as large as this one
+    // nodes: driver nodes in ascending angle order
+    // count: number of nodes
+    void build(const rplidar_response_measurement_node_hq_t* nodes, const size_t count);
+
+    // get nearest valid distance within a tolerance window, 0 if there is none
+    // angle: rplidar angle in degrees (wrapped to [0, 360))
+    // tolerance: max angular distance in degrees to a measured bin
+    float distance_at(float angle, float tolerance = DEFAULT_TOLERANCE) const;
+
+    // get distance at angle, linearly interpolated over empty bins, 0 if scan has no valid nodes
+    // angle: rplidar angle in degrees (wrapped to [0, 360))
+    float interpolated_at(float angle) const;
+
+    // true if the frame holds no scan
+    bool empty() const;
+
+    // scannodes of the scan the index was built from
+    const std::vector<ScanNode>& nodes() const;
+
+    // monotonic time in ns when the scan was complete, 0 if not known. build resets it.
+    int64_t completed() const;
+    void set_completed(int64_t ns);
+
+    const static int BINS = 1440;                       // 0.25 degree bins
+    constexpr static float BIN_SIZE = 360.0f / BINS;    // degrees per bin
+    constexpr static float DEFAULT_TOLERANCE = 1.0f;    // degrees
+
+private:
+    // rebuild bins from scan
+    void index();
+
+    // bin containing angle
+    static int bin_of(float angle);
+
+    // number of bins between two bins, going the short way around
+    static int bin_distance(int a, int b);
+
+    std::vector<ScanNode> scan;
+    int64_t completed_ns;
+
+    // nearest valid range in each bin, 0 if no valid node fell into the bin
+    std::array<uint32_t, BINS> bins;
+
+    // closest non-empty bin at or before/after each bin (wrapping), -1 if scan has no valid nodes
+    std::array<int16_t, BINS> prev_valid;
+    std::array<int16_t, BINS> next_valid;
+
+    // number of ScanFramePtr handles (and buffer slots) holding the frame
+    mutable std::atomic<int> refs;
+};
+
+
+// reference counted handle to an immutable ScanFrame
+class ScanFramePtr
+{
+    friend class ScanBuffer;
+public:
+    ScanFramePtr();
+    ScanFramePtr(const ScanFramePtr& other);
+    ScanFramePtr(ScanFramePtr&& other);
+    ~ScanFramePtr();
+
+    ScanFramePtr& operator=(ScanFramePtr other);
+
+    const ScanFrame& operator*() const { return *frame; }
+    const ScanFrame* operator->() const { return frame; }
+
+    // true if the handle holds a frame
+    explicit operator bool() const { return frame != nullptr; }
+
+private:
+    // take over a reference already counted in frame
+    explicit ScanFramePtr(const ScanFrame* frame);
+
+    const ScanFrame* frame;
+};
+
+#endif // SCAN_FRAME_HPP
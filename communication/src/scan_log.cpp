@@ -0,0 +1,219 @@
+/*
+
+file: scan_log.cpp
+created: 2026-10-17
+
+Binary rplidar scan log.
+
+*/
+
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+#include "scan_log.hpp"
+#include "logging.hpp"
+
+
+static_assert(sizeof(rplidar_response_measurement_node_hq_t) == 8, "driver node layout changed");
+static_assert(sizeof(ScanLogHeader) % 8 == 0 && sizeof(ScanLogFrameHeader) % 8 == 0, "scan log records must stay 8 byte aligned");
+
+
+ScanLogWriter::ScanLogWriter() : file(nullptr), frame_count(0) {}
+
+ScanLogWriter::~ScanLogWriter()
+{
+    close();
+}
+
+
+bool ScanLogWriter::open(const std::string& file_name)
+{
+    close();
+    file = fopen(file_name.c_str(), "wb");
+    if(!file)
+    {
+        ERROR("scan log open ", file_name);
+        return false;
+    }
+
+    ScanLogHeader header = {};
+    memcpy(header.magic, SCAN_LOG_MAGIC, sizeof(header.magic));
+    header.version = SCAN_LOG_VERSION;
+    fwrite(&header, sizeof(header), 1, file);
+    frame_count = 0;
+    return true;
+}
+
+void ScanLogWriter::close()
+{
+    if(!file) return;
+
+    // frame count goes in the header now that it is known
+    fseek(file, offsetof(ScanLogHeader, frame_count), SEEK_SET);
+    fwrite(&frame_count, sizeof(frame_count), 1, file);
+    fclose(file);
+    file = nullptr;
+}
+
+bool ScanLogWriter::is_open() const
+{
+    return file != nullptr;
+}
+
+
+void ScanLogWriter::write(const uint64_t timestamp_us, const rplidar_response_measurement_node_hq_t* nodes, const size_t count)
+{
+    if(!file) return;
+
+    ScanLogFrameHeader header = {timestamp_us, (uint32_t)count, 0};
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(nodes, sizeof(rplidar_response_measurement_node_hq_t), count, file);
+    frame_count++;
+}
+
+
+ScanLogReader::ScanLogReader() : data(nullptr), size(0), frames() {}
+
+ScanLogReader::~ScanLogReader()
+{
+    close();
+}
+
+
+bool ScanLogReader::open(const std::string& file_name)
+{
+    close();
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        ERROR("scan log open ", file_name);
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(ScanLogHeader))
+    {
+        ERROR("scan log too small ", file_name);
+        ::close(fd);
+        return false;
+    }
+    size = st.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(mapped == MAP_FAILED)
+    {
+        ERROR("scan log mmap ", file_name);
+        size = 0;
+        return false;
+    }
+    data = (const uint8_t*)mapped;
+
+    const ScanLogHeader* header = (const ScanLogHeader*)data;
+    if(memcmp(header->magic, SCAN_LOG_MAGIC, sizeof(header->magic)) != 0 || header->version != SCAN_LOG_VERSION)
+    {
+        ERROR("not a scan log ", file_name);
+        close();
+        return false;
+    }
+
+    // index frames, a log cut short by a crash still has all its complete frames
+    size_t offset = sizeof(ScanLogHeader);
+    while(offset + sizeof(ScanLogFrameHeader) <= size)
+    {
+        const ScanLogFrameHeader* frame = (const ScanLogFrameHeader*)(data + offset);
+        size_t nodes_size = frame->count * sizeof(rplidar_response_measurement_node_hq_t);
+        offset += sizeof(ScanLogFrameHeader);
+        if(offset + nodes_size > size) break;
+
+        frames.push_back({frame->timestamp_us, (const rplidar_response_measurement_node_hq_t*)(data + offset), frame->count});
+        offset += nodes_size;
+    }
+    if(header->frame_count != frames.size()) WARN("scan log ", file_name, " has ", frames.size(), " frames, header says ", header->frame_count);
+    return true;
+}
+
+void ScanLogReader::close()
+{
+    if(data) munmap((void*)data, size);
+    data = nullptr;
+    size = 0;
+    frames.clear();
+}
+
+
+size_t ScanLogReader::frame_count() const
+{
+    return frames.size();
+}
+
+ScanLogReader::Frame ScanLogReader::frame(const size_t index) const
+{
+    return frames[index];
+}
+
+
+int convert_text_scan_log(const std::string& text_file, const std::string& log_file, const uint64_t period_us)
+{
+    std::ifstream in(text_file);
+    if(!in)
+    {
+        ERROR("text scan log open ", text_file);
+        return -1;
+    }
+    ScanLogWriter writer;
+    if(!writer.open(log_file)) return -1;
+
+    std::vector<rplidar_response_measurement_node_hq_t> nodes;
+    uint64_t timestamp_us = 0;
+    int frames = 0;
+
+    // write collected nodes as one frame
+    auto flush = [&]()
+    {
+        if(nodes.empty()) return;
+        writer.write(timestamp_us, nodes.data(), nodes.size());
+        timestamp_us += period_us;
+        nodes.clear();
+        frames++;
+    };
+
+    std::string line;
+    while(std::getline(in, line))
+    {
+        if(line.rfind("Nodes retrieved:", 0) == 0)
+        {
+            flush();
+            continue;
+        }
+        if(line.rfind("Dist:", 0) != 0) continue;
+
+        // Dist: D Angle: A Quality: Q
+        std::istringstream fields(line);
+        std::string label;
+        float dist, angle;
+        int quality;
+        if(!(fields >> label >> dist >> label >> angle >> label >> quality)) continue;
+
+        rplidar_response_measurement_node_hq_t node = {};
+        // 360 degrees wraps around to 0 like in the driver
+        node.angle_z_q14 = (_u16)((uint32_t)(angle * (1 << 14) / 90.0f + 0.5f) & 0xFFFF);
+        node.dist_mm_q2 = (_u32)(dist * 4);
+        node.quality = (_u8)quality;
+        nodes.push_back(node);
+    }
+    flush();
+    return frames;
+}
+
+
+uint64_t scan_log_time_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,114 @@
+/*
+
+file: scan_log.hpp
+created: 2026-10-17
+
+Binary rplidar scan log.
+
+The file starts with a header and is followed by one record per scan: a
+frame header with the scan's timestamp and node count, then the nodes
+exactly as the driver delivers them (q14 angle, q2 distance, quality and
+flag packed in 8 bytes). Everything is 8 byte aligned, so a log can be
+memory mapped and its nodes handed straight to ScanFrame::build.
+
+*/
+
+
+#ifndef SCAN_LOG_HPP
+#define SCAN_LOG_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <rplidar/rplidar_inc.h>
+
+
+struct ScanLogHeader
+{
+    char magic[8];          // MAGIC
+    uint32_t version;       // VERSION
+    uint32_t frame_count;   // number of frames, written when the log is closed
+    uint64_t reserved[2];
+};
+
+struct ScanLogFrameHeader
+{
+    uint64_t timestamp_us;  // monotonic time the scan was completed, in microseconds
+    uint32_t count;         // number of nodes following the header
+    uint32_t reserved;
+};
+
+
+class ScanLogWriter
+{
+public:
+    ScanLogWriter();
+    ~ScanLogWriter();
+
+    // create log, returns false if the file could not be opened
+    bool open(const std::string& file);
+
+    // write frame count and close log
+    void close();
+
+    // true if a log is open
+    bool is_open() const;
+
+    // append a scan
+    // timestamp_us: monotonic time the scan was completed, in microseconds
+    // nodes: driver nodes
+    // count: number of nodes
+    void write(const uint64_t timestamp_us, const rplidar_response_measurement_node_hq_t* nodes, const size_t count);
+
+private:
+    FILE* file;
+    uint32_t frame_count;
+};
+
+
+class ScanLogReader
+{
+public:
+    struct Frame
+    {
+        uint64_t timestamp_us;
+        const rplidar_response_measurement_node_hq_t* nodes;
+        size_t count;
+    };
+
+    ScanLogReader();
+    ~ScanLogReader();
+
+    // memory map log and index its frames, returns false if it is not a valid scan log
+    bool open(const std::string& file);
+    void close();
+
+    // number of frames in the log
+    size_t frame_count() const;
+
+    // get frame, nodes point into the mapped log and are valid until the log is closed
+    Frame frame(const size_t index) const;
+
+private:
+    const uint8_t* data;
+    size_t size;
+    std::vector<Frame> frames;
+};
+
+
+// convert a text log of printed scannodes ("Nodes retrieved: N" followed by N lines
+// of "Dist: D Angle: A Quality: Q") to a binary log, returns number of frames converted
+// period_us: time between scans in microseconds, text logs have no timestamps
+int convert_text_scan_log(const std::string& text_file, const std::string& log_file, const uint64_t period_us);
+
+// current monotonic time in microseconds, as used for log timestamps
+uint64_t scan_log_time_us();
+
+const char SCAN_LOG_MAGIC[8] = {'R', 'P', 'S', 'C', 'A', 'N', 'L', 'G'};
+const uint32_t SCAN_LOG_VERSION = 1;
+const std::string SCAN_LOG_EXTENSION = ".scanlog";
+
+#endif // SCAN_LOG_HPP
@@ -0,0 +1,252 @@
+/*
+
+file: scan_matcher.cpp
+created: 2026-10-17
+
+Correlative scan to map matching.
+
+*/
+
+
+#include <cmath>
+#include <algorithm>
+
+#include "scan_matcher.hpp"
+#include "icp.hpp"
+
+
+ScanMatcher::ScanMatcher(const ScanMatcherConfig& config) :
+    config(config), window(0), depth(0), reach(0), origin_col(0), origin_row(0), cols(0), rows(0), cell_size(1), center{0, 0, 0}
+{
+
+}
+
+
+const ScanMatcherConfig& ScanMatcher::get_config() const
+{
+    return config;
+}
+
+
+void ScanMatcher::load(const Map& map, int col, int row)
+{
+    // everything a point can reach from anywhere in the window, plus room for the largest pyramid blocks
+    int margin = window + reach + 1;
+    origin_col = col - margin;
+    origin_row = row - margin;
+    cols = rows = 2 * margin + 1 + (1 << depth);
+
+    log_odds.resize((size_t)cols * rows);
+    map.read(origin_col, origin_row, cols, rows, log_odds.data());
+
+    // only walls score, scaled to how sure the map is about them
+    int max = std::max<int>(1, map.occupancy_config().max);
+    levels.resize(depth + 1);
+    levels[0].resize(log_odds.size());
+    for(size_t i = 0; i < log_odds.size(); i++)
+    {
+        levels[0][i] = (uint8_t)(std::clamp<int>(log_odds[i], 0, max) * 255 / max);
+    }
+
+    // each level is the max of four blocks of the level below
+    for(int h = 1; h <= depth; h++)
+    {
+        const std::vector<uint8_t>& below = levels[h - 1];
+        std::vector<uint8_t>& level = levels[h];
+        level.assign(below.size(), 0);
+        int half = 1 << (h - 1);
+        for(int y = 0; y < rows; y++)
+        {
+            for(int x = 0; x < cols; x++)
+            {
+                uint8_t value = below[y * cols + x];
+                if(x + half < cols) value = std::max(value, below[y * cols + x + half]);
+                if(y + half < rows)
+                {
+                    value = std::max(value, below[(y + half) * cols + x]);
+                    if(x + half < cols) value = std::max(value, below[(y + half) * cols + x + half]);
+                }
+                level[y * cols + x] = value;
+            }
+        }
+    }
+}
+
+
+float ScanMatcher::score(int level, const Candidate& candidate) const
+{
+    const std::vector<uint8_t>& values = levels[level];
+    const std::vector<int>& cells = rotated[candidate.rotation];
+    int shift = candidate.dy * cols + candidate.dx;
+
+    int sum = 0;
+    for(int cell : cells) sum += values[cell + shift];
+    return (float)sum / (255.0f * cells.size());
+}
+
+
+float ScanMatcher::cost(float dx, float dy, float drot) const
+{
+    float d2 = (dx * dx + dy * dy) / 1e6f;
+    float r = drot * (float)M_PI / 180.0f;
+    return std::exp(-config.translation_cost * d2 - config.rotation_cost * r * r);
+}
+
+
+void ScanMatcher::branch(int level, const Candidate& candidate, Candidate& best) const
+{
+    // split the block into its four quarters, best bound first
+    int half = 1 << (level - 1);
+    Candidate children[4];
+    int count = 0;
+    for(int oy = 0; oy <= half; oy += half)
+    {
+        for(int ox = 0; ox <= half; ox += half)
+        {
+            Candidate child{candidate.rotation, candidate.dx + ox, candidate.dy + oy, 0};
+            if(child.dx > window || child.dy > window) continue;
+            child.score = score(level - 1, child);
+            if(level - 1 == 0) child.score *= cost(child.dx * cell_size, child.dy * cell_size, angles[child.rotation] - center.rot);
+            children[count++] = child;
+        }
+    }
+    std::sort(children, children + count, [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+
+    for(int i = 0; i < count; i++)
+    {
+        // bounds are sorted, nothing after this one can win either
+        if(children[i].score <= best.score) break;
+        if(level - 1 == 0) best = children[i];
+        else branch(level - 1, children[i], best);
+    }
+}
+
+
+float ScanMatcher::refined_score(const Pose& pose) const
+{
+    float r = pose.rot * (float)M_PI / 180.0f;
+    float c = std::cos(r), s = std::sin(r);
+    const std::vector<uint8_t>& values = levels[0];
+
+    float sum = 0;
+    for(const Vec2& p : points)
+    {
+        // local cell coordinates relative to cell centers
+        float u = (pose.x + c*p.x - s*p.y) / cell_size + 0.5f - origin_col - 0.5f;
+        float v = (pose.y + s*p.x + c*p.y) / cell_size + 0.5f - origin_row - 0.5f;
+        int x = (int)std::floor(u), y = (int)std::floor(v);
+        if(x < 0 || y < 0 || x + 1 >= cols || y + 1 >= rows) continue;
+        float fx = u - x, fy = v - y;
+
+        const uint8_t* cell = &values[y * cols + x];
+        sum += (1 - fy) * ((1 - fx) * cell[0] + fx * cell[1]) + fy * ((1 - fx) * cell[cols] + fx * cell[cols + 1]);
+    }
+    return sum / (255.0f * points.size()) * cost(pose.x - center.x, pose.y - center.y, pose.rot - center.rot);
+}
+
+
+ScanMatch ScanMatcher::match(const Map& map, const std::vector<ScanNode>& nodes, const Pose& guess)
+{
+    ScanMatch result{guess, 0.0f, false};
+    cell_size = (float)map.cell_size();
+    center = guess;
+
+    points = ICP::to_points(nodes, config.max_points);
+    float range = 0;
+    points.erase(std::remove_if(points.begin(), points.end(), [this](const Vec2& p) { return p.length() > config.max_range; }), points.end());
+    for(const Vec2& p : points) range = std::max(range, p.length());
+    if(points.empty()) return result;
+
+    window = (int)std::ceil(config.linear_window / cell_size);
+    depth = 0;
+    while((1 << depth) < 2 * window + 1) depth++;
+    reach = (int)std::ceil(range / cell_size) + 1;
+
+    int col = (int)std::floor(guess.x / cell_size + 0.5f);
+    int row = (int)std::floor(guess.y / cell_size + 0.5f);
+    load(map, col, row);
+
+    // rotating by the step moves the farthest point about one cell
+    float step = config.angular_step;
+    if(step <= 0)
+    {
+        float ratio = std::min(1.0f, cell_size / std::max(range, cell_size));
+        step = std::acos(1.0f - ratio * ratio / 2.0f) * 180.0f / (float)M_PI;
+        step = std::clamp(step, 0.1f, 2.0f);
+    }
+    int steps = (int)std::ceil(config.angular_window / step);
+
+    // local cells of the points for every rotation, before shifting
+    angles.clear();
+    rotated.resize(2 * steps + 1);
+    for(int k = -steps; k <= steps; k++)
+    {
+        float rot = guess.rot + k * step;
+        float r = rot * (float)M_PI / 180.0f;
+        float c = std::cos(r), s = std::sin(r);
+        std::vector<int>& cells = rotated[k + steps];
+        cells.resize(points.size());
+        for(size_t i = 0; i < points.size(); i++)
+        {
+            const Vec2& p = points[i];
+            int x = (int)std::floor((guess.x + c*p.x - s*p.y) / cell_size + 0.5f) - origin_col;
+            int y = (int)std::floor((guess.y + s*p.x + c*p.y) / cell_size + 0.5f) - origin_row;
+            cells[i] = y * cols + x;
+        }
+        angles.push_back(rot);
+    }
+
+    // coarsest blocks covering the window for every rotation, best bound first
+    std::vector<Candidate> candidates;
+    int block = 1 << depth;
+    for(int rotation = 0; rotation < (int)rotated.size(); rotation++)
+    {
+        for(int dy = -window; dy <= window; dy += block)
+        {
+            for(int dx = -window; dx <= window; dx += block)
+            {
+                Candidate candidate{rotation, dx, dy, 0};
+                candidate.score = score(depth, candidate);
+                if(depth == 0) candidate.score *= cost(dx * cell_size, dy * cell_size, angles[rotation] - guess.rot);
+                candidates.push_back(candidate);
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+
+    // anything below the min score is not a match anyway
+    Candidate best{-1, 0, 0, config.min_score};
+    for(const Candidate& candidate : candidates)
+    {
+        if(candidate.score <= best.score) break;
+        if(depth == 0) best = candidate;
+        else branch(depth, candidate, best);
+    }
+    if(best.rotation < 0) return result;
+
+    // refine below the cell and rotation step
+    Pose pose{guess.x + best.dx * cell_size, guess.y + best.dy * cell_size, angles[best.rotation]};
+    Pose refined = pose;
+    float refined_best = refined_score(pose);
+    for(int k = -1; k <= 1; k++)
+    {
+        for(int iy = -2; iy <= 2; iy++)
+        {
+            for(int ix = -2; ix <= 2; ix++)
+            {
+                Pose candidate{pose.x + ix * cell_size / 4, pose.y + iy * cell_size / 4, pose.rot + k * step / 2};
+                float value = refined_score(candidate);
+                if(value > refined_best)
+                {
+                    refined_best = value;
+                    refined = candidate;
+                }
+            }
+        }
+    }
+
+    result.pose = refined;
+    result.score = best.score;
+    result.matched = true;
+    return result;
+}
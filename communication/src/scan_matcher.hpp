@@ -0,0 +1,116 @@
+/*
+
+file: scan_matcher.hpp
+created: 2026-10-17
+
+Correlative scan to map matching.
+
+Finds the pose in a window around a guess where the most scan points land
+on walls of the map. The window is searched exhaustively but with branch and
+bound: a max pyramid of the map, where level h holds the largest value in
+every 2^h x 2^h block of cells, gives an upper bound of the score of all the
+translations in a block at once, so whole blocks of candidates that can not
+beat the best match so far are skipped.
+
+Final scores are scaled down slightly the farther they are from the guess.
+Without that, a scan that fits equally well at several poses (a small room
+seen through a coarse map) drifts a little with every match. Block bounds
+stay unscaled, so they are still upper bounds.
+
+The best candidate is finally refined to less than a cell and a rotation
+step on the interpolated map.
+
+*/
+
+
+#ifndef SCAN_MATCHER_HPP
+#define SCAN_MATCHER_HPP
+
+#include <stdint.h>
+#include <vector>
+
+#include "map.hpp"
+#include "pose.hpp"
+#include "scan_frame.hpp"
+#include "vec2.hpp"
+
+
+struct ScanMatcherConfig
+{
+    float linear_window = 500.0f;   // mm searched on every side of the guess
+    float angular_window = 10.0f;   // degrees searched on both sides of the guess
+    float angular_step = 0.0f;      // degrees, 0 picks a step that moves the farthest point about one cell
+    float max_range = 6000.0f;      // mm, farther points are not matched
+    int max_points = 360;           // scans are thinned to at most this many points
+    float min_score = 0.5f;         // fraction of points on walls needed to accept a match
+    float translation_cost = 0.5f;  // scores are scaled by exp(-translation_cost * m^2 - rotation_cost * rad^2)
+    float rotation_cost = 2.0f;     // away from the guess, so ties and near ties stay at the guess
+};
+
+
+struct ScanMatch
+{
+    Pose pose;
+    float score;        // fraction of points on walls, weighted by how sure the map is about them
+    bool matched;       // false if no pose in the window scored min_score, pose is then the guess
+};
+
+
+class ScanMatcher
+{
+public:
+    ScanMatcher(const ScanMatcherConfig& config = ScanMatcherConfig());
+
+    // best pose of a scan in a window around a guess
+    // map: map to match against, may be updated by another thread meanwhile
+    // nodes: rplidar scan
+    // guess: where the scan probably was taken
+    ScanMatch match(const Map& map, const std::vector<ScanNode>& nodes, const Pose& guess);
+
+    const ScanMatcherConfig& get_config() const;
+
+private:
+    struct Candidate
+    {
+        int rotation;       // index into rotated
+        int dx, dy;         // translation in cells
+        float score;
+    };
+
+    // copy the part of the map the window can reach and build the pyramid on top of it
+    void load(const Map& map, int col, int row);
+
+    // sum of the pyramid values under the points of a rotation shifted by (dx, dy), normalized
+    float score(int level, const Candidate& candidate) const;
+
+    // how much a score is scaled down for being away from the guess
+    float cost(float dx, float dy, float drot) const;
+
+    // depth first search of the candidates below one, updating best
+    void branch(int level, const Candidate& candidate, Candidate& best) const;
+
+    // sum of the interpolated map values under the points at a pose
+    float refined_score(const Pose& pose) const;
+
+    ScanMatcherConfig config;
+
+    // window and pyramid size
+    int window;         // translations searched in each direction, in cells
+    int depth;          // number of levels above the map, 2^depth covers the window
+    int reach;          // cells from the robot to the farthest point
+
+    // local map, values 0 (unknown or empty) to 255 (surely a wall), and its pyramid
+    int origin_col, origin_row;     // map cell of local cell (0, 0)
+    int cols, rows;
+    std::vector<int8_t> log_odds;
+    std::vector<std::vector<uint8_t>> levels;
+
+    // scan points in mm and, for every rotation, their local cells when shifted by (0, 0)
+    std::vector<Vec2> points;
+    std::vector<float> angles;
+    std::vector<std::vector<int>> rotated;
+    float cell_size;
+    Pose center;
+};
+
+#endif // SCAN_MATCHER_HPP
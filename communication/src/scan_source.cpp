@@ -0,0 +1,24 @@
+/*
+
+file: scan_source.cpp
+created: 2026-10-17
+
+Interface for anything delivering rplidar scans, the rplidar itself or a
+recorded scan log.
+
+*/
+
+
+#include "scan_source.hpp"
+#include "scan_log.hpp"
+#include "rplidar.hpp"
+#include "replay_rplidar.hpp"
+
+
+std::unique_ptr<ScanSource> open_scan_source(const std::string& file)
+{
+    bool is_log = file.size() >= SCAN_LOG_EXTENSION.size()
+        && file.compare(file.size() - SCAN_LOG_EXTENSION.size(), SCAN_LOG_EXTENSION.size(), SCAN_LOG_EXTENSION) == 0;
+    if(is_log) return std::make_unique<ReplayRPLidar>(file);
+    return std::make_unique<RPLidar>(file);
+}
@@ -0,0 +1,48 @@
+/*
+
+file: scan_source.hpp
+created: 2026-10-17
+
+Interface for anything delivering rplidar scans, the rplidar itself or a
+recorded scan log.
+
+*/
+
+
+#ifndef SCAN_SOURCE_HPP
+#define SCAN_SOURCE_HPP
+
+#include <memory>
+#include <string>
+
+#include "scan_frame.hpp"
+#include "queue_stats.hpp"
+
+
+class ScanSource
+{
+public:
+    virtual ~ScanSource() {}
+
+    virtual bool is_ok() = 0;
+    virtual void start_scanning() = 0;
+    virtual void stop_motor() = 0;
+
+    // spin up ahead of start_scanning, so the first scans are good sooner
+    virtual void start_motor() {}
+
+    // get newest scan, empty if there has been no new scan since last call
+    virtual ScanFramePtr get_scan() = 0;
+
+    // fd readable when get_scan has a new scan, -1 if the source has to be polled
+    virtual int event_fd() { return -1; }
+
+    // scans waiting for get_scan and how long they waited
+    virtual QueueStats queue_stats() { return QueueStats(); }
+};
+
+
+// open a scan log replay if file is a scan log, otherwise the rplidar at file
+std::unique_ptr<ScanSource> open_scan_source(const std::string& file);
+
+#endif // SCAN_SOURCE_HPP
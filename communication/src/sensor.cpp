@@ -11,10 +11,11 @@ Interface to sensor module.
 #include "sensor.hpp"
 #include "logging.hpp"
 #include "pc.hpp"
+#include "latency.hpp"
 #include <bitset>
 
 
-Sensor::Sensor(const std::string& file) : Module(file), rx_type(SensorRx::NONE), rx_field(0), latest_measurement(), start_rot(0)
+Sensor::Sensor(const std::string& file) : Module(file), rx(), start_rot(0), latest_measurement(), measurements(0)
 {
     //TRACE("sensor constructor: called with file ", file);
     transmit_identified();
@@ -25,96 +26,69 @@ Sensor::~Sensor() {}
 void Sensor::update()
 {
 	//TRACE("sensor update:");
-	// read transmissions from sensor module
-	bool read = true;
-	while(read)
-	{
-		if(rx_type == SensorRx::NONE)
-		{
-			//TRACE("checking for rx type");
-			SensorRx new_rx_type;
-			if(serial.read((uint8_t*)&new_rx_type, 1) == 1)
-			{
-				//TRACE("new rx from sensor module with id ", (int)new_rx_type);
-				rx_type = new_rx_type;
-				rx_field = 0;
-			}
-		}
+	// read everything the sensor module sent at once and handle every complete frame in it,
+	// the rest of a frame stays buffered until next time
+	rx.fill(serial.get_fd());
+	int64_t now = monotonic_ns();
 
-		switch(rx_type)
+	SerialFrame frame;
+	while(rx.next(frame))
+	{
+		switch((SensorRx)frame.type)
 		{
 			case SensorRx::MEASUREMENT:
 			{
-				//TRACE("receiving measurement byte(s)");
-				// new measurement
-				const uint8_t n_fields = 6;
-				//TRACE("afwpwokdwpodkwpo ", (int)n_fields, " - ", (int)rx_field, " = ", n_fields - rx_field);
-				rx_field += serial.read(rx_field_buffer + rx_field, n_fields - rx_field);
-				if(rx_field == n_fields)
-				{
-					int16_t rot_raw = (rx_field_buffer[0] << 8) | rx_field_buffer[1];
-					float rot = rot_raw + 720;
-					rot -= start_rot;
-					uint16_t right = (rx_field_buffer[2] << 8) | rx_field_buffer[3];
-					uint16_t left = (rx_field_buffer[4] << 8) | rx_field_buffer[5];
-					
-					/*
-					TRACE("1: ", (bitset<8>)rx_field_buffer[0]," 2: ", (bitset<8>)rx_field_buffer[1]," 3: ", 
-					(bitset<8>)rx_field_buffer[2]," 4: ", (bitset<8>)rx_field_buffer[3]," 5: ", (bitset<8>)rx_field_buffer[4]," 6: ", (bitset<8>)rx_field_buffer[5]);
-					*/
-
-					
-					// store new measurement
-					SensorMeasurement measurement{rot, left, right};
-					pc->sensor(measurement);
-					latest_measurement = measurement;
-
-					//TRACE("received measurement from sensor module");
-					//TRACE("rot: ", rot, ", left: ", left, ", right: ", right);
-					
-					// there might be more to read
-					rx_type = SensorRx::NONE;
-					rx_field = 0;
-				}
-				else
-				{
-					read = false;
-				}
+				if(frame.length == 6) receive_measurement(frame, now);
 				break;
 			}
 			case SensorRx::COMPETITION:
 			{
 				// competition mode button pressed
-				//TRACE("received competition button press from sensor module");
-				// there might be more to read
 				competition_callback();
 				TRACE("competition button pressed");
-				rx_type = SensorRx::NONE;
 				break;
 			}
-			case SensorRx::NONE:
 			default:
-				read = false;
-				rx_type = SensorRx::NONE; // in case received byte is not "correct"
+				// module id frames sent before it saw it was identified, or unknown types
 				break;
 		}
 	}
 }
 
 
+void Sensor::receive_measurement(const SerialFrame& frame, int64_t time_ns)
+{
+	const uint8_t* fields = frame.payload;
+	int16_t rot_raw = (fields[0] << 8) | fields[1];
+	float rot = rot_raw + 720;
+	rot -= start_rot;
+	uint16_t right = (fields[2] << 8) | fields[3];
+	uint16_t left = (fields[4] << 8) | fields[5];
+
+	// store new measurement
+	SensorMeasurement measurement{rot, left, right, time_ns};
+	if(pc) pc->sensor(measurement);
+	latest_measurement = measurement;
+	measurements++;
+
+	//TRACE("rot: ", rot, ", left: ", left, ", right: ", right);
+}
+
+
 SensorMeasurement Sensor::measurement()
 {
 	return latest_measurement;
 }
 
+unsigned long long Sensor::measurement_count() const
+{
+	return measurements;
+}
+
 void Sensor::transmit_identified()
 {
     //TRACE("sensor transmit identified: ");
-    uint8_t bytes[1];
-    bytes[0] = static_cast<uint8_t>(SensorTx::IDENTIFIED);
-    //TRACE("transmitting identified");
-    serial.write(bytes, 1);
-    //TRACE("transmitting identified done");
+    serial.write_frame(static_cast<uint8_t>(SensorTx::IDENTIFIED));
 }
 
 void Sensor::on_competition(Sensor::CompetitionCallback callback)
@@ -24,11 +24,11 @@ enum class SensorTx : uint8_t
     IDENTIFIED = 1
 };
 
+// frame types from the sensor module
 enum class SensorRx : uint8_t
 {
-	NONE = 0,
-	MEASUREMENT = 7,
-	COMPETITION = 2
+	MEASUREMENT = 7,	// payload: rot, right, left as big endian 16 bit
+	COMPETITION = 2		// no payload
 };
 
 struct SensorMeasurement
@@ -36,6 +36,7 @@ struct SensorMeasurement
 	float rot;
 	uint16_t left;
 	uint16_t right;
+	int64_t time_ns = 0;	// monotonic time it was read, 0 if never received
 };
 
 class Sensor : public Module
@@ -50,6 +51,9 @@ public:
 	// get latest measurement
 	SensorMeasurement measurement();
 
+	// number of measurements received, changes when there is a new one
+	unsigned long long measurement_count() const;
+
 	using CompetitionCallback = std::function<void()>;
 
     // set competition button pressed callback
@@ -63,15 +67,16 @@ private:
 	// confirm that the sensor module has been identified
     void transmit_identified();
 
-	// variables for keeping track of rx:s from sensor module
-	SensorRx rx_type;
-	const static size_t RX_MAX = 6;
-	uint8_t rx_field_buffer[RX_MAX];
-	uint8_t rx_field;
+	// store the measurement in a frame read at time_ns
+	void receive_measurement(const SerialFrame& frame, int64_t time_ns);
+
+	// frames from sensor module
+	FrameParser rx;
 	float start_rot;
 
 	// latest measurement
 	SensorMeasurement latest_measurement;
+	unsigned long long measurements;
 
 	// competition button pressed callback
 	CompetitionCallback competition_callback;
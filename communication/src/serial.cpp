@@ -20,10 +20,11 @@ Wrapper class for serial I/O.
 
 #include "logging.hpp"
 #include "serial.hpp"
+#include "event_loop.hpp"
 
 
 
-Serial::Serial() : fd(-1), file() {}
+Serial::Serial() : fd(-1), file(), writer(), loop(nullptr), flushing(false) {}
 
 Serial::~Serial() {}
 
@@ -47,6 +48,7 @@ void Serial::open(const std::string& file)
 	options.c_cflag &= ~CSIZE; /* Mask the character size bits */
 	options.c_cflag |= CS8; /* Select 8 data bits */
 	options.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG); /* Raw input */
+	options.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF | IXANY); /* No translation or flow control of bytes */
 	options.c_oflag &= ~OPOST; /* Raw output */
 
 	tcsetattr(fd, TCSANOW, &options);
@@ -62,6 +64,8 @@ void Serial::open(const std::string& file)
 void Serial::close()
 {
     //TRACE("serial close");
+    detach();
+    if(fd >= 0 && !writer.empty() && set_blocking(true)) writer.flush(fd);
     ::close(fd);
     this->file = "";
     this->fd = -1;
@@ -71,9 +75,68 @@ void Serial::close()
 int Serial::write(const uint8_t* bytes, unsigned int size)
 {
     //TRACE("serial write ", size, " bytes to ", get_file());
-    int written = ::write(fd, bytes, size);
-    if(written < size) WARN("wrote ", written, '/', size, " bytes");
-    return written;
+    if(!writer.queue(bytes, size)) return 0;
+    flush();
+    return size;
+}
+
+bool Serial::write_frame(uint8_t type, const uint8_t* payload, uint8_t length, uint64_t tag)
+{
+    if(!writer.queue_frame(type, payload, length, tag)) return false;
+    flush();
+    return true;
+}
+
+void Serial::replace_queued(uint8_t type)
+{
+    writer.replace_queued(type);
+}
+
+void Serial::on_written(std::function<void(uint8_t type, uint64_t tag)> callback)
+{
+    writer.on_written(callback);
+}
+
+
+void Serial::attach(EventLoop& loop)
+{
+    detach();
+    this->loop = &loop;
+    flush();
+}
+
+void Serial::detach()
+{
+    if(loop && flushing) loop->remove_writable(fd);
+    loop = nullptr;
+    flushing = false;
+}
+
+
+void Serial::flush()
+{
+    if(fd < 0) return;
+    if(!loop)
+    {
+        writer.flush(fd);
+        return;
+    }
+
+    // everything queued until the port is writable goes out in one write
+    if(writer.empty() || flushing) return;
+    flushing = loop->add_writable(fd, [this](){
+        writer.flush(fd);
+        if(!writer.empty()) return;
+        loop->remove_writable(fd);
+        flushing = false;
+    });
+    if(!flushing) writer.flush(fd);
+}
+
+
+SerialStats Serial::stats() const
+{
+    return writer.stats();
 }
 
 int Serial::read(uint8_t* bytes, unsigned int size)
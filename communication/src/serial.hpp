@@ -6,14 +6,26 @@ created: 2019-11-14
 
 Wrapper class for serial I/O.
 
+Writes are queued in a SerialWriter. Until the port is attached to an
+event loop they are written right away, after that the loop writes
+everything queued at once when the port is writable.
+
 */
 
 #ifndef SERIAL_HPP
 #define SERIAL_HPP
 
+#include <stdint.h>
 #include <string>
 
-#define BAUD B38400
+#include "serial_frame.hpp"
+#include "serial_writer.hpp"
+
+
+class EventLoop;
+
+// 8 MHz AVRs in double speed mode divide this exactly (UBRR 1)
+#define BAUD B500000
 
 
 class Serial
@@ -23,9 +35,26 @@ public:
     ~Serial();
 
     void open(const std::string& file);
+    // writes what is still queued first, waiting for it if needed
     void close();
 
+    // queue bytes, returns size or 0 if they were dropped because the queue was full
     int write(const uint8_t* bytes, unsigned int size);
+    // queue payload as one frame of type, returns false if it was dropped. A non-zero tag
+    // is passed to the on_written callback once the frame is written
+    bool write_frame(uint8_t type, const uint8_t* payload = nullptr, uint8_t length = 0, uint64_t tag = 0);
+    // a frame of type replaces a queued one of type that has not started to be written
+    void replace_queued(uint8_t type);
+    // called with the type and tag of each tagged frame written whole, maybe before write_frame returns
+    void on_written(std::function<void(uint8_t type, uint64_t tag)> callback);
+
+    // write queued bytes when loop finds the port writable instead of right away,
+    // until detach or close. loop must outlive the attachment
+    void attach(EventLoop& loop);
+    void detach();
+
+    // bytes written and frames queued and dropped
+    SerialStats stats() const;
     int read(uint8_t* bytes, unsigned int size);
     
     bool set_blocking(bool block);
@@ -34,8 +63,14 @@ public:
     std::string get_file();
 
 private:
+    // write what is queued, now or when the port is writable
+    void flush();
+
     int fd;
     std::string file;
+    SerialWriter writer;
+    EventLoop* loop;
+    bool flushing;      // loop is watching for the port to be writable
 };
 
 #endif // SERIAL_HPP
@@ -0,0 +1,132 @@
+/*
+
+file: serial_frame.cpp
+created: 2026-10-17
+
+Framing of the serial link to the AVR modules.
+
+*/
+
+
+#include <string.h>
+#include <sys/uio.h>
+#include <algorithm>
+
+#include "serial_frame.hpp"
+
+
+// crc of every byte value, built once
+struct Crc8Table
+{
+    uint8_t crc[256];
+
+    Crc8Table()
+    {
+        for(int byte = 0; byte < 256; byte++)
+        {
+            uint8_t crc = byte;
+            for(int bit = 0; bit < 8; bit++) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+            this->crc[byte] = crc;
+        }
+    }
+};
+
+static const Crc8Table crc8_table;
+
+
+uint8_t crc8(const uint8_t* bytes, size_t size, uint8_t crc)
+{
+    for(size_t i = 0; i < size; i++) crc = crc8_table.crc[crc ^ bytes[i]];
+    return crc;
+}
+
+
+size_t encode_frame(uint8_t type, const uint8_t* payload, uint8_t length, uint8_t* out)
+{
+    if(length > FRAME_PAYLOAD_MAX) return 0;
+    out[0] = FRAME_START;
+    out[1] = type;
+    out[2] = length;
+    if(length > 0) memcpy(out + 3, payload, length);
+    out[3 + length] = crc8(out + 1, length + 2);
+    return length + FRAME_OVERHEAD;
+}
+
+
+FrameParser::FrameParser() : ring(), head(0), tail(0), decoded(0), bad_crc(0), skipped(0)
+{
+
+}
+
+
+size_t FrameParser::fill(int fd)
+{
+    // the free part of the ring is at most two pieces, before and after the wrap
+    size_t free = CAPACITY - size();
+    if(free == 0) return 0;
+    size_t start = tail & (CAPACITY - 1);
+    size_t first = std::min(free, CAPACITY - start);
+
+    iovec pieces[2];
+    pieces[0].iov_base = ring + start;
+    pieces[0].iov_len = first;
+    pieces[1].iov_base = ring;
+    pieces[1].iov_len = free - first;
+
+    ssize_t read = readv(fd, pieces, free > first ? 2 : 1);
+    if(read <= 0) return 0;
+    tail += read;
+    return read;
+}
+
+
+size_t FrameParser::feed(const uint8_t* bytes, size_t size)
+{
+    size_t fits = std::min(size, CAPACITY - this->size());
+    for(size_t i = 0; i < fits; i++) ring[(tail + i) & (CAPACITY - 1)] = bytes[i];
+    tail += fits;
+    return fits;
+}
+
+
+bool FrameParser::next(SerialFrame& frame)
+{
+    while(size() > 0)
+    {
+        // drop a single byte when it does not start a valid frame, the next frame can start right after it
+        if(at(0) != FRAME_START)
+        {
+            head++;
+            skipped++;
+            continue;
+        }
+        if(size() < 3) return false;
+
+        uint8_t length = at(2);
+        if(length > FRAME_PAYLOAD_MAX)
+        {
+            head++;
+            skipped++;
+            continue;
+        }
+        if(size() < (size_t)length + FRAME_OVERHEAD) return false;
+
+        uint8_t crc = 0;
+        for(size_t i = 1; i < (size_t)length + 3; i++) crc = crc8_table.crc[crc ^ at(i)];
+        if(crc != at(length + 3))
+        {
+            bad_crc++;
+            head++;
+            skipped++;
+            continue;
+        }
+
+        frame.type = at(1);
+        frame.length = length;
+        for(uint8_t i = 0; i < length; i++) frame.payload[i] = at(3 + i);
+        head += length + FRAME_OVERHEAD;
+        decoded++;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,98 @@
+/*
+
+file: serial_frame.hpp
+created: 2026-10-17
+
+Framing of the serial link to the AVR modules.
+
+Every message is sent as
+
+    START type length payload[length] crc
+
+where crc is the CRC-8 (polynomial 0x07, as _crc8_ccitt_update on the AVR)
+of type, length and payload. The AVRs frame their messages the same way in
+their usart.c.
+
+FrameParser keeps what was read in a ring buffer. fill drains everything
+the serial port has with one readv into the free part of the ring, next
+then decodes one complete frame at a time without further syscalls. A byte
+that cannot start a valid frame (wrong start byte, too long or bad crc) is
+dropped on its own and the search goes on from the byte after it, so a lost
+or corrupted byte costs the frame it was in but never desynchronises the
+stream. A frame is at most FRAME_MAX bytes, so no byte is looked at more
+than that many times.
+
+*/
+
+
+#ifndef SERIAL_FRAME_HPP
+#define SERIAL_FRAME_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define FRAME_START 0xA5
+#define FRAME_PAYLOAD_MAX 8
+#define FRAME_OVERHEAD 4    // start, type, length and crc
+#define FRAME_MAX (FRAME_PAYLOAD_MAX + FRAME_OVERHEAD)
+
+
+// types that are the same for every module, module specific ones are in their own headers
+enum class FrameType : uint8_t
+{
+    MODULE_ID = 0x10    // payload: ModuleId, sent until the module is identified
+};
+
+
+struct SerialFrame
+{
+    uint8_t type;
+    uint8_t length;
+    uint8_t payload[FRAME_PAYLOAD_MAX];
+};
+
+
+// CRC-8 with polynomial 0x07 of size bytes, continuing from crc
+uint8_t crc8(const uint8_t* bytes, size_t size, uint8_t crc = 0);
+
+// write the frame of type and payload to out (at least FRAME_MAX bytes), returns its size or 0 if payload is too long
+size_t encode_frame(uint8_t type, const uint8_t* payload, uint8_t length, uint8_t* out);
+
+
+class FrameParser
+{
+public:
+    FrameParser();
+
+    // read everything available from the non-blocking fd with one syscall, returns the number of bytes read
+    size_t fill(int fd);
+
+    // add bytes received some other way, returns how many fit
+    size_t feed(const uint8_t* bytes, size_t size);
+
+    // decode the next complete frame, returns false if there is none yet
+    bool next(SerialFrame& frame);
+
+    unsigned long long frames() const { return decoded; }
+    // frames that failed their crc
+    unsigned long long crc_errors() const { return bad_crc; }
+    // bytes dropped while looking for the start of a frame
+    unsigned long long dropped() const { return skipped; }
+
+    const static size_t CAPACITY = 256;     // power of two, many frames per read
+
+private:
+    uint8_t at(size_t offset) const { return ring[(head + offset) & (CAPACITY - 1)]; }
+    size_t size() const { return tail - head; }
+
+    uint8_t ring[CAPACITY];
+    size_t head;    // next byte to decode, only ever increases
+    size_t tail;    // next byte to fill, only ever increases
+
+    unsigned long long decoded;
+    unsigned long long bad_crc;
+    unsigned long long skipped;
+};
+
+#endif // SERIAL_FRAME_HPP
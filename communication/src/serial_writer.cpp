@@ -0,0 +1,165 @@
+/*
+
+file: serial_writer.cpp
+created: 2026-10-17
+
+Outbound queue of a serial port.
+
+*/
+
+
+#include <errno.h>
+#include <sys/uio.h>
+#include <algorithm>
+
+#include "serial_writer.hpp"
+#include "latency.hpp"
+#include "logging.hpp"
+
+
+// bytes per second are measured over windows of this many ns
+#define RATE_WINDOW 1000000000
+
+
+SerialWriter::SerialWriter() :
+    ring(),
+    head(0),
+    tail(0),
+    records(),
+    first_record(0),
+    record_count(0),
+    replaceable(),
+    written_callback(),
+    counters(),
+    window_start_ns(monotonic_ns()),
+    window_bytes(0)
+{
+
+}
+
+
+bool SerialWriter::queue_frame(uint8_t type, const uint8_t* payload, uint8_t length, uint64_t tag)
+{
+    uint8_t frame[FRAME_MAX];
+    size_t size = encode_frame(type, payload, length, frame);
+    if(size == 0) return false;
+
+    // overwrite a queued frame of the same type that has not started to go out, newest first
+    if(replaceable[type])
+    {
+        for(size_t i = record_count; i-- > 0;)
+        {
+            Record& queued = record(i);
+            if(queued.start < head) break;
+            if(queued.type != type || queued.size != size) continue;
+            for(size_t b = 0; b < size; b++) ring[(queued.start + b) & (CAPACITY - 1)] = frame[b];
+            queued.tag = tag;
+            counters.replaced++;
+            return true;
+        }
+    }
+    return push(frame, size, type, tag);
+}
+
+
+bool SerialWriter::queue(const uint8_t* bytes, size_t size)
+{
+    return size == 0 || push(bytes, size, -1, 0);
+}
+
+
+void SerialWriter::replace_queued(uint8_t type)
+{
+    replaceable.set(type);
+}
+
+
+void SerialWriter::on_written(std::function<void(uint8_t type, uint64_t tag)> callback)
+{
+    written_callback = callback;
+}
+
+
+bool SerialWriter::push(const uint8_t* bytes, size_t size, int type, uint64_t tag)
+{
+    if(tail - head + size > CAPACITY || record_count == RECORDS)
+    {
+        counters.dropped++;
+        return false;
+    }
+
+    for(size_t b = 0; b < size; b++) ring[(tail + b) & (CAPACITY - 1)] = bytes[b];
+    records[(first_record + record_count) & (RECORDS - 1)] = Record{tail, size, type, tag};
+    record_count++;
+    tail += size;
+    counters.max_depth = std::max(counters.max_depth, record_count);
+    return true;
+}
+
+
+bool SerialWriter::flush(int fd)
+{
+    if(empty()) return true;
+
+    // everything queued is at most two pieces, before and after the wrap of the ring
+    size_t queued = tail - head;
+    size_t start = head & (CAPACITY - 1);
+    size_t first = std::min(queued, CAPACITY - start);
+    iovec pieces[2];
+    pieces[0].iov_base = ring + start;
+    pieces[0].iov_len = first;
+    pieces[1].iov_base = ring;
+    pieces[1].iov_len = queued - first;
+
+    ssize_t written = writev(fd, pieces, queued > first ? 2 : 1);
+    if(written < 0)
+    {
+        if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return true;
+        WARN("serial writer: write failed, errno ", errno, ", dropping ", record_count, " frames");
+        counters.dropped += record_count;
+        head = tail;
+        first_record = (first_record + record_count) & (RECORDS - 1);
+        record_count = 0;
+        return false;
+    }
+    written_bytes(written);
+    return true;
+}
+
+
+void SerialWriter::written_bytes(size_t size)
+{
+    head += size;
+    counters.written += size;
+
+    // frames that went out whole
+    while(record_count > 0 && records[first_record].start + records[first_record].size <= head)
+    {
+        Record done = records[first_record];
+        first_record = (first_record + 1) & (RECORDS - 1);
+        record_count--;
+        counters.frames++;
+        if(done.tag != 0 && written_callback) written_callback(done.type, done.tag);
+    }
+
+    window_bytes += size;
+    int64_t now = monotonic_ns();
+    if(now - window_start_ns >= RATE_WINDOW)
+    {
+        counters.bytes_per_second = window_bytes * 1e9 / (now - window_start_ns);
+        window_start_ns = now;
+        window_bytes = 0;
+    }
+}
+
+
+SerialStats SerialWriter::stats() const
+{
+    SerialStats stats = counters;
+    stats.depth = record_count;
+
+    // nothing written for a whole window, the rate is what was written since the last one
+    int64_t elapsed = monotonic_ns() - window_start_ns;
+    if(elapsed >= RATE_WINDOW) stats.bytes_per_second = window_bytes * 1e9 / elapsed;
+    return stats;
+}
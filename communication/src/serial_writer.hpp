@@ -0,0 +1,105 @@
+/*
+
+file: serial_writer.hpp
+created: 2026-10-17
+
+Outbound queue of a serial port.
+
+Frames are encoded into a ring buffer and written by flush, which sends
+everything queued with one writev, whatever the number of frames. A short
+write keeps the rest queued for the next flush, so no byte is lost on a
+non-blocking fd. Serial flushes when the event loop finds the port
+writable.
+
+Setpoint types (the steering's drive frame) can be marked replaceable: a
+new frame of such a type overwrites a queued one that has not started to
+be written yet, so only the newest setpoint goes out. When the queue is
+full the new frame is dropped and counted.
+
+A frame can be queued with a tag, on_written is called with it once the
+frame has been written whole. A replacing frame takes over the tag slot,
+the replaced frame's tag is never reported.
+
+*/
+
+
+#ifndef SERIAL_WRITER_HPP
+#define SERIAL_WRITER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <bitset>
+#include <functional>
+
+#include "serial_frame.hpp"
+
+
+struct SerialStats
+{
+    unsigned long long written = 0;     // bytes written
+    double bytes_per_second = 0;        // written during the last second or so
+    size_t depth = 0;                   // frames queued now, including one partly written
+    size_t max_depth = 0;               // most frames queued at once
+    unsigned long long frames = 0;      // frames written whole
+    unsigned long long dropped = 0;     // frames dropped because the queue was full or the port failed
+    unsigned long long replaced = 0;    // queued frames replaced by a newer one of their type
+};
+
+
+class SerialWriter
+{
+public:
+    SerialWriter();
+
+    // queue payload as a frame of type, returns false if it was dropped. A non-zero tag is
+    // reported to on_written when the frame has been written
+    bool queue_frame(uint8_t type, const uint8_t* payload, uint8_t length, uint64_t tag = 0);
+
+    // queue unframed bytes, they are never replaced, returns false if they were dropped
+    bool queue(const uint8_t* bytes, size_t size);
+
+    // a newer frame of type replaces a queued one of the same size that is not being written yet
+    void replace_queued(uint8_t type);
+
+    // called with the type and tag of every tagged frame written whole, from flush
+    void on_written(std::function<void(uint8_t type, uint64_t tag)> callback);
+
+    // write what is queued to fd with one writev, returns false if fd failed (what was queued is dropped then)
+    bool flush(int fd);
+
+    bool empty() const { return head == tail; }
+
+    SerialStats stats() const;
+
+    const static size_t CAPACITY = 1024;        // bytes, power of two
+    const static size_t RECORDS = CAPACITY / 4; // frames are at least 4 bytes, unframed bytes can run out of records first
+
+private:
+    // where a queued frame is in the ring
+    struct Record
+    {
+        uint64_t start;     // byte position
+        size_t size;
+        int type;           // -1 for unframed bytes
+        uint64_t tag;       // 0 if nobody waits for it to be written
+    };
+
+    bool push(const uint8_t* bytes, size_t size, int type, uint64_t tag);
+    Record& record(size_t index) { return records[(first_record + index) & (RECORDS - 1)]; }
+    void written_bytes(size_t size);
+
+    uint8_t ring[CAPACITY];
+    uint64_t head;          // next byte to write, only ever increases
+    uint64_t tail;          // next byte to queue, only ever increases
+    Record records[RECORDS];
+    size_t first_record;    // oldest queued frame
+    size_t record_count;
+    std::bitset<256> replaceable;
+    std::function<void(uint8_t type, uint64_t tag)> written_callback;
+
+    SerialStats counters;
+    int64_t window_start_ns;
+    unsigned long long window_bytes;
+};
+
+#endif // SERIAL_WRITER_HPP
@@ -17,10 +17,12 @@ Wrapper class for socket communication.
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
-#include <sys/time.h> //FD_SET, FD_ISSET, FD_ZERO macros
+#include <sys/uio.h>
+#include <netinet/tcp.h>
 #include <vector>
 #include <string>
 #include <iostream>
+#include <algorithm>
 
 #include <json/json.hpp>
 
@@ -31,6 +33,10 @@ Wrapper class for socket communication.
 using json = nlohmann::json;
 
 
+// most messages written to a client in one call
+#define WRITE_PIECES 16
+
+
 static std::vector<std::string>
 split_str(const std::string &text, std::string delim)
 {
@@ -51,47 +57,190 @@ split_str(const std::string &text, std::string delim)
 }
 
 
-Socket::Socket(int max_clients)
+Socket::Socket(int max_clients, size_t queue_messages, size_t queue_bytes) :
+    max_clients(max_clients),
+    queue_messages(queue_messages),
+    queue_bytes(queue_bytes)
+{
+
+}
+
+Socket::~Socket()
 {
-    this->max_clients = max_clients;
-    client_sockets.assign(max_clients, 0);
+    while (!clients.empty()) drop_client(clients.begin()->first);
+    if (master_socket >= 0)
+    {
+        if (loop) loop->remove(master_socket);
+        close(master_socket);
+    }
+}
+
+Socket::Message
+Socket::encode(const std::string& msg)
+{
+    return std::make_shared<const std::string>(msg + "__MSG_END__");
 }
 
 void
 Socket::send_to_clients_json(json msg)
 {
-    send_to_clients(msg.dump());
+    std::string topic = msg.contains("id") && msg["id"].is_string() ? msg["id"].get<std::string>() : "";
+    send_to_clients(msg.dump(), topic);
 }
 
 void Socket::send_to_clients_json(std::string route, json msg)
 {
     json patch = {{"route", route}};
     msg.merge_patch(patch);
-    send_to_clients(msg);
+    send_to_clients(msg.dump(), route);
+}
+
+
+void Socket::send_to_clients(std::string msg, const std::string& topic){
+    if (clients.empty()) return;
+
+    //Encoded once, every client queues the same message
+    Message message = encode(msg);
+    std::vector<int> behind;
+    for (auto& [sd, client] : clients) {
+        if (!send_message(sd, message, topic)) behind.push_back(sd);
+    }
+    for (int sd : behind) drop_client(sd);
+}
+
+void Socket::send_to_client_json(int sd, json msg)
+{
+    std::string topic = msg.contains("id") && msg["id"].is_string() ? msg["id"].get<std::string>() : "";
+    send_to_client(sd, msg.dump(), topic);
 }
 
 
-void Socket::send_to_clients(std::string msg){
-    //check_incoming_message();
-    msg = msg + "__MSG_END__";
-    for (unsigned i = 0; i < client_sockets.size(); i++) {
-        int client = client_sockets[i];
-        if (client == 0)
-            continue;
-        if( send(client, msg.c_str(), msg.length(), 0) != (ssize_t)msg.length() ){
-            WARN("Could not send message to client");
-            client_sockets[i] = 0;
+void Socket::send_to_client(int sd, std::string msg, const std::string& topic){
+    if (clients.count(sd) == 0) return;
+    if (!send_message(sd, encode(msg), topic)) drop_client(sd);
+}
+
+void Socket::set_topic_policy(const std::string& topic, TopicPolicy policy){
+    policies[topic] = policy;
+}
+
+TopicPolicy Socket::policy(const std::string& topic) const {
+    auto it = policies.find(topic);
+    return it != policies.end() ? it->second : TopicPolicy::DROP;
+}
+
+bool Socket::send_message(int sd, const Message& message, const std::string& topic){
+    Client& client = clients[sd];
+    TopicPolicy topic_policy = policy(topic);
+
+    //Replace the queued one of a coalesced topic, seqs before the front of the queue are sent or on the way
+    if (topic_policy == TopicPolicy::COALESCE) {
+        auto it = client.coalescing.find(topic);
+        unsigned long long front_seq = client.next_seq - client.queue.size();
+        if (it != client.coalescing.end() && it->second >= front_seq) {
+            Queued& queued = client.queue[it->second - front_seq];
+            client.queued_bytes += message->size() - queued.message->size();
+            queued.message = message;
+            counters.coalesced++;
+            return true;
+        }
+    }
+
+    if (client.queue.size() >= queue_messages || client.queued_bytes + message->size() > queue_bytes) {
+        if (topic_policy != TopicPolicy::KEEP) {
+            counters.dropped++;
+            return true;
+        }
+        WARN("Client ", sd, " fell too far behind, disconnecting it");
+        counters.disconnected++;
+        return false;
+    }
+
+    unsigned long long seq = client.next_seq++;
+    client.queue.push_back(Queued{message, topic, seq});
+    client.queued_bytes += message->size();
+    if (topic_policy == TopicPolicy::COALESCE) client.coalescing[topic] = seq;
+    counters.max_queued = std::max(counters.max_queued, client.queue.size());
+
+    //Already waiting for the socket to take more, it is written then
+    if (client.writable) return true;
+    return write_client(sd);
+}
+
+bool Socket::write_client(int sd){
+    Client& client = clients[sd];
+    while (client.sending || !client.queue.empty()) {
+        //Everything waiting in one call, from where the partly written message left off
+        iovec pieces[WRITE_PIECES];
+        int count = 0;
+        if (client.sending) pieces[count++] = {(void*)(client.sending->data() + client.sent), client.sending->size() - client.sent};
+        for (size_t i = 0; i < client.queue.size() && count < WRITE_PIECES; i++) {
+            const std::string& queued = *client.queue[i].message;
+            pieces[count++] = {(void*)queued.data(), queued.size()};
+        }
+        msghdr header{};
+        header.msg_iov = pieces;
+        header.msg_iovlen = count;
+        ssize_t written = sendmsg(sd, &header, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                watch(sd);
+                return true;
+            }
+            WARN("Could not send message to client ", sd, ", errno ", errno);
+            return false;
+        }
+
+        //Messages written whole are done, the next one is on the way
+        size_t left = written;
+        while (left > 0) {
+            if (!client.sending) {
+                Queued& front = client.queue.front();
+                auto it = client.coalescing.find(front.topic);
+                if (it != client.coalescing.end() && it->second == front.seq) client.coalescing.erase(it);
+                client.queued_bytes -= front.message->size();
+                client.sending = std::move(front.message);
+                client.sent = 0;
+                client.queue.pop_front();
+            }
+            size_t part = std::min(left, client.sending->size() - client.sent);
+            client.sent += part;
+            left -= part;
+            if (client.sent == client.sending->size()) {
+                client.sending.reset();
+                counters.sent++;
+            }
         }
     }
+
+    //All written, nothing to wait for
+    if (client.writable && loop) loop->remove_writable(sd);
+    client.writable = false;
+    return true;
+}
+
+void Socket::watch(int sd){
+    Client& client = clients[sd];
+    if (client.writable || !loop) return;
+    client.writable = true;
+    loop->add_writable(sd, [this, sd](){
+        if (clients.count(sd) && !write_client(sd)) drop_client(sd);
+    });
+}
+
+SocketStats Socket::stats() const {
+    SocketStats stats = counters;
+    stats.clients = clients.size();
+    for (const auto& [sd, client] : clients) stats.queued += client.queue.size();
+    return stats;
 }
 
 void Socket::emit_message(int sd, std::string msg){
-    std::string entire_msg = last_msg_buffer + msg;
+    std::string& input = clients[sd].input;
+    std::string entire_msg = input + msg;
     std::vector<std::string> packets = split_str(entire_msg, "__MSG_END__");
-    std::string last_msg = packets[packets.size()-1];
-    if (last_msg.size() > 0) {
-        last_msg_buffer = last_msg; // Save partial message
-    } 
+    input = packets[packets.size()-1]; // Save partial message
     packets.pop_back();
     for (MessageHandler message_handler: message_handlers) {
         for (std::string packet: packets)  {
@@ -124,11 +273,15 @@ void Socket::on_json(JsonHandler json_handler){
     this->json_handlers.push_back(json_handler);
 }
 
-void Socket::start_socket(){
+void Socket::on_connect(ConnectHandler connect_handler){
+    this->connect_handlers.push_back(connect_handler);
+}
+
+void Socket::start_socket(int port){
     //create a master socket
     WARN("STARTING SOCKET");
-    master_socket = socket(AF_INET , SOCK_STREAM , 0);
-    if (!master_socket) {
+    master_socket = socket(AF_INET , SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC , 0);
+    if (master_socket < 0) {
         perror("socket failed");
         exit(EXIT_FAILURE);
     }
@@ -144,7 +297,7 @@ void Socket::start_socket(){
     //type of socket created
     address.sin_family = AF_INET;
     address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons( PORT );
+    address.sin_port = htons( port );
 
     //bind the socket to localhost port 8000
     if (bind(master_socket, cast_sock_addr(), sizeof(address))<0)
@@ -152,7 +305,7 @@ void Socket::start_socket(){
         perror("bind failed");
         exit(EXIT_FAILURE);
     }
-    printf("Listener on port %d \n", PORT);
+    printf("Listener on port %d \n", port);
 
     // try to specify maximum of 3 pending connections for the master socket
     if (listen(master_socket, 3) < 0)
@@ -167,39 +320,32 @@ void Socket::start_socket(){
 }
 
 void Socket::check_activity(){
-    //clear the socket set
-    FD_ZERO(&readfds);
-
-    //add master socket to set
-    FD_SET(master_socket, &readfds);
-    int max_sd = master_socket;
-
-    //add child sockets to set
-    for (int i = 0 ; i < max_clients ; i++)
-    {
-        //socket descriptor
-        int sd = client_sockets[i];
-
-        //if valid socket descriptor then add to read list
-        if(sd > 0)
-            FD_SET( sd , &readfds);
-
-        //highest file descriptor number, need it for the select function
-        if(sd > max_sd)
-            max_sd = sd;
+    //Served by a loop of its own until attached to another one
+    if (!own_loop) {
+        own_loop.reset(new EventLoop());
+        if (!loop) attach(*own_loop);
     }
+    if (loop == own_loop.get()) own_loop->run_once(ACTIVITY_DELAY_MICRO_SECONDS / 1000);
+}
 
-    //wait for an activity on one of the sockets , timeout is NULL (last arg),
-    //so wait indefinitely
-    // NOTE: Might be problem when integrating bcz of stalling
-    timeval timeout = {0, ACTIVITY_DELAY_MICRO_SECONDS};
-    activity = select( max_sd + 1 , &readfds , NULL , NULL , &timeout);
+void Socket::attach(EventLoop& loop){
+    if (this->loop == &loop) return;
 
-    if ((activity < 0) && (errno!=EINTR)) {
-        return;
+    //Clients served by a previous loop move over
+    if (this->loop) {
+        this->loop->remove(master_socket);
+        for (auto& [sd, client] : clients) {
+            this->loop->remove(sd);
+            client.writable = false;
+        }
+    }
+    this->loop = &loop;
+    loop.add(master_socket, [this](){ accept_client(); });
+    for (auto& [sd, client] : clients) {
+        int fd = sd;
+        loop.add(fd, [this, fd](){ read_client(fd); });
+        if (client.sending || !client.queue.empty()) watch(fd);
     }
-    try_accept_client();
-    check_incoming_message();
 }
 
 sockaddr* Socket::cast_sock_addr(){
@@ -207,69 +353,74 @@ sockaddr* Socket::cast_sock_addr(){
 }
 
 
-void Socket::try_accept_client(){
-    //If something happened on the master socket ,
-    //then its an incoming connection
-    if (FD_ISSET(master_socket, &readfds))
+void Socket::accept_client(){
+    int new_socket = accept4(master_socket, cast_sock_addr(), (socklen_t*)&addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (new_socket < 0)
     {
-        if ((new_socket = accept(master_socket,  cast_sock_addr(), (socklen_t*)&addrlen))<0)
-        {
-            perror("accept");
-            exit(EXIT_FAILURE);
-        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) WARN("Could not accept client, errno ", errno);
+        return;
+    }
+
+    //inform user of socket number - used in send and receive commands
+    printf("New connection , socket fd is %d , ip is : %s , port : %d  \n" , new_socket , inet_ntoa(address.sin_addr) , ntohs(address.sin_port));
 
-        //inform user of socket number - used in send and receive commands
-        printf("New connection , socket fd is %d , ip is : %s , port : %d  \n" , new_socket , inet_ntoa(address.sin_addr) , ntohs(address.sin_port));
+    //No room for more clients
+    if ((int)clients.size() >= max_clients)
+    {
+        WARN("Too many clients, closing new connection");
+        close(new_socket);
+        return;
+    }
 
-        //send new connection greeting message
+    //Control messages are small, send them right away instead of waiting to fill a segment
+    int nodelay = 1;
+    setsockopt(new_socket, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
 
+    clients[new_socket] = Client();
+    if (loop)
+    {
+        int sd = new_socket;
+        loop->add(sd, [this, sd](){ read_client(sd); });
+    }
 
-        //add new socket to array of sockets
-        for (int i = 0; i < max_clients; i++)
-        {
-            //if position is empty
-            if( client_sockets[i] == 0 )
-            {
-                client_sockets[i] = new_socket;
-                break;
-            }
-        }
+    for (ConnectHandler connect_handler: connect_handlers) {
+        connect_handler(new_socket);
     }
 }
 
-void Socket::check_incoming_message(){
-    for (int i = 0; i < max_clients; i++)
+void Socket::read_client(int sd){
+    if (clients.count(sd) == 0) return;
+
+    //Check if it was for closing , and also read the
+    //incoming message
+    int num_bytes_read = read( sd , buffer, 1024);
+    if (num_bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return;
+    if (num_bytes_read <= 0)
     {
-        int sd = client_sockets[i];
-
-        if (FD_ISSET( sd , &readfds))
-        {
-            //Check if it was for closing , and also read the
-            //incoming message
-            int num_bytes_read = read( sd , buffer, 1024);
-            if (num_bytes_read <= 0)
-            {
-                //Somebody disconnected , get his details and print
-                getpeername(sd , cast_sock_addr(), (socklen_t*)&addrlen);
-                printf("Host disconnected , ip %s , port %d \n", inet_ntoa(address.sin_addr) , ntohs(address.sin_port));
-
-                //Close the socket and mark as 0 in list for reuse
-                close(sd);
-                client_sockets[i] = 0;
-            }
+        //Somebody disconnected , get his details and print
+        getpeername(sd , cast_sock_addr(), (socklen_t*)&addrlen);
+        printf("Host disconnected , ip %s , port %d \n", inet_ntoa(address.sin_addr) , ntohs(address.sin_port));
 
-            //Echo back the message that came in
-            else
-            {
-                //set the string terminating NULL byte on the end
-                //of the data read
-                //buffer[num_bytes_read] = '\0';
+        //Close the socket and forget the client
+        drop_client(sd);
+    }
 
-                
+    //Echo back the message that came in
+    else
+    {
+        //set the string terminating NULL byte on the end
+        //of the data read
+        //buffer[num_bytes_read] = '\0';
 
-                //printf("msg incoming: %s\n", buffer);
-                emit_message(sd, std::string(buffer, num_bytes_read));
-            }
-        }
+        
+
+        //printf("msg incoming: %s\n", buffer);
+        emit_message(sd, std::string(buffer, num_bytes_read));
     }
 }
+
+void Socket::drop_client(int sd){
+    if (clients.erase(sd) == 0) return;
+    if (loop) loop->remove(sd);
+    close(sd);
+}
@@ -6,6 +6,18 @@ created: 2019-11-13
 
 Wrapper class for socket communication.
 
+Clients are served from an epoll event loop with non-blocking sockets.
+Every client has a bounded queue of its own, written whenever its socket
+takes more, so sending never waits for a client and a slow or stalled one
+only falls behind itself. A message is encoded once and shared by the
+queues it is put in.
+
+What happens to a message for a client that is behind depends on its
+topic (its "id"): coalesced topics only keep the latest message queued,
+dropped topics are not queued once the queue is full, and kept topics are
+always queued, a client too far behind for them is disconnected so it can
+connect again and start over.
+
 */
 
 #ifndef SOCKET_H
@@ -25,50 +37,132 @@ Wrapper class for socket communication.
 #include <string>
 #include <iostream>
 #include <functional>
+#include <deque>
+#include <memory>
+#include <unordered_map>
 
 #include <json/json.hpp>
 
+#include "event_loop.hpp"
+
 
 #define PORT 8000
 #define ACTIVITY_DELAY_MICRO_SECONDS 0
 //#define ACTIVITY_DELAY_MICRO_SECONDS 10000
 
+// default bounds of each client's queue
+#define CLIENT_QUEUE_MESSAGES 256
+#define CLIENT_QUEUE_BYTES (4 << 20)
+
 
 using MessageHandler = std::function<void(std::string, int)>;
 using JsonHandler = std::function<void(nlohmann::json, int)>;
+using ConnectHandler = std::function<void(int)>;
+
+
+// what happens to messages of a topic for a client whose queue is full or behind
+enum class TopicPolicy
+{
+    KEEP,       // always queued, a client whose queue is full is disconnected instead
+    DROP,       // not queued for a client whose queue is full
+    COALESCE    // replaces the one of the topic still queued, so a client behind only gets the latest
+};
+
+
+struct SocketStats
+{
+    size_t clients = 0;
+    size_t queued = 0;                      // messages waiting for all clients
+    size_t max_queued = 0;                  // most messages ever waiting for one client
+    unsigned long long sent = 0;            // messages written whole to a client
+    unsigned long long dropped = 0;
+    unsigned long long coalesced = 0;
+    unsigned long long disconnected = 0;    // clients disconnected for falling behind on a kept topic
+};
+
+
 class Socket {
 
 public:
-    Socket(int max_clients=30);
+    // queue_messages, queue_bytes: bounds of each client's queue
+    Socket(int max_clients=30, size_t queue_messages=CLIENT_QUEUE_MESSAGES, size_t queue_bytes=CLIENT_QUEUE_BYTES);
+    ~Socket();
 
+    // messages are sent by topic, the id of JSON messages and the route of routed ones
     void send_to_clients_json(nlohmann::json msg);
     void send_to_clients_json(std::string route, nlohmann::json msg);
-    void send_to_clients(std::string msg);
+    void send_to_clients(std::string msg, const std::string& topic = "");
+    void send_to_client_json(int sd, nlohmann::json msg);
+    void send_to_client(int sd, std::string msg, const std::string& topic = "");
+
+    // topics are dropped unless set otherwise
+    void set_topic_policy(const std::string& topic, TopicPolicy policy);
 
     void on_message(MessageHandler message_handler);
     void on_json(JsonHandler json_handler);
-    void start_socket();
+    void on_connect(ConnectHandler connect_handler);
+    void start_socket(int port = PORT);
+    // handle clients that connected, sent something or can take more, without waiting
     void check_activity();
+    // let loop call back when clients connect, send or can take more, instead of calling check_activity.
+    // everything else must then be called from loop's thread
+    void attach(EventLoop& loop);
+
+    SocketStats stats() const;
 
 private:
+    using Message = std::shared_ptr<const std::string>;
+
+    struct Queued
+    {
+        Message message;
+        std::string topic;
+        unsigned long long seq;
+    };
+
+    struct Client
+    {
+        std::deque<Queued> queue;               // not started on yet, oldest first
+        size_t queued_bytes = 0;
+        Message sending;                        // message partly written, null if none
+        size_t sent = 0;                        // bytes of it written
+        unsigned long long next_seq = 0;        // seq of the next message queued
+        std::unordered_map<std::string, unsigned long long> coalescing;    // seq of the message queued of each coalesced topic
+        bool writable = false;                  // waiting for the socket to take more
+        std::string input;                      // partial message received
+    };
+
+    // message with the end marker
+    static Message encode(const std::string& msg);
+    TopicPolicy policy(const std::string& topic) const;
+    // queue and write as much as the socket takes, returns false if the client was disconnected
+    bool send_message(int sd, const Message& message, const std::string& topic);
+    bool write_client(int sd);
+    void watch(int sd);
+
     void emit_message(int sd, std::string msg);
 
     sockaddr* cast_sock_addr();
-    void try_accept_client();
-    void check_incoming_message();
+    void accept_client();
+    void read_client(int sd);
+    void drop_client(int sd);
 
     int opt = 1;
-    int master_socket , addrlen , new_socket;
-    int max_clients, activity;
-    std::vector<int> client_sockets;
+    int master_socket = -1, addrlen;
+    int max_clients;
+    size_t queue_messages, queue_bytes;
+    std::unordered_map<int, Client> clients;
+    std::unordered_map<std::string, TopicPolicy> policies;
     struct sockaddr_in address;
     char buffer[1025];  //data buffer of 1K
 
-    fd_set readfds;
+    EventLoop* loop = nullptr;
+    std::unique_ptr<EventLoop> own_loop;    // serves clients from check_activity when not attached
 
     std::vector<MessageHandler> message_handlers;
     std::vector<JsonHandler> json_handlers;
-    std::string last_msg_buffer;
+    std::vector<ConnectHandler> connect_handlers;
+    SocketStats counters;
 };
 
 
@@ -0,0 +1,324 @@
+/*
+
+file: spatial_index.cpp
+created: 2026-10-17
+
+Nearest neighbour lookups among scan points.
+
+*/
+
+
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+
+#include "spatial_index.hpp"
+
+
+static float distance2(const Vec2& a, const Vec2& b)
+{
+    Vec2 d = a - b;
+    return d.dot(d);
+}
+
+
+KdTree::KdTree() {}
+
+
+void KdTree::build(const std::vector<Vec2>& input)
+{
+    nodes.resize(input.size());
+    for(size_t i = 0; i < input.size(); i++) nodes[i] = Node{input[i], (int)i, 0};
+    build(0, (int)nodes.size());
+}
+
+
+void KdTree::build(int lo, int hi)
+{
+    if(hi - lo <= 1) return;
+
+    // split along the axis with the largest spread, the walls make scans long and thin
+    float min_x = nodes[lo].p.x, max_x = min_x, min_y = nodes[lo].p.y, max_y = min_y;
+    for(int i = lo + 1; i < hi; i++)
+    {
+        min_x = std::min(min_x, nodes[i].p.x);
+        max_x = std::max(max_x, nodes[i].p.x);
+        min_y = std::min(min_y, nodes[i].p.y);
+        max_y = std::max(max_y, nodes[i].p.y);
+    }
+    int axis = max_y - min_y > max_x - min_x ? 1 : 0;
+
+    // median becomes the node, smaller ones go left and larger ones right
+    int mid = (lo + hi) / 2;
+    std::nth_element(nodes.begin() + lo, nodes.begin() + mid, nodes.begin() + hi, [axis](const Node& a, const Node& b) {
+        return axis ? a.p.y < b.p.y : a.p.x < b.p.x;
+    });
+    nodes[mid].axis = axis;
+
+    build(lo, mid);
+    build(mid + 1, hi);
+}
+
+
+void KdTree::nearest(const Vec2& p, int lo, int hi, int& best, float& best_dist) const
+{
+    if(lo >= hi) return;
+    int mid = (lo + hi) / 2;
+    const Node& node = nodes[mid];
+    const Vec2& q = node.p;
+
+    float d = distance2(p, q);
+    if(d < best_dist)
+    {
+        best_dist = d;
+        best = mid;
+    }
+
+    // near side first, the far side only if the splitting line is closer than the best so far
+    float diff = node.axis ? p.y - q.y : p.x - q.x;
+    if(diff < 0)
+    {
+        nearest(p, lo, mid, best, best_dist);
+        if(diff * diff < best_dist) nearest(p, mid + 1, hi, best, best_dist);
+    }
+    else
+    {
+        nearest(p, mid + 1, hi, best, best_dist);
+        if(diff * diff < best_dist) nearest(p, lo, mid, best, best_dist);
+    }
+}
+
+
+int KdTree::nearest(const Vec2& p, float max_distance) const
+{
+    int best = -1;
+    float best_dist = max_distance * max_distance;
+    nearest(p, 0, (int)nodes.size(), best, best_dist);
+    return best < 0 ? -1 : nodes[best].index;
+}
+
+
+void KdTree::radius(const Vec2& p, float r2, int lo, int hi, std::vector<int>& out) const
+{
+    if(lo >= hi) return;
+    int mid = (lo + hi) / 2;
+    const Node& node = nodes[mid];
+    const Vec2& q = node.p;
+
+    if(distance2(p, q) <= r2) out.push_back(node.index);
+
+    float diff = node.axis ? p.y - q.y : p.x - q.x;
+    if(diff < 0 || diff * diff <= r2) radius(p, r2, lo, mid, out);
+    if(diff >= 0 || diff * diff <= r2) radius(p, r2, mid + 1, hi, out);
+}
+
+
+void KdTree::radius(const Vec2& p, float r, std::vector<int>& out) const
+{
+    radius(p, r * r, 0, (int)nodes.size(), out);
+}
+
+
+void KdTree::nearest(const std::vector<Vec2>& queries, std::vector<int>& out, float max_distance) const
+{
+    out.resize(queries.size());
+    int previous = -1;
+    for(size_t i = 0; i < queries.size(); i++)
+    {
+        // the answer of the previous query is a candidate, so the search starts with a tight bound
+        int best = previous;
+        float best_dist = max_distance * max_distance;
+        if(previous >= 0)
+        {
+            float d = distance2(queries[i], nodes[previous].p);
+            if(d < best_dist) best_dist = d;
+            else best = -1;
+        }
+        nearest(queries[i], 0, (int)nodes.size(), best, best_dist);
+        previous = best;
+        out[i] = best < 0 ? -1 : nodes[best].index;
+    }
+}
+
+
+void KdTree::radius(const std::vector<Vec2>& queries, float r, std::vector<int>& offsets, std::vector<int>& out) const
+{
+    out.clear();
+    offsets.resize(queries.size() + 1);
+    offsets[0] = 0;
+    for(size_t i = 0; i < queries.size(); i++)
+    {
+        radius(queries[i], r * r, 0, (int)nodes.size(), out);
+        offsets[i + 1] = (int)out.size();
+    }
+}
+
+
+size_t KdTree::size() const
+{
+    return nodes.size();
+}
+
+
+GridHash::GridHash(float cell_size) : cell_size(cell_size), table(), mask(0) {}
+
+
+uint64_t GridHash::key_of(int col, int row)
+{
+    return ((uint64_t)(uint32_t)col << 32) | (uint32_t)row;
+}
+
+
+int GridHash::find(int col, int row) const
+{
+    if(table.empty()) return -1;
+    uint64_t key = key_of(col, row);
+
+    // fibonacci hashing, then linear probing until the key or an empty slot
+    for(uint64_t slot = (key * 0x9E3779B97F4A7C15ull) >> 32 & mask;; slot = (slot + 1) & mask)
+    {
+        if(table[slot].key == key) return (int)slot;
+        if(table[slot].key == EMPTY) return -1;
+    }
+}
+
+
+void GridHash::build(const std::vector<Vec2>& input)
+{
+    // sort points by cell so each cell is one range
+    std::vector<uint64_t> keys(input.size());
+    for(size_t i = 0; i < input.size(); i++)
+    {
+        keys[i] = key_of((int)std::floor(input[i].x / cell_size), (int)std::floor(input[i].y / cell_size));
+    }
+    indices.resize(input.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    std::sort(indices.begin(), indices.end(), [&](int a, int b) { return keys[a] < keys[b]; });
+
+    points.resize(input.size());
+    size_t cells = 0;
+    for(size_t i = 0; i < input.size(); i++)
+    {
+        points[i] = input[indices[i]];
+        if(i == 0 || keys[indices[i]] != keys[indices[i - 1]]) cells++;
+    }
+
+    // at most half full
+    size_t capacity = 16;
+    while(capacity < 2 * cells) capacity *= 2;
+    table.assign(capacity, Cell{EMPTY, 0, 0});
+    mask = capacity - 1;
+
+    for(size_t i = 0; i < input.size();)
+    {
+        uint64_t key = keys[indices[i]];
+        size_t end = i;
+        while(end < input.size() && keys[indices[end]] == key) end++;
+
+        uint64_t slot = (key * 0x9E3779B97F4A7C15ull) >> 32 & mask;
+        while(table[slot].key != EMPTY) slot = (slot + 1) & mask;
+        table[slot] = Cell{key, (int)i, (int)end};
+        i = end;
+    }
+}
+
+
+template<typename F>
+void GridHash::visit(const Vec2& p, float r, F&& f) const
+{
+    int col0 = (int)std::floor((p.x - r) / cell_size), col1 = (int)std::floor((p.x + r) / cell_size);
+    int row0 = (int)std::floor((p.y - r) / cell_size), row1 = (int)std::floor((p.y + r) / cell_size);
+    for(int col = col0; col <= col1; col++)
+    {
+        for(int row = row0; row <= row1; row++)
+        {
+            int slot = find(col, row);
+            if(slot < 0) continue;
+            for(int i = table[slot].start; i < table[slot].end; i++) f(i);
+        }
+    }
+}
+
+
+int GridHash::nearest(const Vec2& p, float max_distance) const
+{
+    int best = -1;
+    float best_dist = max_distance * max_distance;
+    visit(p, max_distance, [&](int i) {
+        float d = distance2(p, points[i]);
+        if(d < best_dist)
+        {
+            best_dist = d;
+            best = i;
+        }
+    });
+    return best < 0 ? -1 : indices[best];
+}
+
+
+void GridHash::radius(const Vec2& p, float r, std::vector<int>& out) const
+{
+    float r2 = r * r;
+    visit(p, r, [&](int i) {
+        if(distance2(p, points[i]) <= r2) out.push_back(indices[i]);
+    });
+}
+
+
+void GridHash::nearest(const std::vector<Vec2>& queries, std::vector<int>& out, float max_distance) const
+{
+    out.resize(queries.size());
+    int previous = -1;
+    for(size_t i = 0; i < queries.size(); i++)
+    {
+        // the previous answer is a candidate and bounds the search, so fewer cells are looked at
+        int best = -1;
+        float best_dist = max_distance * max_distance;
+        if(previous >= 0)
+        {
+            float d = distance2(queries[i], points[previous]);
+            if(d < best_dist)
+            {
+                best_dist = d;
+                best = previous;
+            }
+        }
+        float bound = std::sqrt(best_dist);
+
+        visit(queries[i], bound, [&](int j) {
+            float d = distance2(queries[i], points[j]);
+            if(d < best_dist)
+            {
+                best_dist = d;
+                best = j;
+            }
+        });
+        previous = best;
+        out[i] = best < 0 ? -1 : indices[best];
+    }
+}
+
+
+void GridHash::radius(const std::vector<Vec2>& queries, float r, std::vector<int>& offsets, std::vector<int>& out) const
+{
+    out.clear();
+    offsets.resize(queries.size() + 1);
+    offsets[0] = 0;
+    for(size_t i = 0; i < queries.size(); i++)
+    {
+        radius(queries[i], r, out);
+        offsets[i + 1] = (int)out.size();
+    }
+}
+
+
+size_t GridHash::size() const
+{
+    return points.size();
+}
+
+
+float GridHash::get_cell_size() const
+{
+    return cell_size;
+}
@@ -0,0 +1,127 @@
+/*
+
+file: spatial_index.hpp
+created: 2026-10-17
+
+Nearest neighbour lookups among scan points.
+
+KdTree is a static 2D tree kept as one flat array in the order of an
+implicit balanced tree, the median of each range is the node splitting it.
+It answers nearest neighbour and radius queries of any size.
+
+GridHash buckets the points in square cells of a fixed size, looked up in
+an open addressing hash table, so radius queries around the cell size only
+look at a few cells. Points of a cell are stored next to each other.
+
+Both return indices into the points they were built from. Batch queries
+take the queries in scan order, where neighbouring queries have neighbouring
+answers, and reuse the previous answer to prune the search.
+
+*/
+
+
+#ifndef SPATIAL_INDEX_HPP
+#define SPATIAL_INDEX_HPP
+
+#include <stdint.h>
+#include <limits>
+#include <vector>
+
+#include "vec2.hpp"
+
+
+class KdTree
+{
+public:
+    KdTree();
+
+    // build tree from points, O(n log n), replaces any previous points
+    void build(const std::vector<Vec2>& points);
+
+    // index of the point nearest to p, -1 if there is none within max_distance
+    int nearest(const Vec2& p, float max_distance = std::numeric_limits<float>::infinity()) const;
+
+    // append indices of all points within r of p to out
+    void radius(const Vec2& p, float r, std::vector<int>& out) const;
+
+    // nearest point of every query, out[i] is the index for queries[i] or -1
+    void nearest(const std::vector<Vec2>& queries, std::vector<int>& out,
+                 float max_distance = std::numeric_limits<float>::infinity()) const;
+
+    // points within r of every query, the indices for queries[i] are out[offsets[i]] to out[offsets[i + 1]]
+    void radius(const std::vector<Vec2>& queries, float r, std::vector<int>& offsets, std::vector<int>& out) const;
+
+    size_t size() const;
+
+private:
+    struct Node
+    {
+        Vec2 p;
+        int index;      // index in the input
+        int axis;       // axis the node splits, 0 = x, 1 = y
+    };
+
+    void build(int lo, int hi);
+    void nearest(const Vec2& p, int lo, int hi, int& best, float& best_dist) const;
+    void radius(const Vec2& p, float r2, int lo, int hi, std::vector<int>& out) const;
+
+    // nodes in tree order
+    std::vector<Node> nodes;
+};
+
+
+class GridHash
+{
+public:
+    // cell_size: side of each cell in mm, about the usual query radius is best
+    GridHash(float cell_size);
+
+    // bucket points, O(n log n), replaces any previous points
+    void build(const std::vector<Vec2>& points);
+
+    // index of the point nearest to p, -1 if there is none within max_distance
+    int nearest(const Vec2& p, float max_distance) const;
+
+    // append indices of all points within r of p to out
+    void radius(const Vec2& p, float r, std::vector<int>& out) const;
+
+    // nearest point of every query, out[i] is the index for queries[i] or -1
+    void nearest(const std::vector<Vec2>& queries, std::vector<int>& out, float max_distance) const;
+
+    // points within r of every query, the indices for queries[i] are out[offsets[i]] to out[offsets[i + 1]]
+    void radius(const std::vector<Vec2>& queries, float r, std::vector<int>& offsets, std::vector<int>& out) const;
+
+    size_t size() const;
+
+    float get_cell_size() const;
+
+private:
+    struct Cell
+    {
+        uint64_t key;
+        int start, end;     // range of the cell in points
+    };
+
+    static uint64_t key_of(int col, int row);
+
+    // slot of the cell in table, -1 if the cell holds no points
+    int find(int col, int row) const;
+
+    // visit the points of all cells overlapping the square around p, f(point index in points)
+    template<typename F>
+    void visit(const Vec2& p, float r, F&& f) const;
+
+    const static uint64_t EMPTY = ~(uint64_t)0;
+
+    float cell_size;
+
+    // points sorted by cell and their index in the input
+    std::vector<Vec2> points;
+    std::vector<int> indices;
+
+    // open addressing table of non-empty cells, size is a power of two
+    std::vector<Cell> table;
+    uint64_t mask;
+};
+
+#endif // SPATIAL_INDEX_HPP
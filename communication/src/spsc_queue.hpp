@@ -0,0 +1,156 @@
+/*
+
+file: spsc_queue.hpp
+created: 2026-10-17
+
+Lock-free bounded queue from one producer thread to one consumer thread.
+
+A ring of slots with a head only written by the consumer and a tail only
+written by the producer, each on its own cache line. Each side keeps a copy
+of the other side's index and only reloads it when the ring looks full or
+empty, so most pushes and pops touch no shared cache line but their slot.
+
+Neither side ever blocks or waits. A push to a full queue drops the pushed
+item, telemetry rather loses a message than holds up the producer. A
+consumer that wants to sleep until there is something to pop pairs the
+queue with a Notifier.
+
+*/
+
+
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+
+#include "queue_stats.hpp"
+
+
+template<typename T>
+class SpscQueue
+{
+public:
+    // capacity: max number of queued items, rounded up to a power of two
+    SpscQueue(size_t capacity);
+
+    // push item, returns false if the queue was full and item was dropped
+    // called by the producer only
+    bool push(T item);
+
+    // pop the oldest item, returns false if there was none
+    // called by the consumer only
+    bool pop(T& item);
+
+    // number of queued items, exact from either side, a snapshot from other threads
+    size_t depth() const;
+
+    size_t capacity() const { return mask + 1; }
+
+    QueueStats stats() const { return counters.stats(depth()); }
+
+private:
+    struct Slot
+    {
+        T item;
+        int64_t pushed_ns;
+    };
+
+    const size_t mask;
+    std::unique_ptr<Slot[]> slots;
+
+    alignas(64) std::atomic<size_t> head;   // next slot to pop
+    size_t cached_tail;                     // consumer's copy of tail
+    alignas(64) std::atomic<size_t> tail;   // next slot to push
+    size_t cached_head;                     // producer's copy of head
+    alignas(64) QueueCounters counters;
+};
+
+
+static inline size_t spsc_capacity(size_t capacity)
+{
+    size_t rounded = 1;
+    while(rounded < capacity) rounded <<= 1;
+    return rounded;
+}
+
+
+template<typename T>
+SpscQueue<T>::SpscQueue(size_t capacity) :
+    mask(spsc_capacity(capacity) - 1),
+    slots(new Slot[mask + 1]),
+    head(0),
+    cached_tail(0),
+    tail(0),
+    cached_head(0),
+    counters()
+{
+
+}
+
+
+template<typename T>
+bool SpscQueue<T>::push(T item)
+{
+    size_t t = tail.load(std::memory_order_relaxed);
+    if(t - cached_head > mask)
+    {
+        // acquire pairs with the release in pop, the consumer is done with the slot
+        cached_head = head.load(std::memory_order_acquire);
+        if(t - cached_head > mask)
+        {
+            counters.on_push(t - cached_head);
+            counters.on_drop();
+            return false;
+        }
+    }
+
+    Slot& slot = slots[t & mask];
+    slot.item = std::move(item);
+    slot.pushed_ns = QueueCounters::now_ns();
+    tail.store(t + 1, std::memory_order_release);
+
+    // the cached head can be far behind, so the depth by it is only an upper bound.
+    // the real head is loaded when that would be a new max depth, which is seldom once the max is reached
+    size_t depth = t + 1 - cached_head;
+    if(counters.above_max(depth))
+    {
+        cached_head = head.load(std::memory_order_acquire);
+        depth = t + 1 - cached_head;
+    }
+    counters.on_push(depth);
+    return true;
+}
+
+
+template<typename T>
+bool SpscQueue<T>::pop(T& item)
+{
+    size_t h = head.load(std::memory_order_relaxed);
+    if(h == cached_tail)
+    {
+        // acquire pairs with the release in push, the slot is filled
+        cached_tail = tail.load(std::memory_order_acquire);
+        if(h == cached_tail) return false;
+    }
+
+    Slot& slot = slots[h & mask];
+    item = std::move(slot.item);
+    slot.item = T();    // let go of what the item holds now, not when the slot is reused
+    counters.on_pop(slot.pushed_ns);
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+
+template<typename T>
+size_t SpscQueue<T>::depth() const
+{
+    size_t h = head.load(std::memory_order_acquire);
+    size_t t = tail.load(std::memory_order_acquire);
+    return t > h ? t - h : 0;
+}
+
+#endif // SPSC_QUEUE_HPP
@@ -11,7 +11,6 @@ Choose what instructions that should be sent to steering module (AVR).
 #include "steering.hpp"
 #include "logging.hpp"
 #include "pc.hpp"
-#include <ctime>
 
 //Tune this depending on battery power
 #define MAX_SPEED 0.15f
@@ -20,26 +19,71 @@ Choose what instructions that should be sent to steering module (AVR).
 #define ROT_SPEED 0.15f
 #define FORWARD_SPEED 0.1f
 
+//Time in ms between regulations when moving forward
+#define REGULATION_PERIOD 10
+
+//Most decisions waiting for their drive frame, older ones are given up on
+#define UNWRITTEN_MAX 16
+
 
 Steering::Steering(const std::string& file) :
 	Module(file),
+	rotation(Rotation::NONE),
 	kp(1.5f),
 	kd(1.0f),
 	latest_control(),
-	rotation(Rotation::NONE),
+    sent(),
+    sent_valid(false),
+    drives(0),
+    unchanged(0),
 	prev_rotation(Rotation::NONE),
-    clock_steering(std::clock()),
+    timers(nullptr),
+    regulation_timer(0),
+    regulation_due(false),
+    tracer(nullptr),
+    trace(),
+    written_drive(0),
+    unwritten(),
     side_dist(0),
     front_dist(0),
     d_rot(0),
     regulate(true)
 {
+    //Only the newest speeds matter, one waiting to be written is replaced by a newer one.
+    serial.replace_queued((uint8_t)SteeringTx::DRIVE);
+    serial.replace_queued((uint8_t)SteeringTx::PWM);
+    serial.on_written([this](uint8_t type, uint64_t number){
+        if(type == (uint8_t)SteeringTx::DRIVE) drive_written(number);
+    });
     transmit_identified();
 }
 
 
 Steering::~Steering() {
+    if(timers) timers->cancel(regulation_timer);
     command(SteeringCommand::HALT);
+    //What is still queued is written when the serial closes, after this is gone.
+    serial.on_written(nullptr);
+}
+
+
+void
+Steering::set_tracer(LatencyTracer* tracer) {
+    this->tracer = tracer;
+}
+
+
+void
+Steering::decided(const LatencyTrace& trace) {
+    this->trace = trace;
+}
+
+
+void
+Steering::start_regulation(TimerWheel& timers) {
+    if(this->timers) this->timers->cancel(regulation_timer);
+    this->timers = &timers;
+    regulation_timer = timers.every(std::chrono::milliseconds(REGULATION_PERIOD), [this](){ regulation_due = true; });
 }
 
 
@@ -51,11 +95,8 @@ Steering::set_rotation(Rotation rot) {
 
 void 
 Steering::update() {
-    //Check if changed state
+    //Check if changed state, the new directions and speeds are sent together.
     if(prev_rotation != rotation){
-		control_speed(0.0f, 0.0f);
-        control_direction(false, false);
-		
 		switch (rotation) {
 			case Rotation::NONE:
 				control_direction(true, true);
@@ -70,14 +111,18 @@ Steering::update() {
                 control_speed(ROT_SPEED, ROT_SPEED);
 				break;
 		}
+        //Save rotation to be able to know if rotation has been changed, once the steering module gets it.
+        //A drive frame that did not fit in the queue is tried again next update.
+        if(transmit_control()) prev_rotation = rotation;
     }
     // If robot is moving forward and regulation should be applied.
-    else if (((std::clock() - clock_steering)/(float)CLOCKS_PER_SEC > 0.01f) && (rotation == Rotation::NONE)){
-        clock_steering = std::clock();
+    else if (regulation_due && (rotation == Rotation::NONE)){
+        regulation_due = false;
         move_forward();
     }
-    //Save rotation to be able to know if rotation has been changed.
-	prev_rotation = rotation;
+
+    //A decision that wrote nothing is done with, later writes are not its doing.
+    trace.decision_ns = 0;
 }
 
 
@@ -143,12 +188,19 @@ Steering::update_regulation(float right, float d_rotation, bool reg, float front
 }
 
 
+const SteeringControl&
+Steering::get_control() const {
+    return latest_control;
+}
+
+
 void
 Steering::rotate_regulated(float rot){
     float max = 0.3;
     float n_rot = rot/90.0f;
     float out = std::clamp(max*n_rot, 0.1f, max);
     control_speed(out, out);
+    transmit_control();
 }
 
 
@@ -191,6 +243,7 @@ Steering::command(const SteeringCommand command)
             control_speed(0.0f, 0.0f);
             break;
     }
+    transmit_control();
 }
 
 
@@ -199,6 +252,7 @@ Steering::control(const SteeringControl& control)
 {
     control_speed(control.left_speed, control.right_speed);
     control_direction(control.left_forward, control.right_forward);
+    transmit_control();
 }
 
 
@@ -209,65 +263,95 @@ Steering::control_speed(float left_speed, float right_speed)
     if(left_speed > 1.0f) left_speed = 1.0f;
     if(right_speed > 1.0f) right_speed = 1.0f;
     
-    // map from [0.0f, 1.0f] to [100, 255]
-    uint8_t left_pwm = 0, right_pwm = 0; 
-    if(left_speed != 0.0f) left_pwm = left_speed * (255 - 100) + 100;
-    if(right_speed != 0.0f) right_pwm = right_speed * (255 - 100) + 100;
-    
-    transmit_pwm(left_pwm, right_pwm);
-
     latest_control.left_speed = left_speed;
     latest_control.right_speed = right_speed;
-    
-    pc->steering(latest_control);
 }
 
 
 void
 Steering::control_direction(bool left_forward, bool right_forward)
 {
-    transmit_dir(left_forward, right_forward);
-
     latest_control.left_forward = left_forward;
     latest_control.right_forward = right_forward;
-    pc->steering(latest_control);
 }
 
 
-void
-Steering::calibrate(float kp, float kd)
+bool
+Steering::transmit_control()
 {
-    this->kp = kp;
-    this->kd = kd;
+    SteeringOutput output{speed_pwm(latest_control.left_speed), speed_pwm(latest_control.right_speed),
+        latest_control.left_forward, latest_control.right_forward};
+
+    //Nothing to send when the steering module already has this, a failed write is tried again next tick.
+    if(sent_valid && output == sent) unchanged++;
+    else if(transmit_drive(output, drives + 1)){
+        sent = output;
+        sent_valid = true;
+        drives++;
+        if(pc) pc->steering(latest_control);
+    }
+    bool queued = sent_valid && output == sent;
+
+    //The decision behind these speeds is written with the drive frame that has them, which may still be queued.
+    if(tracer && trace.decision_ns != 0 && queued){
+        if(written_drive >= drives) tracer->written(trace, monotonic_ns());
+        else {
+            if(unwritten.size() == UNWRITTEN_MAX) unwritten.pop_front();
+            unwritten.emplace_back(drives, trace);
+        }
+        trace.decision_ns = 0;
+    }
+    return queued;
 }
 
 
 void
-Steering::transmit_pwm(uint8_t left_pwm, uint8_t right_pwm) {
-    uint8_t bytes[3];
-    bytes[0] = (uint8_t)SteeringTx::PWM;
-    bytes[1] = left_pwm;
-    bytes[2] = right_pwm;
+Steering::drive_written(unsigned long long number)
+{
+    written_drive = number;
+
+    //How old the input of the decisions behind the frame is now that the steering module has it,
+    //earlier frames were replaced or dropped before they went out.
+    int64_t now = monotonic_ns();
+    while(!unwritten.empty() && unwritten.front().first <= number){
+        if(tracer && unwritten.front().first == number) tracer->written(unwritten.front().second, now);
+        unwritten.pop_front();
+    }
+}
+
+
+unsigned long long
+Steering::drive_count() const {
+    return drives;
+}
+
 
-    serial.write(bytes, 3);
+unsigned long long
+Steering::unchanged_count() const {
+    return unchanged;
 }
 
 
 void
-Steering::transmit_dir(bool left_forward, bool right_forward)
+Steering::calibrate(float kp, float kd)
 {
+    this->kp = kp;
+    this->kd = kd;
+}
+
+
+bool
+Steering::transmit_drive(const SteeringOutput& output, unsigned long long number) {
     uint8_t bytes[3];
-    bytes[0] = (uint8_t)SteeringTx::DIR;
-    bytes[1] = (uint8_t)left_forward;
-    bytes[2] = (uint8_t)right_forward;
+    bytes[0] = output.left_pwm;
+    bytes[1] = output.right_pwm;
+    bytes[2] = (output.left_forward ? 1 : 0) | (output.right_forward ? 2 : 0);
 
-    serial.write(bytes, 3);
+    return serial.write_frame((uint8_t)SteeringTx::DRIVE, bytes, 3, number);
 }
 
 
 void
 Steering::transmit_identified() {
-    uint8_t bytes[1];
-    bytes[0] = (uint8_t)SteeringTx::IDENTIFIED;
-    serial.write(bytes, 1);
+    serial.write_frame((uint8_t)SteeringTx::IDENTIFIED);
 }
@@ -12,11 +12,14 @@ Choose what instructions that should be sent to steering module (AVR).
 #define STEERING_HPP
 
 #include <stdint.h>
-#include <ctime>
 #include <string>
+#include <deque>
+#include <utility>
 
 #include "module.hpp"
 #include "serial.hpp"
+#include "timer_wheel.hpp"
+#include "latency.hpp"
 
 
 enum class Rotation : int {
@@ -33,11 +36,13 @@ enum class Direction : int {
 };
 
 
+// frame types to the steering module
 enum class SteeringTx : uint8_t
 {
     PWM = 1,
     DIR = 2,
     IDENTIFIED = 3,
+    DRIVE = 4,      // payload: left pwm, right pwm, directions (bit 0 left forward, bit 1 right forward)
 };
 
 
@@ -61,6 +66,32 @@ struct SteeringControl
     bool right_forward;
 };
 
+
+// what the steering module is told, as sent in a drive frame
+struct SteeringOutput
+{
+    uint8_t left_pwm;
+    uint8_t right_pwm;
+    bool left_forward;
+    bool right_forward;
+
+    bool operator==(const SteeringOutput& other) const
+    {
+        return left_pwm == other.left_pwm && right_pwm == other.right_pwm &&
+            left_forward == other.left_forward && right_forward == other.right_forward;
+    }
+    bool operator!=(const SteeringOutput& other) const { return !(*this == other); }
+};
+
+
+// pwm a wheel pair is driven with at speed, 0 stops it and (0, 1] maps to [100, 255]
+inline uint8_t speed_pwm(float speed)
+{
+    if(speed == 0.0f) return 0;
+    if(speed > 1.0f) speed = 1.0f;
+    return speed * (255 - 100) + 100;
+}
+
 class Steering : public Module {
 public:
     Steering(const std::string& file);
@@ -82,34 +113,58 @@ public:
     void rotate_regulated(float rot);
     /*Sets variables needed for regulation.*/
     void update_regulation(float dist, float rot, bool, float);
+    /*Returns the speeds and directions last sent to the steering module.*/
+    const SteeringControl& get_control() const;
+    /*Regulates forward motion every regulation period from now on, timed by timers.*/
+    void start_regulation(TimerWheel& timers);
+    /*Record in tracer how old the input of each decision is when the drive frame with its speeds is written.*/
+    void set_tracer(LatencyTracer* tracer);
+    /*The input the next speeds written are based on, the first write until the next update ends is recorded.*/
+    void decided(const LatencyTrace& trace);
+    /*Number of drive frames sent, and of control ticks that did not send one because nothing changed.*/
+    unsigned long long drive_count() const;
+    unsigned long long unchanged_count() const;
 
 private:
     //-------Variables---------------
     float kp, kd;
     SteeringControl latest_control;
+    SteeringOutput sent;    // last output the steering module was sent, only valid if sent_valid
+    bool sent_valid;
+    unsigned long long drives;
+    unsigned long long unchanged;
     Rotation prev_rotation;
-    std::clock_t clock_steering;
+    TimerWheel* timers;
+    TimerWheel::Id regulation_timer;
+    bool regulation_due;
+    LatencyTracer* tracer;
+    LatencyTrace trace;     // decision not handed to a drive frame yet, decision_ns is 0 once it is
+    unsigned long long written_drive;   // number of the last drive frame written whole
+    std::deque<std::pair<unsigned long long, LatencyTrace>> unwritten; // decisions waiting for the drive frame numbered first
     float side_dist;
     float front_dist;
     float d_rot;
     bool regulate;
 
     //----------Functions-------------
-    /*Creates an array containing three bytes (pwm_header, left_pwm, right_pwm) and passes it to serial class*/
-    void transmit_pwm(uint8_t left_pwm, uint8_t right_pwm);
-    /*Creates an array containing three bytes (dir_header, left_dir, right_dir) and passes it to serial class*/
-    void transmit_dir(bool left_forward, bool right_forward);
-    /*Creates an array containing one bytes (identified_header) and passes it to serial class*/
+    /*Sends a drive frame (left_pwm, right_pwm, directions) to the steering module, drive_written gets its number*/
+    bool transmit_drive(const SteeringOutput& output, unsigned long long number);
+    /*Sends an identified frame, without payload, to the steering module*/
     void transmit_identified();
     /*Here is the regulation when robot moves forward implemented. Sets direction and speed of wheelpairs depending
     on sensor values*/ 
     void move_forward();
     /*Given a struct steering control, calls control_speed and control_direction.*/
     void control(const SteeringControl& control);
-    /*Convert speed from a value between 0-1 to a value between 100-255. Passes new value to pc and to transmit function*/
+    /*Sets the speeds, between 0-1, to send at the end of the control tick.*/
     void control_speed(float left_speed, float right_speed);
-    /*Passes value of direction to transmit function and to pc.*/
+    /*Sets the directions to send at the end of the control tick.*/
     void control_direction(bool left_forward, bool right_forward);
+    /*Ends a control tick: sends speeds and directions as one drive frame and tells the pc,
+    unless the steering module already has them. Returns false if the drive frame was dropped.*/
+    bool transmit_control();
+    /*Records the decisions waiting for drive frame number, which has been written.*/
+    void drive_written(unsigned long long number);
 };
 
 #endif
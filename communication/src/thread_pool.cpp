@@ -0,0 +1,103 @@
+/*
+
+file: thread_pool.cpp
+created: 2026-10-17
+
+Fixed pool of worker threads for data parallel loops.
+
+*/
+
+
+#include <algorithm>
+
+#include "thread_pool.hpp"
+
+
+ThreadPool::ThreadPool(unsigned threads) :
+    stopping(false), generation(0), busy(0), task(nullptr), count(0), chunk(1), next(0)
+{
+    if(threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    for(unsigned i = 1; i < threads; i++) workers.emplace_back(&ThreadPool::run, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start.notify_all();
+    for(std::thread& worker : workers) worker.join();
+}
+
+
+unsigned ThreadPool::size() const
+{
+    return workers.size() + 1;
+}
+
+
+void ThreadPool::parallel_for(size_t n, const std::function<void(size_t, size_t)>& f, size_t grain)
+{
+    if(n == 0) return;
+
+    // not worth waking anyone up
+    if(workers.empty() || n <= grain)
+    {
+        f(0, n);
+        return;
+    }
+
+    std::lock_guard<std::mutex> loop_lock(loop_mutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &f;
+        count = n;
+        // a few ranges per thread so a slow thread does not hold up the others
+        chunk = std::max(grain, n / (4 * size()) + 1);
+        next.store(0);
+        busy = workers.size();
+        generation++;
+    }
+    start.notify_all();
+
+    work();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]{ return busy == 0; });
+    task = nullptr;
+}
+
+
+void ThreadPool::work()
+{
+    while(true)
+    {
+        size_t begin = next.fetch_add(chunk);
+        if(begin >= count) return;
+        (*task)(begin, std::min(count, begin + chunk));
+    }
+}
+
+
+void ThreadPool::run()
+{
+    unsigned long long seen = 0;
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start.wait(lock, [&]{ return stopping || generation != seen; });
+            if(stopping) return;
+            seen = generation;
+        }
+
+        work();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy--;
+        }
+        done.notify_one();
+    }
+}
@@ -0,0 +1,66 @@
+/*
+
+file: thread_pool.hpp
+created: 2026-10-17
+
+Fixed pool of worker threads for data parallel loops.
+
+The threads are started once and sleep between loops, so splitting a loop
+over all cores costs a wake up instead of a thread start. The calling thread
+works on the loop too.
+
+*/
+
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <stddef.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class ThreadPool
+{
+public:
+    // threads: number of threads working on each loop including the caller, 0 for one per core
+    ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    // call f(begin, end) on ranges covering [0, n) from all threads, returns when all are done
+    // loops from several threads run one at a time
+    // grain: smallest range handed out at once
+    void parallel_for(size_t n, const std::function<void(size_t, size_t)>& f, size_t grain = 16);
+
+    // number of threads working on each loop including the caller
+    unsigned size() const;
+
+private:
+    // worker thread loop
+    void run();
+
+    // take ranges of the current loop until none are left
+    void work();
+
+    std::vector<std::thread> workers;
+
+    std::mutex loop_mutex;          // held by the thread running a loop
+    std::mutex mutex;
+    std::condition_variable start;
+    std::condition_variable done;
+    bool stopping;
+    unsigned long long generation;  // increased for every loop, wakes the workers
+    unsigned busy;                  // workers still working on the current loop
+
+    // current loop
+    const std::function<void(size_t, size_t)>* task;
+    size_t count;
+    size_t chunk;
+    std::atomic<size_t> next;
+};
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,170 @@
+/*
+
+file: timer_wheel.cpp
+created: 2026-10-17
+
+One-shot and periodic timers on CLOCK_MONOTONIC.
+
+*/
+
+
+#include <time.h>
+#include <algorithm>
+
+#include "timer_wheel.hpp"
+
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick, size_t slots) :
+    tick_ns(std::max<uint64_t>(1, std::chrono::nanoseconds(tick).count())),
+    current(now().count() / tick_ns),
+    next_id(1),
+    timers(),
+    slots(std::max<size_t>(1, slots)),
+    due()
+{
+
+}
+
+
+std::chrono::nanoseconds TimerWheel::now()
+{
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+}
+
+
+TimerWheel::Id TimerWheel::after(std::chrono::milliseconds delay, Callback callback)
+{
+    // round up, a timer never fires early
+    uint64_t at = now().count() + std::chrono::nanoseconds(delay).count();
+    return schedule((at + tick_ns - 1) / tick_ns, 0, std::move(callback));
+}
+
+
+TimerWheel::Id TimerWheel::every(std::chrono::milliseconds period, Callback callback)
+{
+    uint64_t period_ticks = std::max<uint64_t>(1, (std::chrono::nanoseconds(period).count() + tick_ns - 1) / tick_ns);
+    uint64_t at = now().count() + std::chrono::nanoseconds(period).count();
+    return schedule((at + tick_ns - 1) / tick_ns, period_ticks, std::move(callback));
+}
+
+
+TimerWheel::Id TimerWheel::schedule(uint64_t expiry, uint64_t period, Callback callback)
+{
+    Id id = next_id++;
+    timers.emplace(id, Timer{expiry, period, std::make_shared<Callback>(std::move(callback))});
+    insert(id, expiry);
+    return id;
+}
+
+
+void TimerWheel::insert(Id id, uint64_t expiry)
+{
+    // the slot of the current tick is done, expired timers go in the next one
+    expiry = std::max(expiry, current + 1);
+    timers[id].expiry = expiry;
+    slots[expiry % slots.size()].push_back(id);
+}
+
+
+bool TimerWheel::cancel(Id id)
+{
+    return timers.erase(id) > 0;
+}
+
+
+int TimerWheel::advance()
+{
+    return advance(now());
+}
+
+
+int TimerWheel::advance(std::chrono::nanoseconds now)
+{
+    uint64_t target = now.count() / tick_ns;
+    if(target <= current) return 0;
+
+    // every slot holds at most one turn of ticks, after a long pause one look at each is enough
+    uint64_t steps = std::min<uint64_t>(target - current, slots.size());
+    due.clear();
+    for(uint64_t t = current + 1; t <= current + steps; t++)
+    {
+        std::vector<Id>& slot = slots[t % slots.size()];
+        size_t kept = 0;
+        for(Id id : slot)
+        {
+            auto it = timers.find(id);
+            if(it == timers.end()) continue;
+            if(it->second.expiry <= target) due.push_back(id);
+            else slot[kept++] = id;
+        }
+        slot.resize(kept);
+    }
+    current = target;
+
+    std::sort(due.begin(), due.end(), [this](Id a, Id b) {
+        uint64_t ea = timers.at(a).expiry, eb = timers.at(b).expiry;
+        return ea != eb ? ea < eb : a < b;
+    });
+
+    // callbacks may add and cancel timers, so look every timer up again
+    int called = 0;
+    for(Id id : due)
+    {
+        auto it = timers.find(id);
+        if(it == timers.end()) continue;
+        std::shared_ptr<Callback> callback = it->second.callback;
+        if(it->second.period > 0)
+        {
+            // next period after now, skipping the ones missed
+            const Timer& timer = it->second;
+            uint64_t next = timer.expiry + ((target - timer.expiry) / timer.period + 1) * timer.period;
+            insert(id, next);
+        }
+        else
+        {
+            timers.erase(it);
+        }
+        (*callback)();
+        called++;
+    }
+    return called;
+}
+
+
+int TimerWheel::next_timeout() const
+{
+    return next_timeout(now());
+}
+
+
+int TimerWheel::next_timeout(std::chrono::nanoseconds now) const
+{
+    if(timers.empty()) return -1;
+
+    // the first tick with a timer expiring in this turn, otherwise the earliest of the later turns
+    uint64_t earliest = UINT64_MAX;
+    for(uint64_t t = current + 1; t <= current + slots.size() && earliest == UINT64_MAX; t++)
+    {
+        for(Id id : slots[t % slots.size()])
+        {
+            auto it = timers.find(id);
+            if(it != timers.end() && it->second.expiry == t) earliest = t;
+        }
+    }
+    if(earliest == UINT64_MAX)
+    {
+        for(const auto& [id, timer] : timers) earliest = std::min(earliest, timer.expiry);
+    }
+
+    int64_t wait = (int64_t)(earliest * tick_ns) - now.count();
+    if(wait <= 0) return 0;
+    return (int)((wait + 999999) / 1000000);
+}
+
+
+size_t TimerWheel::size() const
+{
+    return timers.size();
+}
@@ -0,0 +1,87 @@
+/*
+
+file: timer_wheel.hpp
+created: 2026-10-17
+
+One-shot and periodic timers on CLOCK_MONOTONIC.
+
+A hashed timing wheel: time is cut into ticks and every timer is kept in the
+slot of the tick it expires at, modulo the number of slots. Adding and
+cancelling a timer takes constant time and advancing only looks at the
+slots of the ticks that passed. Timers more than one turn of the wheel away
+stay in their slot until the turn they expire in.
+
+Nothing runs on its own, advance calls the callbacks of expired timers on
+the calling thread. The event loop advances its wheel after every wait and
+never waits past the next expiry, so callbacks run on the main loop.
+
+*/
+
+
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <stdint.h>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+class TimerWheel
+{
+public:
+    using Callback = std::function<void()>;
+    using Id = uint64_t;    // 0 is never a timer
+
+    // tick: resolution, timers expire at the first tick at or after their time
+    // slots: ticks in one turn of the wheel
+    TimerWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(1), size_t slots = 256);
+
+    // call callback once, delay from now
+    Id after(std::chrono::milliseconds delay, Callback callback);
+
+    // call callback every period, the first time one period from now.
+    // periods missed because advance was late are only called back once.
+    Id every(std::chrono::milliseconds period, Callback callback);
+
+    // returns false if the timer already fired (one-shot) or was cancelled, callbacks may cancel any timer
+    bool cancel(Id id);
+
+    // call callbacks of the timers expired by now, in order of expiry, returns number called
+    int advance();
+    int advance(std::chrono::nanoseconds now);
+
+    // ms from now until the next timer expires, 0 if one already has, -1 if there are no timers
+    int next_timeout() const;
+    int next_timeout(std::chrono::nanoseconds now) const;
+
+    // number of timers waiting
+    size_t size() const;
+
+    // CLOCK_MONOTONIC time
+    static std::chrono::nanoseconds now();
+
+private:
+    struct Timer
+    {
+        uint64_t expiry;    // tick
+        uint64_t period;    // ticks, 0 for one-shot timers
+        std::shared_ptr<Callback> callback;  // shared so a callback can cancel its own timer
+    };
+
+    Id schedule(uint64_t expiry, uint64_t period, Callback callback);
+    void insert(Id id, uint64_t expiry);
+
+    uint64_t tick_ns;
+    uint64_t current;   // last tick advanced to, its slot and the ones before it are done
+    Id next_id;
+    std::unordered_map<Id, Timer> timers;
+
+    // ids of timers by expiry tick modulo slot count, cancelled ones are dropped when their slot comes up
+    std::vector<std::vector<Id>> slots;
+    std::vector<Id> due;    // expired timers while advancing, kept to not allocate every time
+};
+
+#endif // TIMER_WHEEL_HPP
@@ -0,0 +1,47 @@
+/*
+
+file: vec2.hpp
+created: 2026-10-17
+
+2D vector used for scan points.
+
+*/
+
+
+#ifndef VEC2_HPP
+#define VEC2_HPP
+
+#include <cmath>
+#include <ostream>
+
+
+struct Vec2
+{
+    float x, y;
+
+    Vec2() : x(0), y(0) {}
+    Vec2(float x, float y) : x(x), y(y) {}
+
+    Vec2 operator+(const Vec2& v) const { return Vec2(x + v.x, y + v.y); }
+    Vec2 operator-(const Vec2& v) const { return Vec2(x - v.x, y - v.y); }
+    Vec2 operator*(const Vec2& v) const { return Vec2(x * v.x, y * v.y); }
+    Vec2 operator/(const Vec2& v) const { return Vec2(x / v.x, y / v.y); }
+    Vec2 operator+(float s) const { return Vec2(x + s, y + s); }
+    Vec2 operator-(float s) const { return Vec2(x - s, y - s); }
+    Vec2 operator*(float s) const { return Vec2(x * s, y * s); }
+    Vec2 operator/(float s) const { return Vec2(x / s, y / s); }
+    Vec2 operator-() const { return Vec2(-x, -y); }
+
+    Vec2& operator+=(const Vec2& v) { x += v.x; y += v.y; return *this; }
+    Vec2& operator-=(const Vec2& v) { x -= v.x; y -= v.y; return *this; }
+
+    float dot(const Vec2& v) const { return x * v.x + y * v.y; }
+    float length() const { return std::sqrt(x * x + y * y); }
+};
+
+inline std::ostream& operator<<(std::ostream& os, const Vec2& v)
+{
+    return os << '(' << v.x << ", " << v.y << ')';
+}
+
+#endif // VEC2_HPP
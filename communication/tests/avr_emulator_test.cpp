@@ -0,0 +1,103 @@
+#include <assert.h>
+#include <unistd.h>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "../src/avr_emulator.hpp"
+#include "../src/identify.hpp"
+#include "../src/sensor.hpp"
+#include "../src/steering.hpp"
+
+
+static void sleep_ms(int ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+
+// call sensor update every ms for ms
+static void run_sensor(Sensor& sensor, int ms)
+{
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while(std::chrono::steady_clock::now() < until)
+    {
+        sensor.update();
+        sleep_ms(1);
+    }
+}
+
+
+int main()
+{
+    // the emulated modules are found like real ones
+    {
+        SensorEmulator sensor_module;
+        SteeringEmulator steering_module;
+        assert(!sensor_module.port().empty() && !steering_module.port().empty());
+        ModulePorts found;
+        bool identified = identify_modules({{sensor_module.port(), ""}, {steering_module.port(), ""}}, found,
+            std::chrono::milliseconds(2000), [](){ return true; }, [](const std::string&){});
+        assert(identified && found.sensor == sensor_module.port() && found.steering == steering_module.port());
+        assert(!sensor_module.identified() && !steering_module.identified());
+    }
+
+    // measurements and competition presses reach the sensor
+    {
+        SensorEmulator sensor_module;
+        sensor_module.set_generator([](unsigned long long number){ return EmulatedMeasurement{-20, (uint16_t)number, 300}; });
+        sensor_module.set_rate(200);
+        Sensor sensor(sensor_module.port());
+        int presses = 0;
+        sensor.on_competition([&presses](){ presses++; });
+
+        run_sensor(sensor, 300);
+        assert(sensor_module.identified());
+        unsigned long long count = sensor.measurement_count();
+        assert(count >= 30 && count <= 70);
+        SensorMeasurement measurement = sensor.measurement();
+        assert(measurement.rot == 700 && measurement.left == 300 && measurement.right == count - 1);
+        assert(measurement.time_ns >= sensor_module.sent_ns(count - 1));
+
+        sensor_module.press_competition();
+        run_sensor(sensor, 50);
+        assert(presses == 1);
+        assert(sensor_module.stats().dropped == 0 && sensor_module.stats().crc_errors == 0);
+    }
+
+    // drive frames reach the steering module
+    {
+        SteeringEmulator steering_module;
+        Steering steering(steering_module.port());
+        steering.command(SteeringCommand::ROTATE_LEFT);
+        assert(steering_module.wait_for_updates(1, 1000));
+        EmulatedSteering motors = steering_module.state();
+        assert(!motors.left_forward && motors.right_forward && motors.left_pwm > 100 && motors.left_pwm == motors.right_pwm);
+        assert(steering_module.identified());
+    }
+
+    // at saturation the line is the limit, 10 bits per byte and 10 bytes per measurement
+    {
+        SensorEmulator sensor_module(9600);
+        sensor_module.set_rate(SensorEmulator::SATURATE);
+        Sensor sensor(sensor_module.port());
+        run_sensor(sensor, 200);
+        unsigned long long before = sensor.measurement_count();
+        run_sensor(sensor, 500);
+        unsigned long long per_second = (sensor.measurement_count() - before) * 2;
+        assert(per_second >= 70 && per_second <= 110);
+    }
+
+    // a host that does not read loses measurements
+    {
+        SensorEmulator sensor_module(4000000);
+        sensor_module.set_rate(SensorEmulator::SATURATE);
+        Sensor sensor(sensor_module.port());
+        auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while(sensor_module.stats().dropped == 0 && std::chrono::steady_clock::now() < until) sleep_ms(10);
+        assert(sensor_module.stats().dropped > 0);
+    }
+
+    std::cout << "avr_emulator_test passed" << std::endl;
+    return 0;
+}
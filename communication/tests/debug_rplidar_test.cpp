@@ -48,8 +48,9 @@ int main (int argc, char* argv[]){
 
     while(true) {
         sock.check_activity();
-        vector<ScanNode> nodes = rplidar.get_scan();
-        if (nodes.size()) {
+        ScanFramePtr frame = rplidar.get_scan();
+        if (frame) {
+            const vector<ScanNode>& nodes = frame->nodes();
             vector<json> json_nodes;
             for (const ScanNode &node: nodes) {
                 json_nodes.push_back({
@@ -0,0 +1,86 @@
+#include <assert.h>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../src/event_loop.hpp"
+#include "../src/scan_buffer.hpp"
+
+
+int main()
+{
+    using namespace std::chrono;
+    EventLoop loop;
+
+    // nothing registered, waiting times out
+    assert(loop.run_once(0) == 0);
+
+    // readable fds are called back until read, then the loop waits again
+    int fds[2];
+    assert(pipe(fds) == 0);
+    int reads = 0;
+    assert(loop.add(fds[0], [&]() { char c; assert(read(fds[0], &c, 1) == 1); reads++; }));
+    assert(!loop.add(-1, []() {}));
+    assert(write(fds[1], "x", 1) == 1);
+    assert(loop.run_once(100) == 1 && reads == 1);
+    assert(loop.run_once(0) == 0);
+
+    // removed fds are not called back
+    loop.remove(fds[0]);
+    assert(write(fds[1], "y", 1) == 1);
+    assert(loop.run_once(0) == 0 && reads == 1);
+
+    // periodic timer, a slow loop gets one call for several missed periods
+    int ticks = 0;
+    TimerWheel::Id timer = loop.timers().every(milliseconds(10), [&]() { ticks++; });
+    assert(timer != 0);
+    auto start = steady_clock::now();
+    while(ticks < 5) loop.run_once(100);
+    assert(steady_clock::now() - start >= milliseconds(45));
+    std::this_thread::sleep_for(milliseconds(50));
+    assert(loop.run_once(0) == 1 && ticks == 6);
+    assert(loop.timers().cancel(timer));
+    std::this_thread::sleep_for(milliseconds(20));
+    assert(loop.run_once(0) == 0 && ticks == 6);
+
+    // another thread wakes a waiting loop
+    Notifier notifier;
+    int notified = 0;
+    loop.add(notifier.fd(), [&]() { notifier.clear(); notified++; });
+    std::thread waker([&]() { std::this_thread::sleep_for(milliseconds(20)); notifier.notify(); notifier.notify(); });
+    assert(loop.run_once(1000) == 1 && notified == 1);
+    waker.join();
+    assert(loop.run_once(0) == 0);
+    loop.remove(notifier.fd());
+
+    // a published scan wakes the loop until it is taken
+    ScanBuffer buffer(16);
+    int scans = 0;
+    loop.add(buffer.event_fd(), [&]() { if(buffer.take()) scans++; });
+    assert(loop.run_once(0) == 0);
+    ScanFrame* frame = buffer.acquire();
+    frame->build(std::vector<ScanNode>{{100, 0.0f, 47}});
+    buffer.publish(frame);
+    assert(loop.run_once(0) == 1 && scans == 1);
+    assert(loop.run_once(0) == 0);
+    loop.remove(buffer.event_fd());
+
+    // callbacks can stop the loop and remove themselves
+    int calls = 0;
+    loop.add(fds[0], [&]() { calls++; loop.remove(fds[0]); loop.stop(); });
+    loop.run();
+    assert(calls == 1);
+
+    // run also stops when told to by the caller
+    loop.timers().every(milliseconds(1), [&]() { calls++; });
+    loop.run([&]() { return calls < 4; });
+    assert(calls == 4);
+
+    close(fds[0]);
+    close(fds[1]);
+    std::cout << "event_loop_test passed" << std::endl;
+    return 0;
+}
@@ -1,5 +1,7 @@
 #include "../src/icp.hpp"
 #include <vector>
+#include <cassert>
+#include <cmath>
 #include "../src/vec2.hpp"
 
 using namespace std;
@@ -10,6 +12,59 @@ void add_to_points(vector<Vec2> &points, Vec2 delta) {
     }
 }
 
+// scan of a rectangular room with corners (-1000, -800) and (1200, 1500) taken from pose,
+// points in the robot frame
+vector<Vec2> room_scan(const Pose& pose) {
+    vector<Vec2> points;
+    for (int i = 0; i < 720; i++) {
+        // ray in the map frame
+        float a = (i * 0.5f + pose.rot) * M_PI / 180.0f;
+        float dx = cos(a), dy = sin(a);
+        float t = 1e9;
+        if (dx > 0) t = min(t, (1200 - pose.x) / dx);
+        if (dx < 0) t = min(t, (-1000 - pose.x) / dx);
+        if (dy > 0) t = min(t, (1500 - pose.y) / dy);
+        if (dy < 0) t = min(t, (-800 - pose.y) / dy);
+        float r = i * 0.5f * M_PI / 180.0f;
+        points.push_back(Vec2(t * cos(r), t * sin(r)));
+    }
+    return points;
+}
+
+void test_room(IcpMetric metric) {
+    IcpConfig config;
+    config.metric = metric;
+    config.max_iterations = 50;
+    ICP icp(config);
+
+    Pose motion{30, 50, 3};
+    vector<Vec2> reference = room_scan(Pose{0, 0, 0});
+    vector<Vec2> scan = room_scan(motion);
+    IcpResult result = icp.match(reference, scan);
+
+    assert(result.converged);
+    assert(abs(result.delta.x - motion.x) < 2);
+    assert(abs(result.delta.y - motion.y) < 2);
+    assert(abs(result.delta.rot - motion.rot) < 0.2);
+    assert(result.inlier_ratio > 0.9);
+    assert(result.covariance.trace() > 0);
+
+    // consecutive scans
+    icp.get_delta(reference);
+    result = icp.get_delta(scan);
+    assert(result.converged);
+    assert(abs(result.delta.y - motion.y) < 2);
+}
+
+void test_scan_points() {
+    // rplidar angles go clockwise from the front, front is +y and right is +x
+    vector<ScanNode> nodes = {{1000, 0, 10}, {0, 45, 0}, {500, 90, 10}};
+    vector<Vec2> points = ICP::to_points(nodes);
+    assert(points.size() == 2);
+    assert(abs(points[0].x) < 1e-3 && abs(points[0].y - 1000) < 1e-3);
+    assert(abs(points[1].x - 500) < 1e-3 && abs(points[1].y) < 1e-3);
+}
+
 int main () {
     ICP icp;
     vector<Vec2> points = {
@@ -20,4 +75,9 @@ int main () {
     //add_to_points(points, {1, 0});
     add_to_points(points, {0, 1}); // will match 2 leave 1
     icp.get_delta(points);
-}
\ No newline at end of file
+
+    test_scan_points();
+    test_room(IcpMetric::POINT_TO_POINT);
+    test_room(IcpMetric::POINT_TO_LINE);
+    return 0;
+}
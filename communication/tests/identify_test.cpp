@@ -0,0 +1,145 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../src/identify.hpp"
+#include "../src/module.hpp"
+#include "../src/serial_frame.hpp"
+
+
+// the host end of a pseudo terminal, the port is the other end
+struct Pty
+{
+    int master;
+    std::string port;
+
+    Pty()
+    {
+        master = posix_openpt(O_RDWR | O_NOCTTY);
+        assert(master >= 0 && grantpt(master) == 0 && unlockpt(master) == 0);
+        port = ptsname(master);
+    }
+    ~Pty() { close(master); }
+};
+
+
+// sends what a module sends until it is identified: its id frame every period, after a boot delay
+struct FakeModule
+{
+    std::atomic<bool> running;
+    std::thread thread;
+
+    FakeModule(int fd, int id, int boot_ms, bool garbage = false) : running(true)
+    {
+        thread = std::thread([this, fd, id, boot_ms, garbage]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(boot_ms));
+            uint8_t payload = id;
+            uint8_t bytes[FRAME_MAX];
+            size_t size = encode_frame((uint8_t)FrameType::MODULE_ID, &payload, 1, bytes);
+            if(garbage) for(size_t i = 0; i < size; i++) bytes[i] ^= 0x5A;
+            while(running.load())
+            {
+                if(write(fd, bytes, size) < 0) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+        });
+    }
+    ~FakeModule()
+    {
+        running.store(false);
+        thread.join();
+    }
+};
+
+
+int main()
+{
+    auto keep_going = [](){ return true; };
+
+    // both modules are found in one pass whatever order they boot in, the port left is the rplidar
+    {
+        Pty steering, sensor, rplidar;
+        FakeModule steering_module(steering.master, STEERING, 150);
+        FakeModule sensor_module(sensor.master, SENSOR, 0);
+        FakeModule rplidar_noise(rplidar.master, SENSOR, 0, true);
+
+        std::vector<std::string> rplidar_calls;
+        ModulePorts found;
+        auto start = std::chrono::steady_clock::now();
+        bool identified = identify_modules(
+            {{rplidar.port, ""}, {sensor.port, ""}, {steering.port, ""}}, found, std::chrono::milliseconds(2000), keep_going,
+            [&](const std::string& port){ rplidar_calls.push_back(port); }
+        );
+        auto took = std::chrono::steady_clock::now() - start;
+        assert(identified);
+        assert(found.sensor == sensor.port && found.steering == steering.port && found.rplidar == rplidar.port);
+        assert(rplidar_calls.size() == 1 && rplidar_calls[0] == rplidar.port);
+        assert(took < std::chrono::milliseconds(1000));
+    }
+
+    // an rplidar known by its name is handed over before the modules are found, and its port is not touched
+    {
+        Pty steering, sensor;
+        FakeModule steering_module(steering.master, STEERING, 100);
+        FakeModule sensor_module(sensor.master, SENSOR, 100);
+
+        ModulePorts found;
+        bool handed_over_first = false;
+        bool identified = identify_modules(
+            {{sensor.port, "usb-FTDI_FT232R_USB_UART_A1-if00-port0"}, {steering.port, ""}, {"/dev/nonexistent", "usb-Silicon_Labs_CP2102_USB_to_UART_Bridge_Controller_0001-if00-port0"}},
+            found, std::chrono::milliseconds(2000), keep_going,
+            [&](const std::string& port){ handed_over_first = port == "/dev/nonexistent" && found.sensor.empty() && found.steering.empty(); }
+        );
+        assert(identified && handed_over_first && found.rplidar == "/dev/nonexistent");
+    }
+
+    // a module that never answers gives up at the timeout
+    {
+        Pty steering, silent;
+        FakeModule steering_module(steering.master, STEERING, 0);
+
+        ModulePorts found;
+        bool called = false;
+        auto start = std::chrono::steady_clock::now();
+        bool identified = identify_modules(
+            {{steering.port, ""}, {silent.port, ""}}, found, std::chrono::milliseconds(300), keep_going,
+            [&](const std::string&){ called = true; }
+        );
+        auto took = std::chrono::steady_clock::now() - start;
+        assert(!identified && !called && found.steering == steering.port && found.sensor.empty());
+        assert(took >= std::chrono::milliseconds(300) && took < std::chrono::milliseconds(1000));
+
+        // and stops early when told to
+        start = std::chrono::steady_clock::now();
+        identified = identify_modules({{silent.port, ""}}, found, std::chrono::milliseconds(5000), [](){ return false; }, [](const std::string&){});
+        assert(!identified && std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100));
+    }
+
+    // ports are taken from the by-id links, or from the pattern if there are none
+    {
+        char dir_template[] = "/tmp/identify_test_XXXXXX";
+        std::string dir = mkdtemp(dir_template);
+        std::string by_id = dir + "/by-id";
+        assert(mkdir(by_id.c_str(), 0755) == 0);
+        for(const char* name : {"ttyUSB1", "ttyUSB0"}) close(open((dir + "/" + name).c_str(), O_CREAT | O_WRONLY, 0644));
+
+        std::vector<SerialPort> ports = serial_ports(by_id, dir + "/ttyUSB*");
+        assert(ports.size() == 2 && ports[0].file == dir + "/ttyUSB0" && ports[0].id.empty());
+
+        assert(symlink("../ttyUSB1", (by_id + "/usb-Silicon_Labs_CP2102-if00-port0").c_str()) == 0);
+        ports = serial_ports(by_id, dir + "/ttyUSB*");
+        assert(ports.size() == 1 && ports[0].file == dir + "/ttyUSB1" && is_rplidar_port(ports[0]));
+
+        system(("rm -rf " + dir).c_str());
+    }
+
+    std::cout << "identify_test passed" << std::endl;
+    return 0;
+}
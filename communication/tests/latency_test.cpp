@@ -0,0 +1,79 @@
+#include <assert.h>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "../src/latency.hpp"
+
+
+static bool near(double a, double b, double tolerance)
+{
+    return std::fabs(a - b) <= tolerance;
+}
+
+
+int main()
+{
+    // nothing recorded
+    LatencyHistogram empty;
+    assert(empty.count() == 0 && empty.percentile(0.5) == 0 && empty.max() == 0 && empty.mean() == 0);
+    assert(empty.buckets().empty());
+
+    // 1..100 ms, percentiles within a bucket (1/8 of the power of two) of the true value, max exact
+    LatencyHistogram histogram;
+    for(int ms = 1; ms <= 100; ms++) histogram.record((int64_t)ms * 1000000);
+    assert(histogram.count() == 100);
+    assert(near(histogram.percentile(0.5), 50, 50 / 8.0));
+    assert(near(histogram.percentile(0.99), 99, 99 / 8.0));
+    assert(histogram.percentile(1.0) <= 100);
+    assert(histogram.max() == 100);
+    assert(near(histogram.mean(), 50.5, 1e-9));
+
+    // small latencies get a bucket per us, negative ones count as 0
+    LatencyHistogram small;
+    small.record(3000);
+    small.record(-5);
+    auto buckets = small.buckets();
+    assert(buckets.size() == 2 && buckets[0].first == 0 && buckets[1].first == 3);
+    assert(small.max() == 0.003);
+
+    // every path records the age of its stamps, unknown stamps are skipped
+    LatencyTracer tracer;
+    LatencyTrace trace;
+    trace.sensor_ns = 1000000000;
+    trace.decision_ns = trace.sensor_ns + 2000000;
+    tracer.decided(trace);
+    tracer.written(trace, trace.decision_ns + 1000000);
+    assert(tracer.histogram(LatencyPath::SENSOR_TO_DECISION).count() == 1);
+    assert(tracer.histogram(LatencyPath::SENSOR_TO_DECISION).max() == 2);
+    assert(tracer.histogram(LatencyPath::DECISION_TO_WRITE).max() == 1);
+    assert(tracer.histogram(LatencyPath::SENSOR_TO_WRITE).max() == 3);
+    assert(tracer.histogram(LatencyPath::SCAN_TO_DECISION).count() == 0);
+    assert(tracer.histogram(LatencyPath::SCAN_TO_WRITE).count() == 0);
+
+    trace.scan_ns = trace.decision_ns - 40000000;
+    tracer.decided(trace);
+    assert(tracer.histogram(LatencyPath::SCAN_TO_DECISION).max() == 40);
+    assert(tracer.histogram(LatencyPath::SENSOR_TO_DECISION).count() == 2);
+
+    // the stamps are monotonic
+    int64_t before = monotonic_ns();
+    assert(monotonic_ns() >= before && before > 0);
+
+    // a dump has a line per path
+    const std::string file = "/tmp/latency_test.txt";
+    assert(tracer.dump(file));
+    std::ifstream in(file);
+    std::stringstream text;
+    text << in.rdbuf();
+    for(int i = 0; i < (int)LatencyPath::COUNT; i++)
+    {
+        assert(text.str().find(LatencyTracer::name((LatencyPath)i)) != std::string::npos);
+    }
+    assert(text.str().find("scan_to_decision count 1") != std::string::npos);
+    assert(!tracer.dump("/nonexistent/latency.txt"));
+
+    std::cout << "latency_test passed" << std::endl;
+    return 0;
+}
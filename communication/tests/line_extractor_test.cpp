@@ -0,0 +1,101 @@
+#include <assert.h>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../src/line_extractor.hpp"
+#include "../src/pose.hpp"
+
+
+// scan of a room with corners (-1000, -800) and (1600, 1400) and a pillar, taken from pose
+std::vector<ScanNode> room_scan(const Pose& pose, std::mt19937& random)
+{
+    std::normal_distribution<float> noise(0.0f, 5.0f);
+    std::vector<ScanNode> nodes;
+    for(int i = 0; i < 720; i++)
+    {
+        // rplidar angles go clockwise from the front
+        float angle = i * 0.5f;
+        float a = (90.0f - angle + pose.rot) * M_PI / 180.0f;
+        float dx = std::cos(a), dy = std::sin(a);
+        float t = 1e9;
+        if(dx > 0) t = std::min(t, (1600 - pose.x) / dx);
+        if(dx < 0) t = std::min(t, (-1000 - pose.x) / dx);
+        if(dy > 0) t = std::min(t, (1400 - pose.y) / dy);
+        if(dy < 0) t = std::min(t, (-800 - pose.y) / dy);
+
+        // pillar, a square from (600, 400) to (800, 600)
+        for(float s = 0; s < t; s += 1)
+        {
+            float x = pose.x + s * dx, y = pose.y + s * dy;
+            if(x > 600 && x < 800 && y > 400 && y < 600)
+            {
+                t = s;
+                break;
+            }
+        }
+        nodes.push_back({(uint32_t)std::max(0.0f, t + noise(random)), angle, 47});
+    }
+    return nodes;
+}
+
+
+int main()
+{
+    std::mt19937 random(3);
+    LineExtractor extractor;
+
+    // straight in the room, the four walls and the two pillar faces seen from the start
+    const std::vector<LineSegment>& segments = extractor.extract(room_scan(Pose{0, 0, 0}, random));
+    for(const LineSegment& s : segments)
+    {
+        std::cout << "(" << s.start.x << ", " << s.start.y << ") - (" << s.end.x << ", " << s.end.y << ") alpha "
+                  << s.alpha * 180 / M_PI << " distance " << s.distance << " points " << s.points << " rms " << s.rms << std::endl;
+    }
+    assert(segments.size() == 6);
+
+    // every wall is found once, at the right distance and very sure of it
+    float walls[4][2] = {{0, 1600}, {90, 1400}, {180, 1000}, {-90, 800}};
+    for(auto& wall : walls)
+    {
+        int found = 0;
+        for(const LineSegment& s : segments)
+        {
+            float angle = std::remainder(s.alpha * 180 / (float)M_PI - wall[0], 360.0f);
+            if(std::abs(angle) > 1.0f || std::abs(s.distance - wall[1]) > 10.0f) continue;
+            found++;
+            assert(s.rms < 10.0f);
+            assert(s.covariance(0, 0) > 0 && std::sqrt(s.covariance(0, 0)) * 180 / M_PI < 0.5f);
+            assert(s.covariance(1, 1) > 0 && std::sqrt(s.covariance(1, 1)) < 5.0f);
+        }
+        assert(found == 1);
+    }
+
+    // the wall behind the robot is one segment from corner to corner even though the scan starts there
+    for(const LineSegment& s : segments)
+    {
+        if(std::abs(std::remainder(s.alpha * 180 / (float)M_PI + 90, 360.0f)) > 1.0f) continue;
+        assert(std::abs(std::min(s.start.x, s.end.x) + 1000) < 30);
+        assert(std::abs(std::max(s.start.x, s.end.x) - 1600) < 30);
+    }
+
+    // wall rotation is the robot rotation, reversed and folded to a quarter turn
+    float rotation;
+    assert(LineExtractor::axis_rotation(segments, 1000, rotation));
+    assert(std::abs(rotation) < 0.5f);
+    for(float rot : {20.0f, -30.0f, 100.0f})
+    {
+        assert(LineExtractor::axis_rotation(extractor.extract(room_scan(Pose{200, -100, rot}, random)), 1000, rotation));
+        float expected = std::remainder(-rot, 90.0f);
+        std::cout << "robot " << rot << " walls " << rotation << std::endl;
+        assert(std::abs(rotation - expected) < 0.5f);
+    }
+
+    // no segments, no rotation
+    assert(extractor.extract({}).empty());
+    assert(!LineExtractor::axis_rotation({}, 1000, rotation));
+
+    std::cout << "line_extractor_test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include <assert.h>
+#include <stdio.h>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "../src/localizer.hpp"
+#include "../src/map.hpp"
+#include "../src/raycast.hpp"
+
+
+// scan of a room with corners (-1000, -800) and (1600, 1400) and maybe a pillar, taken from pose
+std::vector<ScanNode> room_scan(const Pose& pose, bool pillar = true)
+{
+    std::vector<ScanNode> nodes;
+    for(int i = 0; i < 720; i++)
+    {
+        // rplidar angles go clockwise from the front
+        float angle = i * 0.5f;
+        float a = (90.0f - angle + pose.rot) * M_PI / 180.0f;
+        float dx = std::cos(a), dy = std::sin(a);
+        float t = 1e9;
+        if(dx > 0) t = std::min(t, (1600 - pose.x) / dx);
+        if(dx < 0) t = std::min(t, (-1000 - pose.x) / dx);
+        if(dy > 0) t = std::min(t, (1400 - pose.y) / dy);
+        if(dy < 0) t = std::min(t, (-800 - pose.y) / dy);
+
+        // pillar, a square from (600, 400) to (800, 600)
+        for(float s = 0; pillar && s < t; s += 5)
+        {
+            float x = pose.x + s * dx, y = pose.y + s * dy;
+            if(x > 600 && x < 800 && y > 400 && y < 600)
+            {
+                t = s;
+                break;
+            }
+        }
+        nodes.push_back({(uint32_t)t, angle, 47});
+    }
+    return nodes;
+}
+
+
+// map the room from a few places
+static void map_room(Map& map, bool pillar)
+{
+    RayCaster caster(map.cell_size());
+    std::vector<Pose> poses = {{0, 0, 0}, {1000, 1000, 30}, {-500, 900, -90}, {1200, -400, 180}};
+    for(const Pose& pose : poses)
+    {
+        for(int i = 0; i < 3; i++)
+        {
+            caster.cast(room_scan(pose, pillar), pose,
+                [&map](int col, int row){ map.update(col, row, Tile::EMPTY); },
+                [&map](int col, int row){ map.update(col, row, Tile::WALL); }
+            );
+        }
+    }
+}
+
+
+int main()
+{
+    // map the room and save it
+    std::string file = "/tmp/localizer_test.map";
+    {
+        Map map(50);
+        map_room(map, true);
+        assert(map.save(file));
+    }
+
+    // a map with other cells does not load, the right one loads cell for cell
+    Map wrong(100);
+    assert(!wrong.load(file));
+    Map map(50);
+    assert(map.load(file));
+    assert(map.get(0, 0) == Tile::EMPTY);
+    assert(map.get(32, 0) == Tile::WALL);
+    int min_col, min_row, max_col, max_row;
+    assert(map.extent(min_col, min_row, max_col, max_row));
+    assert(min_col <= -20 && max_col >= 32 && min_row <= -16 && max_row >= 28);
+    remove(file.c_str());
+
+    ThreadPool pool;
+    LocalizerConfig config;
+    config.max_particles = 30000;
+    Pose truth{300, 700, 75};
+
+    // without the pillar every pose in the room has a twin half a turn around its middle. One scan
+    // singles out a few particles, which is not taken for convergence
+    {
+        Map symmetric(50);
+        map_room(symmetric, false);
+        Localizer localizer(symmetric, pool, config);
+        localizer.init_global();
+        localizer.predict(Pose{0, 0, 0});
+        localizer.update(room_scan(truth, false));
+        std::cout << "symmetric room after one update: " << localizer.spread() << " mm, " << localizer.rotation_spread()
+                  << " deg, effective share " << localizer.effective_share() << std::endl;
+        assert(!localizer.converged());
+        assert(localizer.effective_share() < config.converged_effective);
+    }
+
+    // find a standing robot from scratch
+    Localizer localizer(map, pool, config);
+    localizer.init_global();
+    assert(localizer.particle_count() == (size_t)config.max_particles);
+    assert(!localizer.converged());
+
+    std::vector<ScanNode> scan = room_scan(truth);
+    int updates = 0;
+    while(!localizer.converged() && updates < 50)
+    {
+        localizer.predict(Pose{0, 0, 0});
+        localizer.update(scan);
+        updates++;
+    }
+    Pose estimate = localizer.estimate();
+    std::cout << "converged after " << updates << " updates at " << estimate.x << ", " << estimate.y << ", " << estimate.rot
+              << " with " << localizer.particle_count() << " particles, effective share " << localizer.effective_share() << std::endl;
+    assert(localizer.converged() && updates >= config.converged_updates);
+    assert(std::abs(estimate.x - truth.x) < 100);
+    assert(std::abs(estimate.y - truth.y) < 100);
+    assert(std::abs(estimate.rot - truth.rot) < 5);
+
+    // converged particles are few
+    assert(localizer.particle_count() < (size_t)config.max_particles / 10);
+
+    // and follow the robot when it moves
+    Pose moved = truth * Pose{0, 200, 10};
+    localizer.predict(Pose{0, 200, 10});
+    localizer.update(room_scan(moved));
+    localizer.update(room_scan(moved));
+    estimate = localizer.estimate();
+    assert(std::abs(estimate.x - moved.x) < 100);
+    assert(std::abs(estimate.y - moved.y) < 100);
+
+    std::cout << "localizer_test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <assert.h>
+#include <iostream>
+
+#include "../src/map.hpp"
+
+
+int main(int argc, char* argv[])
+{
+    Map map(50);
+    assert(map.cell_size() == 50);
+
+    // nothing is allocated until something is observed
+    assert(map.chunk_count() == 0);
+    assert(map.get(0, 0) == Tile::UNKNOWN);
+    assert(map.get(-100000, 100000) == Tile::UNKNOWN);
+    map.set(7, 7, Tile::UNKNOWN);
+    assert(map.chunk_count() == 0);
+
+    // cells far outside the old 10x10m area, and on both sides of chunk borders
+    for(int i = 0; i < 10; i++) map.update(-1, -1, Tile::WALL);
+    for(int i = 0; i < 10; i++) map.update(0, 0, Tile::EMPTY);
+    for(int i = 0; i < 10; i++) map.update(5000, -5000, Tile::WALL);
+    assert(map.get(-1, -1) == Tile::WALL);
+    assert(map.get(0, 0) == Tile::EMPTY);
+    assert(map.get(5000, -5000) == Tile::WALL);
+    assert(map.get(5001, -5000) == Tile::UNKNOWN);
+    assert(map.chunk_count() == 3);
+
+    // log-odds saturate, and a wall flips back to empty once it is seen through enough times
+    OccupancyConfig config;
+    assert(map.log_odds(-1, -1) == config.max);
+    for(int i = 0; i < 100; i++) map.update(-1, -1, Tile::EMPTY);
+    assert(map.get(-1, -1) == Tile::EMPTY);
+    assert(map.log_odds(-1, -1) == config.min);
+
+    // only chunks with cells that changed Tile are reported, and only once
+    uint64_t latest;
+    assert(map.changed_chunks(0, latest).size() == 3);
+    assert(latest == map.version());
+    assert(map.changed_chunks(latest, latest).empty());
+    map.update(40, 40, Tile::EMPTY);    // not enough to change Tile
+    assert(map.changed_chunks(latest, latest).empty());
+    for(int i = 0; i < 10; i++) map.update(-40, 40, Tile::WALL);
+    auto changed = map.changed_chunks(latest, latest);
+    assert(changed.size() == 1);
+    assert(changed.front() == std::make_pair(-64, 32));
+
+    // reading a rectangle across chunks gives the same as reading cell by cell
+    int8_t region[70 * 3];
+    map.read(-50, 39, 70, 3, region);
+    for(int r = 0; r < 3; r++)
+    {
+        for(int c = 0; c < 70; c++) assert(region[r * 70 + c] == map.log_odds(-50 + c, 39 + r));
+    }
+    assert(region[(40 - 39) * 70 + (-40 + 50)] == map.log_odds(-40, 40) && map.log_odds(-40, 40) > 0);
+
+    // assigning another map copies its cells, forgets the rest and reports only real changes
+    Map other(50);
+    for(int i = 0; i < 10; i++) other.update(-40, 40, Tile::WALL);
+    for(int i = 0; i < 10; i++) other.update(100, 100, Tile::WALL);
+    map.changed_chunks(0, latest);
+    map.assign(other);
+    assert(map.log_odds(-40, 40) == other.log_odds(-40, 40));
+    assert(map.get(100, 100) == Tile::WALL);
+    assert(map.get(0, 0) == Tile::UNKNOWN);
+    assert(map.get(5000, -5000) == Tile::UNKNOWN);
+    changed = map.changed_chunks(latest, latest);
+    assert(changed.size() == 4);    // chunks of (-1, -1), (0, 0) and (5000, -5000) forgotten, (100, 100) new
+
+    // updating through a cursor gives the same cells as looking every chunk up, across chunk borders too
+    Map looked_up(50), cursored(50);
+    Map::Cursor cursor;
+    for(int i = -100; i < 100; i++)
+    {
+        Tile tile = i % 7 == 0 ? Tile::WALL : Tile::EMPTY;
+        looked_up.update(i, i / 3, tile);
+        cursored.update(i, i / 3, tile, cursor);
+    }
+    Map::Cursor fresh;
+    cursored.update(0, 0, Tile::WALL, fresh);
+    looked_up.update(0, 0, Tile::WALL);
+    Map::Cursor other_fresh;
+    cursored.update(-1, -1, Tile::WALL, other_fresh);
+    looked_up.update(-1, -1, Tile::WALL);
+    assert(cursored.log_odds(0, 0) == looked_up.log_odds(0, 0) && cursored.log_odds(-1, -1) == looked_up.log_odds(-1, -1));
+    assert(cursored.chunk_count() == looked_up.chunk_count());
+    for(int i = -100; i < 100; i++) assert(cursored.log_odds(i, i / 3) == looked_up.log_odds(i, i / 3));
+
+    std::cout << "map_chunk_test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include <assert.h>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "../src/map_worker.hpp"
+
+
+// ms taken by f
+template<typename F>
+static double time_ms(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+// every cell of a and b is the same
+static bool same(const Map& a, const Map& b)
+{
+    int min_col, min_row, max_col, max_row;
+    if(a.chunk_count() != b.chunk_count() || !a.extent(min_col, min_row, max_col, max_row)) return false;
+    int cols = max_col - min_col + 1, rows = max_row - min_row + 1;
+    std::vector<int8_t> cells_a((size_t)cols * rows), cells_b((size_t)cols * rows);
+    a.read(min_col, min_row, cols, rows, cells_a.data());
+    b.read(min_col, min_row, cols, rows, cells_b.data());
+    return cells_a == cells_b;
+}
+
+
+int main()
+{
+    // keyframes along a winding path, the rays of neighbouring keyframes cross the same cells
+    std::vector<Keyframe> keyframes;
+    for(int k = 0; k < 200; k++)
+    {
+        Keyframe keyframe;
+        keyframe.pose = Pose{k * 20.0f, 500.0f * std::sin(k * 0.05f), k * 2.0f};
+        for(int i = 0; i < 720; i++)
+        {
+            ScanNode node;
+            node.angle = i * 0.5f;
+            node.dist = i % 50 == 0 ? 0 : 1500 + (i * 37 + k * 11) % 1500;
+            node.quality = 47;
+            keyframe.nodes.push_back(node);
+        }
+        keyframes.push_back(keyframe);
+    }
+
+    // drawing over threads gives the same map as drawing one keyframe after the other
+    Map serial(50), parallel(50);
+    ThreadPool pool(8);
+    double serial_ms = time_ms([&](){ draw_keyframes(serial, keyframes, nullptr); });
+    double parallel_ms = time_ms([&](){ draw_keyframes(parallel, keyframes, &pool); });
+    assert(same(serial, parallel));
+
+    // the rays are split over the threads, casting them all on every thread would take pool size times as long on one core
+    std::cout << "redraw of " << keyframes.size() << " keyframes: serial " << serial_ms << " ms, "
+              << pool.size() << " threads " << parallel_ms << " ms (" << serial_ms / parallel_ms << "x on "
+              << std::thread::hardware_concurrency() << " cores)" << std::endl;
+    assert(parallel_ms < serial_ms * pool.size() / 2);
+
+    std::cout << "map_worker_test passed" << std::endl;
+    return 0;
+}
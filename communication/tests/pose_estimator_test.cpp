@@ -0,0 +1,101 @@
+#include <assert.h>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include "../src/pose_estimator.hpp"
+
+
+using namespace std::chrono;
+
+
+int main()
+{
+    PoseEstimatorConfig config;
+    steady_clock::time_point t0 = steady_clock::now();
+    SteeringControl forward{0.2f, 0.2f, true, true};
+    SteeringControl left{0.2f, 0.2f, false, true};
+    SteeringControl halt{0.0f, 0.0f, true, true};
+
+    // commands alone move the robot forward along y, growing more uncertain
+    {
+        PoseEstimator estimator(config);
+        estimator.reset(Pose{0, 0, 0}, t0);
+        for(int i = 1; i <= 10; i++) estimator.predict(forward, t0 + milliseconds(100 * i));
+        const PoseEstimate& estimate = estimator.estimate();
+        float speed = config.full_speed * (0.2f * 155 + 100) / 255;
+        assert(std::abs(estimate.pose.x) < 1e-3f);
+        assert(std::abs(estimate.pose.y - speed) < 1.0f);
+        assert(std::abs(estimate.pose.rot) < 1e-3f);
+        assert(estimate.covariance(1, 1) > 100.0f);
+        assert(estimate.time == t0 + milliseconds(1000));
+    }
+
+    // turning left with the gyro, the estimate follows the gyro
+    {
+        PoseEstimator estimator(config);
+        estimator.reset(Pose{0, 0, 0}, t0);
+        for(int i = 1; i <= 20; i++)
+        {
+            estimator.predict(left, t0 + milliseconds(50 * i));
+            estimator.update_rotation(4.5f * i);
+        }
+        const PoseEstimate& estimate = estimator.estimate();
+        assert(std::abs(estimate.pose.rot - 90.0f) < 1.0f);
+        assert(std::hypot(estimate.pose.x, estimate.pose.y) < 10.0f);
+
+        // rotation is not wrapped, it keeps following the gyro past 180
+        for(int i = 21; i <= 60; i++)
+        {
+            estimator.predict(left, t0 + milliseconds(50 * i));
+            estimator.update_rotation(4.5f * i);
+        }
+        assert(std::abs(estimator.estimate().pose.rot - 270.0f) < 1.0f);
+    }
+
+    // scan matching corrects bad commands, the robot is not moving as fast as told
+    {
+        PoseEstimator estimator(config);
+        estimator.reset(Pose{400, 800, 90}, t0);
+        Pose truth{400, 800, 90};
+        for(int i = 1; i <= 50; i++)
+        {
+            Pose delta{0.5f, 10.0f, 0.1f};
+            truth = truth * delta;
+            estimator.predict(forward, t0 + milliseconds(100 * i));
+            estimator.update_rotation(truth.rot);
+            estimator.update_odometry(delta, Eigen::Vector3f(4.0f, 4.0f, 1e-5f).asDiagonal());
+        }
+        const PoseEstimate& estimate = estimator.estimate();
+        std::cout << "truth " << truth.x << ", " << truth.y << ", " << truth.rot
+                  << " estimate " << estimate.pose.x << ", " << estimate.pose.y << ", " << estimate.pose.rot << std::endl;
+        assert(std::abs(estimate.pose.x - truth.x) < 15.0f);
+        assert(std::abs(estimate.pose.y - truth.y) < 15.0f);
+        assert(std::abs(estimate.pose.rot - truth.rot) < 1.0f);
+
+        // and keep the estimate far more certain than the commands alone
+        PoseEstimator commands(config);
+        commands.reset(Pose{400, 800, 90}, t0);
+        for(int i = 1; i <= 50; i++) commands.predict(forward, t0 + milliseconds(100 * i));
+        assert(estimate.covariance(0, 0) < commands.estimate().covariance(0, 0) / 10);
+    }
+
+    // a position measurement pulls the estimate, standing still does not drift
+    {
+        PoseEstimator estimator(config);
+        estimator.reset(Pose{0, 0, 0}, t0, 200.0f, 5.0f);
+        estimator.update_position(390, -20, 10);
+        assert(std::abs(estimator.estimate().pose.x - 390) < 5.0f);
+        assert(std::abs(estimator.estimate().pose.y + 20) < 5.0f);
+        for(int i = 1; i <= 100; i++) estimator.predict(halt, t0 + milliseconds(100 * i));
+        assert(std::abs(estimator.estimate().pose.x - 390) < 5.0f);
+
+        // long gaps are not extrapolated
+        estimator.reset(Pose{0, 0, 0}, t0);
+        estimator.predict(forward, t0 + seconds(60));
+        assert(estimator.estimate().pose.y < config.full_speed * config.max_dt + 1);
+    }
+
+    std::cout << "pose_estimator_test passed" << std::endl;
+    return 0;
+}
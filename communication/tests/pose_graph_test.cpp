@@ -0,0 +1,73 @@
+#include <assert.h>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "../src/pose_graph.hpp"
+
+
+int main()
+{
+    // drive around a 2 x 2 m square in 100 mm steps, turning left at the corners
+    std::vector<Pose> truth;
+    std::vector<Pose> motions;
+    Pose pose{0, 0, 0};
+    for(int side = 0; side < 4; side++)
+    {
+        for(int step = 0; step < 20; step++)
+        {
+            truth.push_back(pose);
+            Pose motion{0, 100, step == 19 ? 90.0f : 0.0f};
+            motions.push_back(motion);
+            pose = pose * motion;
+        }
+    }
+
+    // odometry turns a little too far every step and overshoots, the loop does not close
+    Eigen::Matrix3d odometry_information = Eigen::Vector3d(1.0 / 100, 1.0 / 100, 1.0 / std::pow(0.5 * M_PI / 180, 2)).asDiagonal();
+    PoseGraph graph;
+    Pose odometry{0, 0, 0};
+    graph.add_node(odometry);
+    for(size_t i = 1; i < truth.size(); i++)
+    {
+        Pose measured{motions[i - 1].x, motions[i - 1].y * 1.02f, motions[i - 1].rot + 0.3f};
+        odometry = odometry * measured;
+        graph.add_node(odometry);
+        graph.add_edge(i - 1, i, measured, odometry_information);
+    }
+    assert(graph.node_count() == truth.size());
+    assert(graph.edge_count() == truth.size() - 1);
+
+    // without a loop closure there is nothing to fix, the chain already agrees with itself
+    assert(graph.error() < 1e-3);
+    graph.optimize();
+    const Pose& last = graph.pose(truth.size() - 1);
+    float drift = std::hypot(last.x - truth.back().x, last.y - truth.back().y);
+    assert(drift > 100);
+
+    // back at the start, the last pose is seen exactly where it really is relative to the first
+    Eigen::Matrix3d loop_information = Eigen::Vector3d(1, 1, 1.0 / std::pow(0.1 * M_PI / 180, 2)).asDiagonal();
+    graph.add_edge(0, truth.size() - 1, truth.back(), loop_information);
+    double before = graph.error();
+    double after = graph.optimize();
+    std::cout << "error " << before << " -> " << after << std::endl;
+    assert(after < before / 100);
+
+    // the error is spread over the loop, every pose ends up much closer to the truth
+    float worst = 0;
+    for(size_t i = 0; i < truth.size(); i++)
+    {
+        const Pose& p = graph.pose(i);
+        worst = std::max(worst, std::hypot(p.x - truth[i].x, p.y - truth[i].y));
+    }
+    std::cout << "drift " << drift << " mm, worst after closing the loop " << worst << " mm" << std::endl;
+    assert(worst < drift / 3);
+    const Pose& closed = graph.pose(truth.size() - 1);
+    assert(std::hypot(closed.x - truth.back().x, closed.y - truth.back().y) < 10);
+
+    // the first pose does not move
+    assert(graph.pose(0).x == 0 && graph.pose(0).y == 0 && graph.pose(0).rot == 0);
+
+    std::cout << "pose_graph_test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <assert.h>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "../src/raycast.hpp"
+
+
+using Cell = std::pair<int, int>;
+
+
+// trace a segment and check that visited cells are unique, 4-connected and end in the right cell
+static void check_segment(float x0, float y0, float x1, float y1)
+{
+    std::vector<Cell> cells;
+    int end_col, end_row;
+    RayCaster::trace(x0, y0, x1, y1, [&cells](int col, int row){ cells.push_back({col, row}); }, end_col, end_row);
+    cells.push_back({end_col, end_row});
+
+    assert(cells.front() == Cell((int)std::floor(x0), (int)std::floor(y0)));
+    assert(cells.back() == Cell((int)std::floor(x1), (int)std::floor(y1)));
+
+    std::set<Cell> unique(cells.begin(), cells.end());
+    assert(unique.size() == cells.size());
+
+    for(size_t i = 1; i < cells.size(); i++)
+    {
+        int d = std::abs(cells[i].first - cells[i-1].first) + std::abs(cells[i].second - cells[i-1].second);
+        assert(d == 1);
+    }
+
+    // every cell the segment passes through (sampled densely) must be visited
+    for(int i = 0; i <= 10000; i++)
+    {
+        float t = i / 10000.0f;
+        Cell c((int)std::floor(x0 + t*(x1 - x0)), (int)std::floor(y0 + t*(y1 - y0)));
+        if(!unique.count(c))
+        {
+            // sampling can land exactly on a corner the traversal went around
+            float fx = x0 + t*(x1 - x0), fy = y0 + t*(y1 - y0);
+            assert(std::abs(fx - std::round(fx)) < 1e-3f || std::abs(fy - std::round(fy)) < 1e-3f);
+        }
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    // axis aligned, diagonal and arbitrary segments in all directions
+    check_segment(0.5f, 0.5f, 10.5f, 0.5f);
+    check_segment(0.5f, 0.5f, 0.5f, -7.2f);
+    check_segment(0.5f, 0.5f, 0.5f, 0.5f);
+    check_segment(0.3f, 0.7f, -12.9f, 5.1f);
+    check_segment(-3.25f, 2.5f, 17.75f, -9.125f);
+
+    srand(1);
+    for(int i = 0; i < 1000; i++)
+    {
+        float x0 = (rand() % 2000 - 1000) / 37.0f, y0 = (rand() % 2000 - 1000) / 37.0f;
+        float x1 = (rand() % 2000 - 1000) / 37.0f, y1 = (rand() % 2000 - 1000) / 37.0f;
+        check_segment(x0, y0, x1, y1);
+    }
+
+    // a 0.9 m ray straight forward from the starting position with 400 mm tiles
+    RayCaster caster(400);
+    std::vector<ScanNode> nodes = {{900, 0.0f, 47}, {0, 90.0f, 0}};
+    std::vector<Cell> empty, hit;
+    caster.cast(nodes, Pose{0, 0, 0},
+        [&empty](int col, int row){ empty.push_back({col, row}); },
+        [&hit](int col, int row){ hit.push_back({col, row}); }
+    );
+    assert(hit.size() == 1);
+    assert(empty.size() == 2);
+    assert(empty.front() == Cell(0, 0));
+    assert(hit.front() == Cell(0, 2));
+
+    std::cout << "raycast_test passed" << std::endl;
+    return 0;
+}
@@ -17,10 +17,10 @@ int main (int argc, char* argv[]){
     RPLidar rp(usb_name);
     rp.start_scanning();
     while (true) {
-        vector<ScanNode> nodes = rp.get_scan();
-        if (nodes.size()) {
-            cout << "Nodes retrieved: " << nodes.size() << endl;
-            for (const ScanNode &node: nodes) {
+        ScanFramePtr frame = rp.get_scan();
+        if (frame) {
+            cout << "Nodes retrieved: " << frame->nodes().size() << endl;
+            for (const ScanNode &node: frame->nodes()) {
                 node.print();
             }
         }
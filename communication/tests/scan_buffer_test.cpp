@@ -0,0 +1,71 @@
+#include <assert.h>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../src/scan_buffer.hpp"
+
+
+int main(int argc, char* argv[])
+{
+    ScanBuffer buffer(16);
+
+    // nothing published yet
+    assert(!buffer.take());
+
+    // newest published frame wins, the replaced one counts as dropped
+    for(uint32_t dist = 1; dist <= 2; dist++)
+    {
+        ScanFrame* frame = buffer.acquire();
+        assert(frame);
+        frame->build(std::vector<ScanNode>{{dist, 0.0f, 47}});
+        buffer.publish(frame);
+    }
+    ScanFramePtr taken = buffer.take();
+    assert(taken && taken->distance_at(0.0f) == 2.0f);
+    assert(!buffer.take());
+    assert(buffer.dropped() == 1);
+
+    // held frames are never reused, so all but one can be acquired
+    std::vector<ScanFramePtr> held;
+    for(int i = 0; i < ScanBuffer::FRAMES - 1; i++)
+    {
+        ScanFrame* frame = buffer.acquire();
+        assert(frame);
+        buffer.publish(frame);
+        held.push_back(buffer.take());
+    }
+    assert(!buffer.acquire());
+    held.clear();
+    taken = ScanFramePtr();
+
+    // producer thread publishing while a reader takes and checks frames are never torn
+    std::atomic<bool> done(false);
+    std::thread producer([&buffer, &done]()
+    {
+        for(uint32_t i = 1; i <= 100000; i++)
+        {
+            ScanFrame* frame = buffer.acquire();
+            if(!frame) continue;
+            frame->build(std::vector<ScanNode>{{i, 0.0f, 47}, {i, 180.0f, 47}});
+            buffer.publish(frame);
+        }
+        done.store(true);
+    });
+    uint32_t last = 0;
+    while(!done.load())
+    {
+        ScanFramePtr frame = buffer.take();
+        if(!frame) continue;
+        ScanFramePtr copy = frame;
+        uint32_t dist = copy->nodes()[0].dist;
+        assert(dist == copy->nodes()[1].dist);
+        assert(dist > last);
+        last = dist;
+    }
+    producer.join();
+
+    std::cout << "scan_buffer_test passed" << std::endl;
+    return 0;
+}
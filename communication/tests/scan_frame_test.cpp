@@ -0,0 +1,52 @@
+#include <assert.h>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "../src/scan_frame.hpp"
+
+
+int main(int argc, char* argv[])
+{
+    ScanFrame frame;
+
+    // empty frame has no distances
+    assert(frame.empty());
+    assert(frame.distance_at(0.0f) == 0.0f);
+    assert(frame.interpolated_at(90.0f) == 0.0f);
+
+    std::vector<ScanNode> nodes = {
+        {1000, 0.1f, 47},
+        {0, 45.0f, 0},      // failed measurement
+        {2000, 90.0f, 47},
+        {1500, 90.1f, 47},  // nearer node in same bin wins
+        {3000, 180.0f, 47},
+        {4000, 359.8f, 47}
+    };
+    frame.build(nodes);
+
+    assert(!frame.empty());
+    assert(frame.nodes().size() == nodes.size());
+
+    // exact bins
+    assert(frame.distance_at(0.0f) == 1000.0f);
+    assert(frame.distance_at(90.0f) == 1500.0f);
+    assert(frame.distance_at(180.0f) == 3000.0f);
+
+    // tolerance window, including wrap around 0 degrees
+    assert(frame.distance_at(180.75f) == 3000.0f);
+    assert(frame.distance_at(182.0f) == 0.0f);
+    assert(frame.distance_at(182.0f, 2.5f) == 3000.0f);
+    assert(frame.distance_at(360.5f) == 1000.0f);
+    assert(frame.distance_at(-0.5f) == 4000.0f || frame.distance_at(-0.5f) == 1000.0f);
+
+    // failed measurements are never returned
+    assert(frame.distance_at(45.0f) == 0.0f);
+
+    // interpolation over empty bins
+    assert(std::abs(frame.interpolated_at(135.0f) - 2250.0f) < 1.0f);
+    assert(frame.interpolated_at(90.0f) == 1500.0f);
+
+    std::cout << "scan_frame_test passed" << std::endl;
+    return 0;
+}
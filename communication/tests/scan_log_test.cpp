@@ -0,0 +1,50 @@
+#include <assert.h>
+#include <stdio.h>
+#include <iostream>
+#include <string>
+
+#include "../src/scan_log.hpp"
+#include "../src/replay_rplidar.hpp"
+
+
+int main(int argc, char* argv[])
+{
+    std::string text_log = "../pc/resources/rplidar_walled_in_log.txt";
+    if(argc > 1) text_log = argv[1];
+    std::string log_file = "/tmp/scan_log_test" + SCAN_LOG_EXTENSION;
+
+    // the recorded walled in log has 250 scans, the first one with 549 nodes
+    int frames = convert_text_scan_log(text_log, log_file, 100000);
+    assert(frames >= 250);
+
+    ScanLogReader reader;
+    assert(reader.open(log_file));
+    assert(reader.frame_count() == (size_t)frames);
+    ScanLogReader::Frame first = reader.frame(0);
+    assert(first.count == 549);
+    assert(first.timestamp_us == 0 && reader.frame(1).timestamp_us == 100000);
+    assert(first.nodes[0].dist_mm_q2 / 4 == 198);
+
+    // replay as fast as possible gives every scan once, in order
+    ReplayRPLidar replay(log_file, ReplayPace::FAST);
+    assert(replay.is_ok());
+    int replayed = 0;
+    while(!replay.finished())
+    {
+        ScanFramePtr frame = replay.get_scan();
+        assert(frame);
+        assert(frame->nodes().size() == reader.frame(replayed).count);
+        replayed++;
+    }
+    assert(replayed == frames);
+    assert(!replay.get_scan());
+
+    // real time replay does not run ahead of the recording
+    ReplayRPLidar real_time(log_file, ReplayPace::REAL_TIME);
+    assert(real_time.get_scan());
+    assert(!real_time.get_scan());
+
+    remove(log_file.c_str());
+    std::cout << "scan_log_test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <assert.h>
+#include <cmath>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "../src/map.hpp"
+#include "../src/raycast.hpp"
+#include "../src/scan_matcher.hpp"
+
+
+// scan of a room with corners (-1000, -800) and (1600, 1400) and a pillar, taken from pose
+std::vector<ScanNode> room_scan(const Pose& pose)
+{
+    std::vector<ScanNode> nodes;
+    for(int i = 0; i < 720; i++)
+    {
+        // rplidar angles go clockwise from the front
+        float angle = i * 0.5f;
+        float a = (90.0f - angle + pose.rot) * M_PI / 180.0f;
+        float dx = std::cos(a), dy = std::sin(a);
+        float t = 1e9;
+        if(dx > 0) t = std::min(t, (1600 - pose.x) / dx);
+        if(dx < 0) t = std::min(t, (-1000 - pose.x) / dx);
+        if(dy > 0) t = std::min(t, (1400 - pose.y) / dy);
+        if(dy < 0) t = std::min(t, (-800 - pose.y) / dy);
+
+        // pillar, a square from (600, 400) to (800, 600)
+        for(float s = 0; s < t; s += 5)
+        {
+            float x = pose.x + s * dx, y = pose.y + s * dy;
+            if(x > 600 && x < 800 && y > 400 && y < 600)
+            {
+                t = s;
+                break;
+            }
+        }
+        nodes.push_back({(uint32_t)t, angle, 47});
+    }
+    return nodes;
+}
+
+
+int main()
+{
+    Map map(50);
+    ScanMatcher matcher;
+
+    // nothing to match against in an empty map
+    ScanMatch match = matcher.match(map, room_scan(Pose{0, 0, 0}), Pose{0, 0, 0});
+    assert(!match.matched);
+    assert(match.pose.x == 0 && match.pose.y == 0 && match.pose.rot == 0);
+
+    RayCaster caster(map.cell_size());
+    for(int i = 0; i < 5; i++)
+    {
+        caster.cast(room_scan(Pose{0, 0, 0}), Pose{0, 0, 0},
+            [&map](int col, int row){ map.update(col, row, Tile::EMPTY); },
+            [&map](int col, int row){ map.update(col, row, Tile::WALL); }
+        );
+    }
+
+    // scan taken somewhere else, with the odometry guess at the start
+    Pose truth{230, -140, 6};
+    auto start = std::chrono::steady_clock::now();
+    match = matcher.match(map, room_scan(truth), Pose{0, 0, 0});
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "matched at " << match.pose.x << ", " << match.pose.y << ", " << match.pose.rot
+              << " score " << match.score << " in " << ms << " ms" << std::endl;
+    assert(match.matched);
+    assert(std::abs(match.pose.x - truth.x) < 30);
+    assert(std::abs(match.pose.y - truth.y) < 30);
+    assert(std::abs(match.pose.rot - truth.rot) < 1.0f);
+    assert(match.score > 0.8f);
+
+    // the guess is kept when the true pose is outside the window
+    match = matcher.match(map, room_scan(Pose{900, 0, 0}), Pose{-300, 0, 0});
+    assert(!match.matched || std::abs(match.pose.x + 300) <= matcher.get_config().linear_window + 50);
+
+    std::cout << "scan_matcher_test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <iostream>
+#include <vector>
+
+#include "../src/serial_frame.hpp"
+
+
+static std::vector<uint8_t> frame_of(uint8_t type, std::vector<uint8_t> payload)
+{
+    uint8_t out[FRAME_MAX];
+    size_t size = encode_frame(type, payload.data(), payload.size(), out);
+    return std::vector<uint8_t>(out, out + size);
+}
+
+
+int main()
+{
+    // CRC-8 with polynomial 0x07, the check value of "123456789" is 0xF4
+    assert(crc8((const uint8_t*)"123456789", 9) == 0xF4);
+    assert(crc8((const uint8_t*)"56789", 5, crc8((const uint8_t*)"1234", 4)) == 0xF4);
+
+    // start, type, length, payload and crc
+    std::vector<uint8_t> measurement = frame_of(7, {1, 2, 3, 4, 5, 6});
+    assert(measurement.size() == 10 && measurement[0] == FRAME_START && measurement[1] == 7 && measurement[2] == 6);
+    assert(measurement[9] == crc8(measurement.data() + 1, 8));
+    uint8_t too_long[FRAME_PAYLOAD_MAX + 1] = {0};
+    uint8_t out[FRAME_MAX];
+    assert(encode_frame(1, too_long, FRAME_PAYLOAD_MAX + 1, out) == 0);
+
+    // frames come out whole, also when they arrive a byte at a time
+    FrameParser parser;
+    SerialFrame frame;
+    for(size_t i = 0; i < measurement.size(); i++)
+    {
+        assert(!parser.next(frame));
+        parser.feed(&measurement[i], 1);
+    }
+    assert(parser.next(frame) && frame.type == 7 && frame.length == 6 && frame.payload[5] == 6);
+    assert(!parser.next(frame));
+
+    // frames without payload
+    std::vector<uint8_t> competition = frame_of(2, {});
+    parser.feed(competition.data(), competition.size());
+    assert(parser.next(frame) && frame.type == 2 && frame.length == 0);
+
+    // garbage before a frame is skipped, also bytes that look like a start byte
+    std::vector<uint8_t> noisy = {0x00, FRAME_START, 0xFF, FRAME_START, 7, 200};
+    noisy.insert(noisy.end(), measurement.begin(), measurement.end());
+    parser.feed(noisy.data(), noisy.size());
+    assert(parser.next(frame) && frame.type == 7 && frame.payload[0] == 1);
+    assert(parser.dropped() == 6);
+
+    // a corrupted frame is lost but the next one right after it is not
+    std::vector<uint8_t> corrupted = frame_of(7, {9, 9, 9, 9, 9, 9});
+    corrupted[4] ^= 0x10;
+    std::vector<uint8_t> both = corrupted;
+    both.insert(both.end(), competition.begin(), competition.end());
+    parser.feed(both.data(), both.size());
+    assert(parser.next(frame) && frame.type == 2);
+    assert(!parser.next(frame));
+    assert(parser.crc_errors() == 1);
+
+    // a lost byte costs only the frame it was in
+    std::vector<uint8_t> lost = measurement;
+    lost.erase(lost.begin() + 3);
+    lost.insert(lost.end(), measurement.begin(), measurement.end());
+    parser.feed(lost.data(), lost.size());
+    assert(parser.next(frame) && frame.type == 7 && frame.payload[0] == 1 && frame.payload[5] == 6);
+    assert(!parser.next(frame));
+
+    // many frames over the wrap of the ring, all in order
+    FrameParser ring;
+    int received = 0;
+    for(int i = 0; i < 1000; i++)
+    {
+        std::vector<uint8_t> numbered = frame_of(7, {(uint8_t)i, (uint8_t)(i >> 8), 0, 0, 0, 0});
+        assert(ring.feed(numbered.data(), numbered.size()) == numbered.size());
+        while(ring.next(frame))
+        {
+            assert((frame.payload[0] | (frame.payload[1] << 8)) == received);
+            received++;
+        }
+    }
+    assert(received == 1000 && ring.frames() == 1000 && ring.dropped() == 0);
+
+    // a full ring takes no more
+    FrameParser full;
+    std::vector<uint8_t> filler(FrameParser::CAPACITY + 10, 0);
+    assert(full.feed(filler.data(), filler.size()) == FrameParser::CAPACITY);
+
+    // fill reads everything available with one read, across the wrap of the ring
+    int pipe_fds[2];
+    assert(pipe(pipe_fds) == 0);
+    fcntl(pipe_fds[0], F_SETFL, O_NONBLOCK);
+    FrameParser piped;
+    std::vector<uint8_t> burst;
+    for(int i = 0; i < 20; i++) burst.insert(burst.end(), measurement.begin(), measurement.end());
+    assert(write(pipe_fds[1], burst.data(), burst.size()) == (ssize_t)burst.size());
+    assert(piped.fill(pipe_fds[0]) == burst.size());
+    int count = 0;
+    while(piped.next(frame)) count++;
+    assert(count == 20);
+    assert(write(pipe_fds[1], burst.data(), burst.size()) == (ssize_t)burst.size());
+    assert(piped.fill(pipe_fds[0]) == burst.size());
+    while(piped.next(frame)) count++;
+    assert(count == 40);
+    assert(piped.fill(pipe_fds[0]) == 0);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+
+    std::cout << "serial_frame_test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <iostream>
+#include <vector>
+
+#include "../src/serial_writer.hpp"
+#include "../src/serial.hpp"
+#include "../src/event_loop.hpp"
+
+
+// decode every frame that can be read from fd
+static std::vector<SerialFrame> received(int fd, FrameParser& parser)
+{
+    std::vector<SerialFrame> frames;
+    SerialFrame frame;
+    while(parser.fill(fd) > 0) while(parser.next(frame)) frames.push_back(frame);
+    while(parser.next(frame)) frames.push_back(frame);
+    return frames;
+}
+
+
+int main()
+{
+    int pipe_fds[2];
+    assert(pipe(pipe_fds) == 0);
+    fcntl(pipe_fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(pipe_fds[1], F_SETFL, O_NONBLOCK);
+    FrameParser parser;
+
+    // everything queued goes out in one flush, in order
+    SerialWriter writer;
+    for(uint8_t i = 0; i < 10; i++) assert(writer.queue_frame(7, &i, 1));
+    assert(writer.stats().depth == 10);
+    assert(writer.flush(pipe_fds[1]) && writer.empty());
+    std::vector<SerialFrame> frames = received(pipe_fds[0], parser);
+    assert(frames.size() == 10);
+    for(uint8_t i = 0; i < 10; i++) assert(frames[i].payload[0] == i);
+    SerialStats stats = writer.stats();
+    assert(stats.frames == 10 && stats.written == 10 * 5 && stats.depth == 0 && stats.max_depth == 10);
+
+    // a newer setpoint replaces a queued one, other frames keep their place
+    writer.replace_queued(4);
+    uint8_t setpoint[3] = {1, 1, 3};
+    assert(writer.queue_frame(4, setpoint, 3));
+    assert(writer.queue_frame(3, nullptr, 0));
+    setpoint[0] = 2;
+    assert(writer.queue_frame(4, setpoint, 3));
+    assert(writer.stats().depth == 2 && writer.stats().replaced == 1);
+    assert(writer.flush(pipe_fds[1]));
+    frames = received(pipe_fds[0], parser);
+    assert(frames.size() == 2 && frames[0].type == 4 && frames[0].payload[0] == 2 && frames[1].type == 3);
+
+    // tagged frames are reported once written, a replaced frame's tag never is
+    std::vector<uint64_t> tags;
+    writer.on_written([&tags](uint8_t type, uint64_t tag){ assert(type == 4); tags.push_back(tag); });
+    assert(writer.queue_frame(4, setpoint, 3, 1));
+    assert(writer.queue_frame(4, setpoint, 3, 2));
+    assert(writer.queue_frame(3, nullptr, 0));
+    assert(tags.empty());
+    assert(writer.flush(pipe_fds[1]));
+    assert(tags.size() == 1 && tags[0] == 2);
+    received(pipe_fds[0], parser);
+    writer.on_written(nullptr);
+
+    // a full queue drops new frames
+    SerialWriter full;
+    uint8_t payload[FRAME_PAYLOAD_MAX] = {0};
+    size_t fit = SerialWriter::CAPACITY / FRAME_MAX;
+    for(size_t i = 0; i < fit; i++) assert(full.queue_frame(7, payload, FRAME_PAYLOAD_MAX));
+    size_t queued = fit;
+    while(full.queue_frame(7, payload, FRAME_PAYLOAD_MAX)) queued++;
+    assert(full.stats().dropped == 1 && full.stats().depth == queued);
+
+    // short writes keep the rest queued, nothing is lost
+    std::vector<uint8_t> stuffing(4096, 0);
+    while(write(pipe_fds[1], stuffing.data(), stuffing.size()) > 0);
+    uint8_t count = 0;
+    for(int i = 0; i < 50; i++, count++) assert(writer.queue_frame(7, &count, 1));
+    assert(writer.flush(pipe_fds[1]) && !writer.empty());
+    count = 0;
+    int drained = 0;
+    while(drained < 100)
+    {
+        uint8_t byte;
+        while(read(pipe_fds[0], &byte, 1) == 1)
+        {
+            // once the stuffing is read, what follows are the frames
+            parser.feed(&byte, 1);
+        }
+        writer.flush(pipe_fds[1]);
+        SerialFrame frame;
+        while(parser.next(frame)) assert(frame.payload[0] == count++);
+        if(writer.empty() && count == 50) break;
+        drained++;
+    }
+    assert(count == 50 && writer.empty() && writer.stats().dropped == 0);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+
+    // attached to an event loop, the port is written when the loop finds it writable
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    assert(master >= 0 && grantpt(master) == 0 && unlockpt(master) == 0);
+    fcntl(master, F_SETFL, O_NONBLOCK);
+    FrameParser pty_parser;
+    {
+        EventLoop loop;
+        Serial serial;
+        serial.open(ptsname(master));
+        serial.attach(loop);
+        serial.replace_queued(4);
+        setpoint[0] = 10;
+        assert(serial.write_frame(4, setpoint, 3));
+        setpoint[0] = 11;
+        assert(serial.write_frame(4, setpoint, 3));
+        usleep(10000);
+        assert(received(master, pty_parser).empty());
+
+        assert(loop.run_once(100) == 1);
+        usleep(10000);
+        frames = received(master, pty_parser);
+        assert(frames.size() == 1 && frames[0].payload[0] == 11);
+        assert(serial.stats().frames == 1 && serial.stats().replaced == 1);
+
+        // nothing to write, the loop is not woken
+        assert(loop.run_once(10) == 0);
+
+        // closing writes what is still queued
+        serial.write_frame(3);
+        serial.close();
+    }
+    usleep(10000);
+    frames = received(master, pty_parser);
+    assert(frames.size() == 1 && frames[0].type == 3);
+    close(master);
+
+    std::cout << "serial_writer_test passed" << std::endl;
+    return 0;
+}
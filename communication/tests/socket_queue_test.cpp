@@ -0,0 +1,171 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/socket.hpp"
+#include "../src/event_loop.hpp"
+#include "../src/latency.hpp"
+
+using json = nlohmann::json;
+
+
+#define TEST_PORT 18765
+
+
+// a client of the socket, reading only when told to
+struct TestClient
+{
+    int fd;
+    std::string input;
+    std::vector<json> messages;
+
+    TestClient(int receive_buffer)
+    {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if(receive_buffer > 0) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(TEST_PORT);
+        assert(connect(fd, (sockaddr*)&address, sizeof(address)) == 0);
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+    }
+
+    ~TestClient()
+    {
+        close(fd);
+    }
+
+    // read what arrived, returns false once the server hung up
+    bool read_all()
+    {
+        char buffer[65536];
+        ssize_t size;
+        while((size = read(fd, buffer, sizeof(buffer))) > 0) input.append(buffer, size);
+        size_t end;
+        while((end = input.find("__MSG_END__")) != std::string::npos)
+        {
+            messages.push_back(json::parse(input.substr(0, end)));
+            input.erase(0, end + 11);
+        }
+        return size != 0;
+    }
+};
+
+
+// run loop and read client until done, at most 2 s
+template<typename Done>
+static bool pump(EventLoop& loop, TestClient& client, Done done)
+{
+    int64_t until = monotonic_ns() + 2000000000;
+    while(!done() && monotonic_ns() < until)
+    {
+        loop.run_once(1);
+        client.read_all();
+    }
+    return done();
+}
+
+
+static json message(const std::string& id, int number)
+{
+    // big enough that a stalled client fills its socket after a few
+    return {{"id", id}, {"n", number}, {"padding", std::string(8192, 'x')}};
+}
+
+
+int main()
+{
+    Socket server(30, 8, 1 << 20);
+    server.set_topic_policy("state", TopicPolicy::COALESCE);
+    server.set_topic_policy("map", TopicPolicy::KEEP);
+    server.start_socket(TEST_PORT);
+    EventLoop loop;
+    server.attach(loop);
+
+    // the second client's socket takes little, so it is stalled as soon as it stops reading
+    std::vector<int> connected;
+    server.on_connect([&connected](int sd)
+    {
+        int nodelay = 0;
+        socklen_t size = sizeof(nodelay);
+        assert(getsockopt(sd, IPPROTO_TCP, TCP_NODELAY, &nodelay, &size) == 0 && nodelay);
+        if(!connected.empty())
+        {
+            int send_buffer = 4096;
+            setsockopt(sd, SOL_SOCKET, SO_SNDBUF, &send_buffer, sizeof(send_buffer));
+        }
+        connected.push_back(sd);
+    });
+    TestClient fast(0);
+    assert(pump(loop, fast, [&](){ return connected.size() == 1; }));
+    TestClient stalled(4096);
+    assert(pump(loop, fast, [&](){ return connected.size() == 2; }));
+
+    // How many messages the sockets take before the stalled client holds up its queue is up to the
+    // kernel, which grows socket buffers as it sees fit. Each part sends until the server shows the
+    // client is stalled, and checks the bounds of the queue rather than how many were sent.
+
+    // the fast client gets every state, the stalled one only gets the latest once it reads again
+    int64_t slowest_ns = 0;
+    int states = 0;
+    while(states < 100 || server.stats().coalesced == 0)
+    {
+        assert(states < 10000);
+        int64_t start = monotonic_ns();
+        server.send_to_clients_json(message("state", states));
+        slowest_ns = std::max(slowest_ns, monotonic_ns() - start);
+        states++;
+        assert(pump(loop, fast, [&](){ return fast.messages.size() == (size_t)states; }));
+    }
+    for(int i = 0; i < states; i++) assert(fast.messages[i]["n"] == i);
+    SocketStats stats = server.stats();
+    assert(stats.coalesced > 0 && stats.dropped == 0 && stats.queued <= 1);
+    assert(pump(loop, stalled, [&](){ return !stalled.messages.empty() && stalled.messages.back()["n"] == states - 1; }));
+    assert(stalled.messages.size() < (size_t)states);
+    for(size_t i = 1; i < stalled.messages.size(); i++) assert(stalled.messages[i]["n"] > stalled.messages[i - 1]["n"]);
+    assert(server.stats().queued == 0);
+
+    // dropped topics are not queued once the queue of a stalled client is full
+    stalled.messages.clear();
+    int logs = 0;
+    while(server.stats().dropped == 0)
+    {
+        assert(logs < 10000);
+        server.send_to_clients_json(message("log", logs));
+        logs++;
+        assert(pump(loop, fast, [&](){ return fast.messages.size() == (size_t)(states + logs); }));
+    }
+    stats = server.stats();
+    assert(stats.queued > 0 && stats.queued <= 8 && stats.max_queued == 8);
+    assert(pump(loop, stalled, [&](){ return stalled.messages.size() + stats.dropped == (size_t)logs; }));
+    for(size_t i = 1; i < stalled.messages.size(); i++) assert(stalled.messages[i]["n"] > stalled.messages[i - 1]["n"]);
+    assert(server.stats().queued == 0);
+
+    // a client too far behind for a kept topic is disconnected, the others get all of it
+    fast.messages.clear();
+    int maps = 0;
+    while(server.stats().disconnected == 0)
+    {
+        assert(maps < 10000);
+        server.send_to_clients_json(message("map", maps));
+        maps++;
+        assert(pump(loop, fast, [&](){ return fast.messages.size() == (size_t)maps; }));
+    }
+    for(int i = 0; i < maps; i++) assert(fast.messages[i]["n"] == i);
+    stats = server.stats();
+    assert(stats.disconnected == 1 && stats.clients == 1);
+    while(stalled.read_all());
+
+    // a stalled client does not make sending wait
+    assert(slowest_ns < 50000000);
+
+    std::cout << "socket_queue_test passed" << std::endl;
+    return 0;
+}
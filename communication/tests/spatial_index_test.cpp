@@ -0,0 +1,135 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "../src/spatial_index.hpp"
+
+
+float distance2(const Vec2& a, const Vec2& b)
+{
+    Vec2 d = a - b;
+    return d.dot(d);
+}
+
+// nearest point by brute force, -1 if none within max_distance
+int brute_nearest(const std::vector<Vec2>& points, const Vec2& p, float max_distance)
+{
+    int best = -1;
+    float best_dist = max_distance * max_distance;
+    for(size_t i = 0; i < points.size(); i++)
+    {
+        if(distance2(points[i], p) < best_dist)
+        {
+            best_dist = distance2(points[i], p);
+            best = i;
+        }
+    }
+    return best;
+}
+
+std::vector<int> brute_radius(const std::vector<Vec2>& points, const Vec2& p, float r)
+{
+    std::vector<int> found;
+    for(size_t i = 0; i < points.size(); i++)
+    {
+        if(distance2(points[i], p) <= r * r) found.push_back(i);
+    }
+    return found;
+}
+
+// same point or an equally near one
+void check_nearest(const std::vector<Vec2>& points, const Vec2& p, int expected, int got)
+{
+    assert((expected < 0) == (got < 0));
+    if(got >= 0) assert(distance2(points[got], p) == distance2(points[expected], p));
+}
+
+void check_radius(std::vector<int> expected, std::vector<int> got)
+{
+    std::sort(got.begin(), got.end());
+    assert(expected == got);
+}
+
+// points along the walls of a room, like a scan, plus some clutter
+std::vector<Vec2> make_points(int seed)
+{
+    srand(seed);
+    std::vector<Vec2> points;
+    for(int i = 0; i < 720; i++)
+    {
+        float a = i * 0.5f * M_PI / 180.0f;
+        float r = std::min(std::abs(1200.0f / std::cos(a)), std::abs(800.0f / std::sin(a)));
+        points.push_back(Vec2(r * std::cos(a), r * std::sin(a)));
+    }
+    for(int i = 0; i < 200; i++)
+    {
+        points.push_back(Vec2(rand() % 2400 - 1200, rand() % 1600 - 800));
+    }
+    // duplicates
+    points.push_back(points[10]);
+    points.push_back(points[10]);
+    return points;
+}
+
+
+int main()
+{
+    std::vector<Vec2> points = make_points(1);
+    std::vector<Vec2> queries = make_points(2);
+    for(Vec2& q : queries) q += Vec2(7, -3);
+
+    KdTree tree;
+    tree.build(points);
+    GridHash hash(50.0f);
+    hash.build(points);
+    assert(tree.size() == points.size());
+    assert(hash.size() == points.size());
+
+    // single queries
+    for(const Vec2& q : queries)
+    {
+        check_nearest(points, q, brute_nearest(points, q, 1e9f), tree.nearest(q));
+        check_nearest(points, q, brute_nearest(points, q, 30.0f), tree.nearest(q, 30.0f));
+        check_nearest(points, q, brute_nearest(points, q, 120.0f), hash.nearest(q, 120.0f));
+
+        std::vector<int> found;
+        tree.radius(q, 60.0f, found);
+        check_radius(brute_radius(points, q, 60.0f), found);
+        found.clear();
+        hash.radius(q, 60.0f, found);
+        check_radius(brute_radius(points, q, 60.0f), found);
+    }
+
+    // batch queries
+    std::vector<int> nearest, offsets, found;
+    tree.nearest(queries, nearest, 100.0f);
+    assert(nearest.size() == queries.size());
+    for(size_t i = 0; i < queries.size(); i++) check_nearest(points, queries[i], brute_nearest(points, queries[i], 100.0f), nearest[i]);
+    hash.nearest(queries, nearest, 100.0f);
+    for(size_t i = 0; i < queries.size(); i++) check_nearest(points, queries[i], brute_nearest(points, queries[i], 100.0f), nearest[i]);
+
+    tree.radius(queries, 40.0f, offsets, found);
+    assert(offsets.size() == queries.size() + 1);
+    for(size_t i = 0; i < queries.size(); i++)
+    {
+        check_radius(brute_radius(points, queries[i], 40.0f), std::vector<int>(found.begin() + offsets[i], found.begin() + offsets[i + 1]));
+    }
+    hash.radius(queries, 40.0f, offsets, found);
+    for(size_t i = 0; i < queries.size(); i++)
+    {
+        check_radius(brute_radius(points, queries[i], 40.0f), std::vector<int>(found.begin() + offsets[i], found.begin() + offsets[i + 1]));
+    }
+
+    // empty index finds nothing
+    KdTree empty_tree;
+    empty_tree.build({});
+    assert(empty_tree.nearest(Vec2(0, 0)) == -1);
+    GridHash empty_hash(50.0f);
+    assert(empty_hash.nearest(Vec2(0, 0), 100.0f) == -1);
+
+    std::cout << "spatial_index_test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include <assert.h>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "../src/spsc_queue.hpp"
+#include "../src/bounded_queue.hpp"
+
+
+int main()
+{
+    // capacity is rounded up to a power of two, a full queue drops the pushed item
+    SpscQueue<int> queue(3);
+    assert(queue.capacity() == 4);
+    int item;
+    assert(!queue.pop(item));
+    for(int i = 0; i < 4; i++) assert(queue.push(i));
+    assert(!queue.push(4));
+    assert(queue.depth() == 4);
+
+    // items come out in order and the ring wraps around
+    for(int i = 0; i < 4; i++) assert(queue.pop(item) && item == i);
+    assert(!queue.pop(item));
+    for(int i = 10; i < 13; i++) assert(queue.push(i));
+    for(int i = 10; i < 13; i++) assert(queue.pop(item) && item == i);
+
+    QueueStats stats = queue.stats();
+    assert(stats.depth == 0 && stats.max_depth == 4);
+    assert(stats.pushed == 8 && stats.dropped == 1 && stats.popped == 7);
+    assert(stats.max_latency_ms >= stats.mean_latency_ms && stats.mean_latency_ms >= 0);
+
+    // what a popped slot holds is let go right away
+    SpscQueue<std::shared_ptr<int>> shared(2);
+    std::shared_ptr<int> held = std::make_shared<int>(1);
+    shared.push(held);
+    std::shared_ptr<int> popped;
+    assert(shared.pop(popped));
+    popped.reset();
+    assert(held.use_count() == 1);
+
+    // latency is the time an item waited
+    SpscQueue<std::function<void()>> tasks(8);
+    int runs = 0;
+    tasks.push([&runs]() { runs++; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::function<void()> task;
+    assert(tasks.pop(task));
+    task();
+    assert(runs == 1 && tasks.stats().max_latency_ms >= 20);
+
+    // one producer and one consumer thread, every pushed item arrives once and in order
+    SpscQueue<long> numbers(64);
+    const long count = 1000000;
+    long pushed = 0;
+    std::thread producer([&]() {
+        for(long i = 0; i < count; i++)
+        {
+            while(!numbers.push(i)) std::this_thread::yield();
+            pushed++;
+        }
+    });
+    long expected = 0, number;
+    while(expected < count)
+    {
+        if(!numbers.pop(number)) continue;
+        assert(number == expected);
+        expected++;
+    }
+    producer.join();
+    assert(pushed == count && numbers.depth() == 0);
+    assert(numbers.stats().popped == (unsigned long long)count);
+
+    // the max depth is what was waiting, not how far behind the producer's copy of the head is
+    SpscQueue<int> alternating(8);
+    for(int i = 0; i < 100; i++)
+    {
+        assert(alternating.push(i) && alternating.pop(item) && item == i);
+    }
+    assert(alternating.stats().max_depth == 1);
+
+    // the bounded queue keeps the same stats
+    BoundedQueue<int> bounded(2, DropPolicy::DROP_OLDEST);
+    bounded.push(1);
+    bounded.push(2);
+    bounded.push(3);
+    assert(bounded.pop(item) && item == 2);
+    stats = bounded.stats();
+    assert(stats.depth == 1 && stats.max_depth == 2 && stats.pushed == 3 && stats.dropped == 1 && stats.popped == 1);
+    assert(bounded.dropped() == 1);
+
+    std::cout << "spsc_queue_test passed" << std::endl;
+    return 0;
+}
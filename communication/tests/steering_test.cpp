@@ -0,0 +1,120 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <iostream>
+#include <vector>
+
+#include "../src/steering.hpp"
+#include "../src/serial_frame.hpp"
+#include "../src/event_loop.hpp"
+
+
+// frames the steering module would have received since last time
+static std::vector<SerialFrame> received(int master, FrameParser& parser)
+{
+    usleep(10000);
+    parser.fill(master);
+    std::vector<SerialFrame> frames;
+    SerialFrame frame;
+    while(parser.next(frame)) frames.push_back(frame);
+    return frames;
+}
+
+
+// steering whose port the test can fill
+struct TestSteering : public Steering
+{
+    using Steering::Steering;
+    Serial& port() { return serial; }
+};
+
+
+int main()
+{
+    // the steering module is the other end of a pseudo terminal
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    assert(master >= 0 && grantpt(master) == 0 && unlockpt(master) == 0);
+    fcntl(master, F_SETFL, O_NONBLOCK);
+    FrameParser parser;
+
+    {
+        EventLoop loop;
+        TestSteering steering(ptsname(master));
+        std::vector<SerialFrame> frames = received(master, parser);
+        assert(frames.size() == 1 && frames[0].type == (uint8_t)SteeringTx::IDENTIFIED);
+
+        // speeds and directions go in one drive frame
+        steering.command(SteeringCommand::DRIVE_FORWARD);
+        frames = received(master, parser);
+        assert(frames.size() == 1 && frames[0].type == (uint8_t)SteeringTx::DRIVE && frames[0].length == 3);
+        assert(frames[0].payload[0] == frames[0].payload[1] && frames[0].payload[0] > 100 && frames[0].payload[2] == 3);
+
+        // the same output again is not sent
+        steering.command(SteeringCommand::DRIVE_FORWARD);
+        assert(received(master, parser).empty());
+        assert(steering.drive_count() == 1 && steering.unchanged_count() == 1);
+
+        steering.command(SteeringCommand::HALT);
+        frames = received(master, parser);
+        assert(frames.size() == 1 && frames[0].payload[0] == 0 && frames[0].payload[1] == 0 && frames[0].payload[2] == 3);
+
+        // a new rotation is sent at once without stopping first
+        steering.set_rotation(Rotation::LEFT);
+        steering.update();
+        frames = received(master, parser);
+        assert(frames.size() == 1 && frames[0].payload[2] == 2 && frames[0].payload[0] == frames[0].payload[1]);
+        steering.update();
+        assert(received(master, parser).empty());
+        assert(!steering.get_control().left_forward && steering.get_control().right_forward);
+
+        // a decision is traced once, also when the steering module already had its output
+        LatencyTracer tracer;
+        steering.set_tracer(&tracer);
+        LatencyTrace trace;
+        trace.sensor_ns = monotonic_ns();
+        trace.decision_ns = trace.sensor_ns;
+        steering.decided(trace);
+        steering.rotate_regulated(90);
+        steering.rotate_regulated(90);
+        assert(tracer.histogram(LatencyPath::SENSOR_TO_WRITE).count() == 1);
+        steering.decided(trace);
+        steering.rotate_regulated(90);
+        assert(tracer.histogram(LatencyPath::DECISION_TO_WRITE).count() == 2);
+        assert(received(master, parser).size() == 1);
+
+        // attached to a loop, the decision is written when the loop writes its drive frame, not when it is queued
+        steering.attach(loop);
+        steering.decided(trace);
+        steering.command(SteeringCommand::DRIVE_FORWARD);
+        assert(tracer.histogram(LatencyPath::DECISION_TO_WRITE).count() == 2);
+        assert(loop.run_once(100) == 1);
+        assert(tracer.histogram(LatencyPath::DECISION_TO_WRITE).count() == 3);
+        assert(received(master, parser).size() == 1);
+
+        // a new rotation whose drive frame does not fit in the queue is sent on a later update
+        uint8_t identified[FRAME_MAX];
+        size_t size = encode_frame((uint8_t)SteeringTx::IDENTIFIED, nullptr, 0, identified);
+        while(steering.port().write(identified, size) > 0);
+        unsigned long long drives = steering.drive_count();
+        steering.set_rotation(Rotation::RIGHT);
+        steering.update();
+        assert(steering.drive_count() == drives);
+        while(steering.serial_stats().depth > 0) loop.run_once(100);
+        while(!received(master, parser).empty());
+        steering.update();
+        assert(steering.drive_count() == drives + 1);
+        assert(loop.run_once(100) == 1);
+        frames = received(master, parser);
+        assert(frames.size() == 1 && frames[0].type == (uint8_t)SteeringTx::DRIVE && frames[0].payload[2] == 1);
+    }
+
+    // stopped when gone
+    std::vector<SerialFrame> frames = received(master, parser);
+    assert(frames.size() == 1 && frames[0].type == (uint8_t)SteeringTx::DRIVE && frames[0].payload[0] == 0 && frames[0].payload[1] == 0);
+    assert(parser.crc_errors() == 0 && parser.dropped() == 0);
+    close(master);
+
+    std::cout << "steering_test passed" << std::endl;
+    return 0;
+}
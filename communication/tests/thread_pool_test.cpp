@@ -0,0 +1,39 @@
+#include <assert.h>
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+#include "../src/thread_pool.hpp"
+
+
+int main()
+{
+    ThreadPool pool(4);
+    assert(pool.size() == 4);
+
+    // every index is visited exactly once, loop after loop
+    std::vector<int> visits(100000, 0);
+    for(int loop = 0; loop < 50; loop++)
+    {
+        pool.parallel_for(visits.size(), [&visits](size_t begin, size_t end) {
+            for(size_t i = begin; i < end; i++) visits[i]++;
+        });
+    }
+    for(int v : visits) assert(v == 50);
+
+    // small loops run on the caller only, empty loops do nothing
+    std::atomic<int> calls(0);
+    pool.parallel_for(10, [&calls](size_t begin, size_t end) { assert(begin == 0 && end == 10); calls++; }, 16);
+    assert(calls == 1);
+    pool.parallel_for(0, [&calls](size_t, size_t) { calls++; });
+    assert(calls == 1);
+
+    // a single thread pool works without workers
+    ThreadPool single(1);
+    long long sum = 0;
+    single.parallel_for(1000, [&sum](size_t begin, size_t end) { for(size_t i = begin; i < end; i++) sum += i; });
+    assert(sum == 999 * 1000 / 2);
+
+    std::cout << "thread_pool_test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <assert.h>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "../src/timer_wheel.hpp"
+
+
+int main()
+{
+    using namespace std::chrono;
+
+    // every part advances its own wheel ahead of the clock, so each gets a new one
+    TimerWheel wheel(milliseconds(1), 16);
+    assert(wheel.next_timeout() == -1);
+    assert(wheel.advance() == 0);
+
+    // one-shot timers fire once, in order of expiry, never early
+    nanoseconds start = TimerWheel::now();
+    std::vector<int> fired;
+    wheel.after(milliseconds(5), [&]() { fired.push_back(5); });
+    wheel.after(milliseconds(2), [&]() { fired.push_back(2); });
+    TimerWheel::Id cancelled = wheel.after(milliseconds(3), [&]() { fired.push_back(3); });
+    assert(wheel.size() == 3);
+    assert(wheel.cancel(cancelled) && !wheel.cancel(cancelled));
+    int timeout = wheel.next_timeout(start);
+    assert(timeout >= 2 && timeout <= 3);
+    assert(wheel.advance(start + milliseconds(1)) == 0);
+    assert(wheel.advance(start + milliseconds(10)) == 2);
+    assert((fired == std::vector<int>{2, 5}));
+    assert(wheel.size() == 0 && wheel.next_timeout() == -1);
+
+    // timers further away than one turn of the wheel wait for their turn
+    wheel = TimerWheel(milliseconds(1), 16);
+    start = TimerWheel::now();
+    int late = 0;
+    wheel.after(milliseconds(40), [&]() { late++; });
+    timeout = wheel.next_timeout(start);
+    assert(timeout >= 40 && timeout <= 41);
+    assert(wheel.advance(start + milliseconds(20)) == 0);
+    assert(wheel.advance(start + milliseconds(39)) == 0 && late == 0);
+    assert(wheel.advance(start + milliseconds(42)) == 1 && late == 1);
+
+    // periodic timers skip the periods missed, a long pause fires them once
+    wheel = TimerWheel(milliseconds(1), 16);
+    start = TimerWheel::now();
+    int ticks = 0;
+    TimerWheel::Id periodic = wheel.every(milliseconds(10), [&]() { ticks++; });
+    assert(wheel.advance(start + milliseconds(5)) == 0);
+    assert(wheel.advance(start + milliseconds(11)) == 1 && ticks == 1);
+    assert(wheel.advance(start + milliseconds(15)) == 0);
+    assert(wheel.advance(start + milliseconds(500)) == 1 && ticks == 2);
+    timeout = wheel.next_timeout(start + milliseconds(500));
+    assert(timeout >= 1 && timeout <= 10);
+    assert(wheel.advance(start + milliseconds(511)) == 1 && ticks == 3);
+
+    // callbacks can cancel their own timer and add new ones
+    int added = 0;
+    assert(wheel.cancel(periodic));
+    wheel = TimerWheel(milliseconds(1), 16);
+    TimerWheel::Id self = 0;
+    self = wheel.every(milliseconds(1), [&]() {
+        wheel.cancel(self);
+        wheel.after(milliseconds(0), [&]() { added++; });
+    });
+    start = TimerWheel::now();
+    assert(wheel.advance(start + milliseconds(2)) == 1);
+    assert(wheel.size() == 1 && added == 0);
+    assert(wheel.advance(start + milliseconds(4)) == 1 && added == 1);
+    assert(wheel.size() == 0);
+
+    std::cout << "timer_wheel_test passed" << std::endl;
+    return 0;
+}
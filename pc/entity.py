@@ -77,6 +77,7 @@ class Robot(Entity):
         position = (const.TILE_WIDTH * const.ROBOT_ORIGIN[0], const.TILE_HEIGHT * const.ROBOT_ORIGIN[1])
         super().__init__(position, parent=map)
         self.dot_cloud = DotCloud(self)
+        self.segments = Segments(self)
         self.left_distance = 1000.0
         self.right_distance = 1000.0
 
@@ -169,6 +170,35 @@ class DotCloud(Entity):
             dot.on_render(screen, screen_position, screen_rotation)
 
 
+class Segments(Entity):
+    """Wall segments the communication module found in the latest RPlidar scan."""
+
+    COLOR = (0, 200, 0)
+
+    def __init__(self, robot):
+        """Initialize segments."""
+        super().__init__((0, 0), parent=robot)
+        self.lines = []
+        self.robot = robot
+
+        @communication.on_receive("segments")
+        def on_segments(segments):
+            self.lines = segments
+
+    def to_screen(self, x, y):
+        """Screen position of a point in mm in the robot frame, placed like the dots."""
+        origin_x, origin_y = self.robot.position
+        angle = (-math.degrees(math.atan2(x, y)) - self.robot.rotation - 90)*(math.pi/180)
+        dist = math.hypot(x, y)
+        return (int(origin_x + (dist*const.TILE_WIDTH/const.TILE_MM)*math.cos(angle)),
+                int(origin_y + (dist*const.TILE_HEIGHT/const.TILE_MM)*math.sin(angle)))
+
+    def on_render(self, screen, screen_position, screen_rotation):
+        """Draw the segments (they are not drawn relative to the parent)."""
+        for x0, y0, x1, y1 in self.lines:
+            pygame.draw.line(screen, Segments.COLOR, self.to_screen(x0, y0), self.to_screen(x1, y1), 2)
+
+
 class Tile(Entity):
     """Tile class."""
 
@@ -220,6 +250,11 @@ class Map(Entity):
             for r in range(const.MAP_ROWS):
                 for c in range(const.MAP_COLS):
                     self.set_tile(c, r, tiles[r * const.MAP_COLS + c])
+
+        @communication.on_receive("tiles")
+        def on_tiles(tiles):
+            for col, row, tile_type in tiles:
+                self.set_tile(col, row, tile_type)
     
         @communication.on_receive("point")
         def on_point(col, row):
@@ -12,7 +12,6 @@
 
 #define LEFT_SENSOR 0
 #define RIGHT_SENSOR 1
-#define TRANSMIT_DELAY 200
 
 
 //Fields
@@ -141,49 +140,20 @@ void sensor_tick(float offset, float angle, struct sensor_data* d){
 
 
 void send_data(struct sensor_data* d){
-	/*Data is sent in the following order every time:
-		Header
+	/*Data is sent as one measurement frame with the payload:
 		Angle(gyro)
 		Right distance
 		Left distance
+	each high byte first.
 	*/
-	//Header
-	cli();
-	usart_transmit(MEASUREMENT);
-	sei();
-	_delay_us(TRANSMIT_DELAY);
-	//Data
-	uint8_t g_hi = (int8_t)(d->gyro_angle >> 8);
-	uint8_t g_lo = (int8_t)(d->gyro_angle);
-	cli();
-	usart_transmit(g_hi);
-	sei();
-	_delay_us(TRANSMIT_DELAY);
-	cli();
-	usart_transmit(g_lo);
-	sei();
-	_delay_us(TRANSMIT_DELAY);
-	
-	uint8_t r_hi = (uint8_t)(d->right_distance >> 8);
-	uint8_t r_lo = (uint8_t)(d->right_distance);
-	cli();
-	usart_transmit(r_hi);
-	sei();
-	_delay_us(TRANSMIT_DELAY);
-	cli();
-	usart_transmit(r_lo);
-	sei();
-	_delay_us(TRANSMIT_DELAY);
-	uint8_t l_hi = (uint8_t)(d->left_distance >> 8);
-	uint8_t l_lo = (uint8_t)(d->left_distance);	
-	cli();
-	usart_transmit(l_hi);
-	sei();
-	_delay_us(TRANSMIT_DELAY);
-	cli();
-	usart_transmit(l_lo);
-	sei();
-	_delay_us(TRANSMIT_DELAY);
+	uint8_t payload[6];
+	payload[0] = (uint8_t)(d->gyro_angle >> 8);
+	payload[1] = (uint8_t)(d->gyro_angle);
+	payload[2] = (uint8_t)(d->right_distance >> 8);
+	payload[3] = (uint8_t)(d->right_distance);
+	payload[4] = (uint8_t)(d->left_distance >> 8);
+	payload[5] = (uint8_t)(d->left_distance);
+	usart_transmit_frame(MEASUREMENT, payload, 6);
 }
 
 
@@ -193,7 +163,8 @@ void sensor_init()
 
 	while(!state.identified)
 	{
-		usart_transmit(SENSOR_ID);
+		uint8_t id = SENSOR_ID;
+		usart_transmit_frame(MODULE_ID, &id, 1);
 		_delay_ms(100);
 	}
 }
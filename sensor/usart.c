@@ -8,6 +8,8 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <util/delay.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
 
 #include <stdlib.h>
 
@@ -15,7 +17,8 @@
 
 
 
-#define BAUD_PRESCALE 25
+// 500000 baud at 8 MHz in double speed mode, exact
+#define BAUD_PRESCALE 1
 
 void
 init_usart()
@@ -57,22 +60,64 @@ unsigned char usart_receive(void)
 
 
 
+void usart_transmit_frame(uint8_t type, const uint8_t* payload, uint8_t length)
+{
+	// interrupts off so a frame sent from an interrupt never ends up inside this one
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		uint8_t crc = 0;
+		usart_transmit(FRAME_START);
+		usart_transmit(type);
+		crc = _crc8_ccitt_update(crc, type);
+		usart_transmit(length);
+		crc = _crc8_ccitt_update(crc, length);
+		for(uint8_t i = 0; i < length; i++)
+		{
+			usart_transmit(payload[i]);
+			crc = _crc8_ccitt_update(crc, payload[i]);
+		}
+		usart_transmit(crc);
+	}
+}
+
+
 void usart_transmit_competition()
 {
-	usart_transmit(COMPETITION);
+	usart_transmit_frame(COMPETITION, 0, 0);
 }
 	
 
+// USART rx state, where in a frame the next byte is
 struct rx_state
 {
 	enum
 	{
-		NONE = 0,
-		IDENTIFIED = 1
-	} current_type;
-	uint8_t current_field;
-	uint8_t field_buffer[6]; // largest transmission size 6 (TBD for sensor)
+		START = 0,
+		TYPE = 1,
+		LENGTH = 2,
+		PAYLOAD = 3,
+		CRC = 4
+	} step;
+	uint8_t type;
+	uint8_t length;
+	uint8_t received;
+	uint8_t crc;
+	uint8_t payload[FRAME_PAYLOAD_MAX];
 };
+
+
+enum rx_type
+{
+	IDENTIFIED = 1
+};
+
+
+// act on a frame with a correct crc
+static void
+rx_frame(uint8_t type, const uint8_t* payload, uint8_t length)
+{
+	if(type == IDENTIFIED) sensor_identified();
+}
 	
 
 ISR(USART0_RX_vect)
@@ -80,31 +125,38 @@ ISR(USART0_RX_vect)
 	// code to be executed when the USART receives a byte here
 	static struct rx_state state =
 	{
-		.current_type = NONE,
-		.current_field = 0,
+		.step = START,
 	};
 	
 	uint8_t rx_byte;
 	rx_byte = UDR0; // fetch received byte value into variable
-	// UDR0 = rx_byte; // echo back received byte to its transmitter
 	
-	switch(state.current_type)
+	// a byte that does not fit the frame makes it wait for the next start byte
+	switch(state.step)
 	{
-		case NONE:
-		{
-			// identify transmission type
-			if(rx_byte == IDENTIFIED)
-			{
-				sensor_identified();
-			}
-			else
-			{
-				state.current_type = rx_byte;
-			}
+		case START:
+			if(rx_byte == FRAME_START) state.step = TYPE;
 			break;
-		}
-		
-		default:
+		case TYPE:
+			state.type = rx_byte;
+			state.crc = _crc8_ccitt_update(0, rx_byte);
+			state.step = LENGTH;
+			break;
+		case LENGTH:
+			state.length = rx_byte;
+			state.received = 0;
+			state.crc = _crc8_ccitt_update(state.crc, rx_byte);
+			if(rx_byte > FRAME_PAYLOAD_MAX) state.step = START;
+			else state.step = rx_byte > 0 ? PAYLOAD : CRC;
+			break;
+		case PAYLOAD:
+			state.payload[state.received++] = rx_byte;
+			state.crc = _crc8_ccitt_update(state.crc, rx_byte);
+			if(state.received == state.length) state.step = CRC;
+			break;
+		case CRC:
+			if(rx_byte == state.crc) rx_frame(state.type, state.payload, state.length);
+			state.step = START;
 			break;
 	}
 }
@@ -9,11 +9,23 @@
 #ifndef USART_H_
 #define USART_H_
 
+#include <stdint.h>
+
+
+/*
+Every message is framed as: FRAME_START type length payload[length] crc
+crc is the CRC-8 (polynomial 0x07) of type, length and payload.
+Same framing as serial_frame.hpp in the communication module.
+*/
+#define FRAME_START 0xA5
+#define FRAME_PAYLOAD_MAX 8
+
 
 enum tx_type
 {
 	MEASUREMENT = 7,
-	COMPETITION = 2
+	COMPETITION = 2,
+	MODULE_ID = 0x10
 };
 
 
@@ -28,6 +40,10 @@ unsigned char
 usart_receive(void);
 
 
+// transmit a whole frame, also from interrupts without mixing with a frame being sent
+void
+usart_transmit_frame(uint8_t type, const uint8_t* payload, uint8_t length);
+
 void
 usart_transmit_competition();
 
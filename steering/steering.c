@@ -31,7 +31,8 @@ steering_init()
 	// transmit module id
 	while(!state.identified)
 	{
-		usart_transmit(STEERING_ID);
+		uint8_t id = STEERING_ID;
+		usart_transmit_frame(MODULE_ID, &id, 1);
 		_delay_ms(100);
 	}
 	
@@ -7,13 +7,16 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
 
 #include <stdlib.h>
 
 #include "usart.h"
 #include "steering.h"
 
-#define BAUD_PRESCALE 25
+// 500000 baud at 8 MHz in double speed mode, exact
+#define BAUD_PRESCALE 1
 
 void
 usart_init()
@@ -52,20 +55,80 @@ unsigned char usart_receive(void)
 }
 */
 
-// USART rx state
+void usart_transmit_frame(uint8_t type, const uint8_t* payload, uint8_t length)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		uint8_t crc = 0;
+		usart_transmit(FRAME_START);
+		usart_transmit(type);
+		crc = _crc8_ccitt_update(crc, type);
+		usart_transmit(length);
+		crc = _crc8_ccitt_update(crc, length);
+		for(uint8_t i = 0; i < length; i++)
+		{
+			usart_transmit(payload[i]);
+			crc = _crc8_ccitt_update(crc, payload[i]);
+		}
+		usart_transmit(crc);
+	}
+}
+
+
+// USART rx state, where in a frame the next byte is
 struct rx_state
 {
 	enum
 	{
-		NONE = 0,
-		PWM = 1,
-		DIR = 2,
-		IDENTIFIED = 3,
-
-	} current_type;
-	uint8_t current_field;
-	uint8_t field_buffer[6]; // largest transmission is 6 bytes
+		START = 0,
+		TYPE = 1,
+		LENGTH = 2,
+		PAYLOAD = 3,
+		CRC = 4
+	} step;
+	uint8_t type;
+	uint8_t length;
+	uint8_t received;
+	uint8_t crc;
+	uint8_t payload[FRAME_PAYLOAD_MAX];
+};
+
+
+// frame types from the communication module
+enum rx_type
+{
+	PWM = 1,
+	DIR = 2,
+	IDENTIFIED = 3,
+	DRIVE = 4
 };
+
+
+// act on a frame with a correct crc
+static void
+rx_frame(uint8_t type, const uint8_t* payload, uint8_t length)
+{
+	switch(type)
+	{
+		case PWM:
+			if(length == 2) steering_pwm(payload[0], payload[1]);
+			break;
+		case DIR:
+			if(length == 2) steering_dir((bool)payload[0], (bool)payload[1]);
+			break;
+		case IDENTIFIED:
+			steering_identified();
+			break;
+		case DRIVE:
+			// directions first so the new speeds never run the old way
+			if(length == 3)
+			{
+				steering_dir(payload[2] & 1, (payload[2] >> 1) & 1);
+				steering_pwm(payload[0], payload[1]);
+			}
+			break;
+	}
+}
 	
 
 ISR(USART0_RX_vect)
@@ -73,62 +136,38 @@ ISR(USART0_RX_vect)
 	// code to be executed when the USART receives a byte here
 	static struct rx_state state =
 	{
-		.current_type = NONE,
-		.current_field = 0,
+		.step = START,
 	};
 	
 	uint8_t rx_byte;
 	rx_byte = UDR0; // fetch received byte value into variable
-	// UDR0 = rx_byte; // echo back received byte to its transmitter
 	
-	switch(state.current_type)
+	// a byte that does not fit the frame makes it wait for the next start byte
+	switch(state.step)
 	{
-		case NONE:
-		{
-			// identify transmission type
-			if(rx_byte == IDENTIFIED)
-			{
-				steering_identified();
-			}
-			else
-			{
-				state.current_type = rx_byte;
-			}
+		case START:
+			if(rx_byte == FRAME_START) state.step = TYPE;
 			break;
-		}
-		case PWM:
-		{
-			state.field_buffer[state.current_field++] = rx_byte; // fill field buffer
-			// check if last field reached
-			if(state.current_field == 2)
-			{
-				// call callback with new pwm
-				steering_pwm(state.field_buffer[0], state.field_buffer[1]);
-				// reset state
-				state.current_type = NONE;
-				state.current_field = 0;
-			}
+		case TYPE:
+			state.type = rx_byte;
+			state.crc = _crc8_ccitt_update(0, rx_byte);
+			state.step = LENGTH;
 			break;
-		}
-		case DIR:
-		{
-			state.field_buffer[state.current_field++] = rx_byte; // fill field buffer
-			// check if last field reached
-			if(state.current_field == 2)
-			{
-				// call callback with new dir
-				steering_dir((bool)state.field_buffer[0], (bool)state.field_buffer[1]);
-				// reset state
-				state.current_type = NONE;
-				state.current_field = 0;
-			}
+		case LENGTH:
+			state.length = rx_byte;
+			state.received = 0;
+			state.crc = _crc8_ccitt_update(state.crc, rx_byte);
+			if(rx_byte > FRAME_PAYLOAD_MAX) state.step = START;
+			else state.step = rx_byte > 0 ? PAYLOAD : CRC;
 			break;
-		}
-		case IDENTIFIED:
-		{
-			state.current_type = NONE;
-			state.current_field = 0;
+		case PAYLOAD:
+			state.payload[state.received++] = rx_byte;
+			state.crc = _crc8_ccitt_update(state.crc, rx_byte);
+			if(state.received == state.length) state.step = CRC;
+			break;
+		case CRC:
+			if(rx_byte == state.crc) rx_frame(state.type, state.payload, state.length);
+			state.step = START;
 			break;
-		}
 	}
 }
\ No newline at end of file
@@ -12,6 +12,21 @@
 #include <stdint.h>
 
 
+/*
+Every message is framed as: FRAME_START type length payload[length] crc
+crc is the CRC-8 (polynomial 0x07) of type, length and payload.
+Same framing as serial_frame.hpp in the communication module.
+*/
+#define FRAME_START 0xA5
+#define FRAME_PAYLOAD_MAX 8
+
+
+enum tx_type
+{
+	MODULE_ID = 0x10
+};
+
+
 // initialize usart communication
 void
 usart_init();
@@ -20,6 +35,10 @@ usart_init();
 void
 usart_transmit(uint8_t data);
 
+// transmit a whole frame of type with length bytes of payload
+void
+usart_transmit_frame(uint8_t type, const uint8_t* payload, uint8_t length);
+
 /*
 // wait for and receive byte over usart
 unsigned char